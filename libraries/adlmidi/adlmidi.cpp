@@ -30,6 +30,9 @@
 #ifndef ADLMIDI_DISABLE_MIDI_SEQUENCER
 #include "midi_sequencer.hpp"
 #endif
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
 
@@ -757,6 +760,94 @@ ADLMIDI_EXPORT int adl_switchEmulator(struct ADL_MIDIPlayer *device, int emulato
 }
 
 
+ADLMIDI_EXPORT int adl_setChipThreads(struct ADL_MIDIPlayer *device, int threads)
+{
+#ifndef ADLMIDI_HW_OPL
+    if(device && threads >= 0)
+    {
+        MidiPlayer *play = GET_MIDI_PLAYER(device);
+        assert(play);
+        play->m_synth->m_renderPool.setMaxThreads((unsigned)threads);
+        return 0;
+    }
+#else
+    ADL_UNUSED(device);
+    ADL_UNUSED(threads);
+#endif
+    return -1;
+}
+
+
+ADLMIDI_EXPORT int adl_benchmarkEmulator(int emulator, int chips, int threads, int frames, int blockFrames, ADL_EmulatorBenchmark *result)
+{
+#ifndef ADLMIDI_HW_OPL
+    if(!adl_isEmulatorAvailable(emulator) || chips <= 0 || threads < 0 || frames <= 0 || blockFrames <= 0 || !result)
+        return -1;
+
+    // Two identical players, one renders the chips serially and one on the pool
+    ADL_MIDIPlayer *devices[2];
+    for(int set = 0; set < 2; ++set)
+    {
+        devices[set] = adl_init(44100);
+        if(!devices[set])
+        {
+            if(set > 0)
+                adl_close(devices[0]);
+            return -1;
+        }
+        adl_switchEmulator(devices[set], emulator);
+        adl_setNumChips(devices[set], chips);
+        adl_setChipThreads(devices[set], set == 0 ? 1 : threads);
+
+        // Hold a chord on every channel, so that voices on all chips are busy
+        for(ADL_UInt8 channel = 0; channel < 16; ++channel)
+        {
+            adl_rt_patchChange(devices[set], channel, (ADL_UInt8)(channel * 8));
+            for(ADL_UInt8 note = 0; note < 4; ++note)
+                adl_rt_noteOn(devices[set], channel, (ADL_UInt8)(36 + channel * 3 + note * 7), 100);
+        }
+    }
+
+    std::vector<short> out[2];
+    out[0].resize((size_t)blockFrames * 2);
+    out[1].resize((size_t)blockFrames * 2);
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration spent[2] = { Clock::duration(0), Clock::duration(0) };
+    result->identical = 1;
+
+    for(int done = 0; done < frames; )
+    {
+        int block = std::min(frames - done, blockFrames);
+        for(int set = 0; set < 2; ++set)
+        {
+            Clock::time_point start = Clock::now();
+            adl_generate(devices[set], block * 2, &out[set][0]);
+            spent[set] += Clock::now() - start;
+        }
+        if(out[0] != out[1])
+            result->identical = 0;
+        done += block;
+    }
+
+    result->name = adl_chipEmulatorName(devices[0]);
+    result->serialSeconds = std::chrono::duration<double>(spent[0]).count();
+    result->concurrentSeconds = std::chrono::duration<double>(spent[1]).count();
+    adl_close(devices[0]);
+    adl_close(devices[1]);
+    return 0;
+#else
+    ADL_UNUSED(emulator);
+    ADL_UNUSED(chips);
+    ADL_UNUSED(threads);
+    ADL_UNUSED(frames);
+    ADL_UNUSED(blockFrames);
+    ADL_UNUSED(result);
+    return -1;
+#endif
+}
+
+
 ADLMIDI_EXPORT int adl_setRunAtPcmRate(ADL_MIDIPlayer *device, int enabled)
 {
     if(device)
@@ -1357,8 +1448,7 @@ ADLMIDI_EXPORT int adl_playFormat(ADL_MIDIPlayer *device, int sampleCount,
                 else if(n_periodCountStereo > 0)
                 {
                     /* Generate data from every chip and mix result */
-                    for(size_t card = 0; card < chips; ++card)
-                        synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                    synth.generateAndMix32(out_buf, (size_t)in_generatedStereo);
                 }
 
                 /* Process it */
@@ -1448,8 +1538,7 @@ ADLMIDI_EXPORT int adl_generateFormat(struct ADL_MIDIPlayer *device, int sampleC
                 else if(n_periodCountStereo > 0)
                 {
                     /* Generate data from every chip and mix result */
-                    for(unsigned card = 0; card < chips; ++card)
-                        synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                    synth.generateAndMix32(out_buf, (size_t)in_generatedStereo);
                 }
                 /* Process it */
                 if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
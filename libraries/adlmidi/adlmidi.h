@@ -654,6 +654,43 @@ enum ADL_Emulator
  */
 extern ADLMIDI_DECLSPEC int adl_switchEmulator(struct ADL_MIDIPlayer *device, int emulator);
 
+/**
+ * @brief Set how many threads may render the emulated chips
+ *
+ * Only blocks of at least 256 frames are rendered concurrently. The output is the same either way.
+ *
+ * @param device Instance of the library
+ * @param threads Total thread count, 1 renders the chips one after the other (default), 0 uses half of the CPU threads
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern ADLMIDI_DECLSPEC int adl_setChipThreads(struct ADL_MIDIPlayer *device, int threads);
+
+/**
+ * @brief Result of an emulator render-speed benchmark
+ */
+typedef struct {
+    /*! Understandable name of the emulator */
+    const char *name;
+    /*! Time taken to render with the chips rendered one after the other */
+    double serialSeconds;
+    /*! Time taken to render with the chips rendered concurrently */
+    double concurrentSeconds;
+    /*! 1 when both ways produced exactly the same output */
+    int identical;
+} ADL_EmulatorBenchmark;
+
+/**
+ * @brief Measure how fast adl_generate() renders held notes, with the chips rendered serially and concurrently
+ * @param emulator Type of emulator (#ADL_Emulator)
+ * @param chips Count of chips to emulate
+ * @param threads Thread count for the concurrent run (see #adl_setChipThreads)
+ * @param frames Count of stereo frames to render at 44100 Hz
+ * @param blockFrames Count of stereo frames requested by each adl_generate() call
+ * @param result Filled with the timings
+ * @return 0 on success, <0 when the emulator is not available
+ */
+extern ADLMIDI_DECLSPEC int adl_benchmarkEmulator(int emulator, int chips, int threads, int frames, int blockFrames, ADL_EmulatorBenchmark *result);
+
 /**
  * @brief Library version context
  */
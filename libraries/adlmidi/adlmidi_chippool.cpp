@@ -0,0 +1,156 @@
+/*
+ * libADLMIDI is a free Software MIDI synthesizer library with OPL3 emulation
+ *
+ * Original ADLMIDI code: Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * ADLMIDI Library API:   Copyright (c) 2015-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "adlmidi_chippool.hpp"
+
+#ifndef ADLMIDI_HW_OPL
+
+#include <algorithm>
+
+ChipRenderPool::ChipRenderPool() :
+    m_maxThreads(1),
+    m_job(0),
+    m_pending(0),
+    m_quit(false),
+    m_chips(NULL),
+    m_numChips(0),
+    m_frames(0)
+{}
+
+ChipRenderPool::~ChipRenderPool()
+{
+    stopWorkers();
+}
+
+void ChipRenderPool::setMaxThreads(unsigned threads)
+{
+    m_maxThreads = threads;
+}
+
+void ChipRenderPool::generateAndMix32(const AdlMIDI_SPtr<OPLChipBase> *chips, size_t numChips,
+                                      int32_t *output, size_t frames, bool concurrent)
+{
+    unsigned threads = 1;
+    if(concurrent && frames >= MinConcurrentFrames)
+    {
+        // Leave half of the CPU to the game itself by default
+        unsigned limit = m_maxThreads;
+        if(limit == 0)
+            limit = std::max(1u, std::thread::hardware_concurrency() / 2);
+        threads = (unsigned)std::min<size_t>(numChips, limit);
+    }
+
+    if(threads < 2)
+    {
+        for(size_t i = 0; i < numChips; ++i)
+            chips[i]->generateAndMix32(output, frames);
+        return;
+    }
+
+    if(m_workers.size() != threads - 1)
+    {
+        stopWorkers();
+        startWorkers(threads - 1);
+    }
+
+    if(m_chipBuffers.size() < numChips * frames * 2)
+        m_chipBuffers.resize(numChips * frames * 2);
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_chips = chips;
+        m_numChips = numChips;
+        m_frames = frames;
+        m_pending = threads - 1;
+        ++m_job;
+    }
+    m_wake.notify_all();
+
+    renderShare(0);
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        while(m_pending > 0)
+            m_done.wait(lock);
+    }
+
+    // Mix in chip order, exactly like the serial path does
+    for(size_t c = 0; c < numChips; ++c)
+    {
+        const int32_t *in = &m_chipBuffers[c * frames * 2];
+        for(size_t i = 0; i < frames * 2; ++i)
+            output[i] += in[i];
+    }
+}
+
+void ChipRenderPool::startWorkers(unsigned count)
+{
+    m_quit = false;
+    for(unsigned i = 0; i < count; ++i)
+        m_workers.push_back(std::thread(&ChipRenderPool::workerProc, this, i + 1, m_job));
+}
+
+void ChipRenderPool::stopWorkers()
+{
+    if(m_workers.empty())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for(size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+    m_workers.clear();
+}
+
+void ChipRenderPool::workerProc(unsigned index, unsigned job)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    for(;;)
+    {
+        while(!m_quit && m_job == job)
+            m_wake.wait(lock);
+        if(m_quit)
+            return;
+        job = m_job;
+
+        lock.unlock();
+        renderShare(index);
+        lock.lock();
+
+        if(--m_pending == 0)
+            m_done.notify_one();
+    }
+}
+
+void ChipRenderPool::renderShare(unsigned index)
+{
+    // Chips are dealt out round-robin so each thread gets a similar load
+    size_t stride = m_workers.size() + 1;
+    for(size_t c = index; c < m_numChips; c += stride)
+        m_chips[c]->generate32(&m_chipBuffers[c * m_frames * 2], m_frames);
+}
+
+#endif // ADLMIDI_HW_OPL
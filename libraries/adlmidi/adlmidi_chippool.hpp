@@ -0,0 +1,106 @@
+/*
+ * libADLMIDI is a free Software MIDI synthesizer library with OPL3 emulation
+ *
+ * Original ADLMIDI code: Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * ADLMIDI Library API:   Copyright (c) 2015-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADLMIDI_CHIPPOOL_HPP
+#define ADLMIDI_CHIPPOOL_HPP
+
+#ifndef ADLMIDI_HW_OPL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "adlmidi_ptr.hpp"
+#include "chips/opl_chip_base.h"
+
+/**
+ * @brief Renders several emulated chips at once on a small worker pool
+ *
+ * Every chip is rendered into a buffer of its own, and the buffers are
+ * mixed into the output in chip order afterwards. The chips produce
+ * 32-bit integer frames, so the result is bit-identical to rendering
+ * them one after the other with generateAndMix32().
+ *
+ * Waking and joining the workers costs about as much as rendering a few
+ * dozen frames of a chip, so short blocks are always rendered serially.
+ * The pool is off unless the maximum thread count gets raised.
+ */
+class ChipRenderPool
+{
+public:
+    ChipRenderPool();
+    ~ChipRenderPool();
+
+    /**
+     * @brief Limit the number of threads used for rendering
+     * @param threads Total thread count including the caller, 1 renders serially (default), 0 picks one from the CPU count
+     */
+    void setMaxThreads(unsigned threads);
+
+    //! Blocks with fewer frames than this are rendered on the calling thread
+    static const size_t MinConcurrentFrames = 256;
+
+    /**
+     * @brief Render frames from all chips and add them to the output
+     * @param chips Array of chips to render
+     * @param numChips Count of chips in the array
+     * @param output Interleaved stereo output to mix into
+     * @param frames Count of stereo frames to render
+     * @param concurrent Whether the chips may be rendered at the same time
+     */
+    void generateAndMix32(const AdlMIDI_SPtr<OPLChipBase> *chips, size_t numChips,
+                          int32_t *output, size_t frames, bool concurrent);
+
+private:
+    ChipRenderPool(const ChipRenderPool &);
+    ChipRenderPool &operator=(const ChipRenderPool &);
+
+    void startWorkers(unsigned count);
+    void stopWorkers();
+    void workerProc(unsigned index, unsigned job);
+    void renderShare(unsigned index);
+
+    //! Maximum total thread count, 0 means unlimited
+    unsigned m_maxThreads;
+    //! Worker threads, the caller renders the first share itself
+    std::vector<std::thread> m_workers;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    //! Incremented for every block handed to the workers
+    unsigned m_job;
+    //! Count of workers that have not finished the current block
+    unsigned m_pending;
+    bool m_quit;
+
+    //! Current block
+    const AdlMIDI_SPtr<OPLChipBase> *m_chips;
+    size_t m_numChips;
+    size_t m_frames;
+    //! One output buffer per chip, 2 * m_frames samples apart
+    std::vector<int32_t> m_chipBuffers;
+};
+
+#endif // ADLMIDI_HW_OPL
+
+#endif // ADLMIDI_CHIPPOOL_HPP
@@ -871,6 +871,40 @@ static OplInstMeta makeEmptyInstrument()
 
 const OplInstMeta OPL3::m_emptyInstrument = makeEmptyInstrument();
 
+#ifndef ADLMIDI_HW_OPL
+//! Create a chip instance of the given emulator, NULL if it is not available
+static OPLChipBase *createEmulator(int emulator)
+{
+    switch(emulator)
+    {
+    default:
+        return NULL;
+#ifndef ADLMIDI_DISABLE_NUKED_EMULATOR
+    case ADLMIDI_EMU_NUKED: /* Latest Nuked OPL3 */
+        return new NukedOPL3;
+    case ADLMIDI_EMU_NUKED_174: /* Old Nuked OPL3 1.4.7 modified and optimized */
+        return new NukedOPL3v174;
+#endif
+#ifndef ADLMIDI_DISABLE_DOSBOX_EMULATOR
+    case ADLMIDI_EMU_DOSBOX:
+        return new DosBoxOPL3;
+#endif
+#ifndef ADLMIDI_DISABLE_OPAL_EMULATOR
+    case ADLMIDI_EMU_OPAL:
+        return new OpalOPL3;
+#endif
+#ifndef ADLMIDI_DISABLE_JAVA_EMULATOR
+    case ADLMIDI_EMU_JAVA:
+        return new JavaOPL3;
+#endif
+#ifndef ADLMIDI_DISABLE_ESFM_EMULATOR
+    case ADLMIDI_EMU_ESFM:
+        return new ESFM;
+#endif
+    }
+}
+#endif
+
 OPL3::OPL3() :
     m_numChips(1),
     m_numFourOps(0),
@@ -886,6 +920,9 @@ OPL3::OPL3() :
     m_insBankSetup.deepTremolo = false;
     m_insBankSetup.deepVibrato = false;
     m_insBankSetup.scaleModulators = false;
+#ifndef ADLMIDI_HW_OPL
+    m_concurrentChips = false;
+#endif
 
 #ifdef DISABLE_EMBEDDED_BANKS
     m_embeddedBank = CustomBankTag;
@@ -1726,8 +1763,13 @@ void OPL3::clearChips()
         m_chips[i].reset(NULL);
     m_chips.clear();
 }
+void OPL3::generateAndMix32(int32_t *output, size_t frames)
+{
+    m_renderPool.generateAndMix32(&m_chips[0], m_chips.size(), output, frames, m_concurrentChips);
+}
 #endif
 
+
 void OPL3::reset(int emulator, unsigned long PCM_RATE, void *audioTickHandler)
 {
 #ifndef ADLMIDI_HW_OPL
@@ -1745,6 +1787,8 @@ void OPL3::reset(int emulator, unsigned long PCM_RATE, void *audioTickHandler)
 
 #ifndef ADLMIDI_HW_OPL
     m_chips.resize(m_numChips, AdlMIDI_SPtr<OPLChipBase>());
+    // The Java core shares a random generator between all of its instances
+    m_concurrentChips = (emulator != ADLMIDI_EMU_JAVA);
 #endif
 
     const struct OplTimbre defaultInsCache = { 0x1557403,0x005B381, 0x49,0x80, 0x4, +0 };
@@ -1773,40 +1817,11 @@ void OPL3::reset(int emulator, unsigned long PCM_RATE, void *audioTickHandler)
     for(size_t i = 0; i < m_numChips; ++i)
     {
 #ifndef ADLMIDI_HW_OPL
-        OPLChipBase *chip;
-        switch(emulator)
+        OPLChipBase *chip = createEmulator(emulator);
+        if(!chip)
         {
-        default:
             assert(false);
             abort();
-#ifndef ADLMIDI_DISABLE_NUKED_EMULATOR
-        case ADLMIDI_EMU_NUKED: /* Latest Nuked OPL3 */
-            chip = new NukedOPL3;
-            break;
-        case ADLMIDI_EMU_NUKED_174: /* Old Nuked OPL3 1.4.7 modified and optimized */
-            chip = new NukedOPL3v174;
-            break;
-#endif
-#ifndef ADLMIDI_DISABLE_DOSBOX_EMULATOR
-        case ADLMIDI_EMU_DOSBOX:
-            chip = new DosBoxOPL3;
-            break;
-#endif
-#ifndef ADLMIDI_DISABLE_OPAL_EMULATOR
-        case ADLMIDI_EMU_OPAL:
-            chip = new OpalOPL3;
-            break;
-#endif
-#ifndef ADLMIDI_DISABLE_JAVA_EMULATOR
-        case ADLMIDI_EMU_JAVA:
-            chip = new JavaOPL3;
-            break;
-#endif
-#ifndef ADLMIDI_DISABLE_ESFM_EMULATOR
-		case ADLMIDI_EMU_ESFM:
-			chip = new ESFM;
-			break;
-#endif
         }
         m_chips[i].reset(chip);
         chip->setChipId((uint32_t)i);
@@ -28,6 +28,7 @@
 #include "adlmidi_ptr.hpp"
 #include "adlmidi_private.hpp"
 #include "adlmidi_bankmap.h"
+#include "adlmidi_chippool.hpp"
 
 #define BEND_COEFFICIENT                172.4387
 
@@ -62,6 +63,10 @@ public:
 #ifndef ADLMIDI_HW_OPL
     //! Running chip emulators
     std::vector<AdlMIDI_SPtr<OPLChipBase > > m_chips;
+    //! Renders multiple chips concurrently
+    ChipRenderPool m_renderPool;
+    //! Chips of the current emulator may be rendered at the same time
+    bool m_concurrentChips;
 #endif
 
 private:
@@ -323,6 +328,13 @@ public:
      * @brief Clean up all running emulated chip instances
      */
     void clearChips();
+
+    /**
+     * @brief Render frames from every chip and add them to the output
+     * @param output Interleaved stereo output to mix into
+     * @param frames Count of stereo frames to render
+     */
+    void generateAndMix32(int32_t *output, size_t frames);
     #endif
 
     /**
@@ -29,6 +29,7 @@
 #include "common.h"
 #include "instrum.h"
 #include "playmidi.h"
+#include "mixkernels.h"
 
 
 namespace Timidity
@@ -570,40 +571,6 @@ static void mix_mono_signal(int32_t control_ratio, const sample_t *sp, float *lp
 	}
 }
 
-static void mix_mystery(int32_t control_ratio, const sample_t *sp, float *lp, Voice *v, int count)
-{
-	final_volume_t 
-		left = v->left_mix, 
-		right = v->right_mix;
-	sample_t s;
-
-	while (count--)
-	{
-		s = *sp++;
-		lp[0] += s * left;
-		lp[1] += s * right;
-		lp += 2;
-	}
-}
-
-static void mix_single(const sample_t *sp, float *lp, final_volume_t amp, int count)
-{
-	while (count--)
-	{
-		lp[0] += *sp++ * amp;
-		lp += 2;
-	}
-}
-
-static void mix_single_left(const sample_t *sp, float *lp, Voice *v, int count)
-{
-	mix_single(sp, lp, v->left_mix, count);
-}
-static void mix_single_right(const sample_t *sp, float *lp, Voice *v, int count)
-{
-	mix_single(sp, lp + 1, v->right_mix, count);
-}
-
 static void mix_mono(const sample_t *sp, float *lp, Voice *v, int count)
 {
 	final_volume_t 
@@ -727,7 +694,7 @@ void mix_voice(Renderer *song, float *buf, Voice *v, int c)
 			}
 			else
 			{
-				mix_single_left(sp, buf, v, count);
+				song->kernels->MixSingle(sp, buf, v->left_mix, count);
 			}
 		}
 		else if (v->left_mix == 0)		// All the way to the right
@@ -738,7 +705,7 @@ void mix_voice(Renderer *song, float *buf, Voice *v, int c)
 			}
 			else
 			{
-				mix_single_right(sp, buf, v, count);
+				song->kernels->MixSingle(sp, buf + 1, v->right_mix, count);
 			}
 		}
 		else							// Somewhere in the middle
@@ -749,7 +716,7 @@ void mix_voice(Renderer *song, float *buf, Voice *v, int c)
 			}
 			else
 			{
-				mix_mystery(song->control_ratio, sp, buf, v, count);
+				song->kernels->MixStereo(sp, buf, v->left_mix, v->right_mix, count);
 			}
 		}
 		v->sample_count += count;
@@ -0,0 +1,383 @@
+/*
+
+	TiMidity -- Experimental MIDI to WAVE converter
+	Copyright (C) 1995 Tuukka Toivonen <toivonen@clinet.fi>
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 2.1 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+	mixkernels.cpp
+
+	The vector versions compute the same per-sample expressions as the
+	scalar ones, without fused multiply-adds. The resampler's division by
+	1 << FRACTION_BITS is a multiplication by a power of two, so it is
+	exact either way.
+
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "timidity.h"
+#include "common.h"
+#include "instrum.h"
+#include "playmidi.h"
+#include "mixkernels.h"
+
+#if defined(__i386__) || defined(__amd64__) || defined(_M_IX86) || defined(_M_X64)
+#define MIXKERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The library is not built with AVX2 enabled, so only the functions that need it get the instructions.
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+#endif
+
+
+namespace Timidity
+{
+
+/*************** scalar kernels *****************/
+
+static int ResampleScalar(sample_t *dest, const sample_t *src, int ofs, int incr, int count)
+{
+	while (count--)
+	{
+		int o = ofs >> FRACTION_BITS, m = ofs & FRACTION_MASK;
+		*dest++ = src[o] + (src[o + 1] - src[o]) * m / (1 << FRACTION_BITS);
+		ofs += incr;
+	}
+	return ofs;
+}
+
+static void MixStereoScalar(const sample_t *sp, float *lp, final_volume_t left, final_volume_t right, int count)
+{
+	sample_t s;
+
+	while (count--)
+	{
+		s = *sp++;
+		lp[0] += s * left;
+		lp[1] += s * right;
+		lp += 2;
+	}
+}
+
+static void MixSingleScalar(const sample_t *sp, float *lp, final_volume_t amp, int count)
+{
+	while (count--)
+	{
+		lp[0] += *sp++ * amp;
+		lp += 2;
+	}
+}
+
+#ifdef MIXKERNELS_X86
+
+/*************** SSE2 kernels *****************/
+
+static int ResampleSSE2(sample_t *dest, const sample_t *src, int ofs, int incr, int count)
+{
+	const __m128i step = _mm_setr_epi32(0, incr, incr * 2, incr * 3);
+	const __m128i fracmask = _mm_set1_epi32(FRACTION_MASK);
+	const __m128 scale = _mm_set1_ps(1.f / (1 << FRACTION_BITS));
+
+	for (; count >= 4; count -= 4)
+	{
+		__m128i pos = _mm_add_epi32(_mm_set1_epi32(ofs), step);
+		int o0 = ofs >> FRACTION_BITS, o1 = (ofs + incr) >> FRACTION_BITS;
+		int o2 = (ofs + incr * 2) >> FRACTION_BITS, o3 = (ofs + incr * 3) >> FRACTION_BITS;
+		__m128 a = _mm_setr_ps(src[o0], src[o1], src[o2], src[o3]);
+		__m128 b = _mm_setr_ps(src[o0 + 1], src[o1 + 1], src[o2 + 1], src[o3 + 1]);
+		__m128 frac = _mm_cvtepi32_ps(_mm_and_si128(pos, fracmask));
+		_mm_storeu_ps(dest, _mm_add_ps(a, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(b, a), frac), scale)));
+		dest += 4;
+		ofs += incr * 4;
+	}
+	return ResampleScalar(dest, src, ofs, incr, count);
+}
+
+static void MixStereoSSE2(const sample_t *sp, float *lp, final_volume_t left, final_volume_t right, int count)
+{
+	const __m128 vol = _mm_setr_ps(left, right, left, right);
+
+	for (; count >= 4; count -= 4)
+	{
+		__m128 s = _mm_loadu_ps(sp);
+		__m128 lo = _mm_unpacklo_ps(s, s);
+		__m128 hi = _mm_unpackhi_ps(s, s);
+		_mm_storeu_ps(lp, _mm_add_ps(_mm_loadu_ps(lp), _mm_mul_ps(lo, vol)));
+		_mm_storeu_ps(lp + 4, _mm_add_ps(_mm_loadu_ps(lp + 4), _mm_mul_ps(hi, vol)));
+		sp += 4;
+		lp += 8;
+	}
+	MixStereoScalar(sp, lp, left, right, count);
+}
+
+static void MixSingleSSE2(const sample_t *sp, float *lp, final_volume_t amp, int count)
+{
+	const __m128 vol = _mm_set1_ps(amp);
+	const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0));
+
+	// The last float touched belongs to the next frame, so keep one sample for the tail.
+	for (; count > 4; count -= 4)
+	{
+		__m128 s = _mm_loadu_ps(sp);
+		__m128 lo = _mm_unpacklo_ps(s, s);
+		__m128 hi = _mm_unpackhi_ps(s, s);
+		__m128 out0 = _mm_loadu_ps(lp);
+		__m128 out1 = _mm_loadu_ps(lp + 4);
+		__m128 sum0 = _mm_add_ps(out0, _mm_mul_ps(lo, vol));
+		__m128 sum1 = _mm_add_ps(out1, _mm_mul_ps(hi, vol));
+		_mm_storeu_ps(lp, _mm_or_ps(_mm_and_ps(mask, sum0), _mm_andnot_ps(mask, out0)));
+		_mm_storeu_ps(lp + 4, _mm_or_ps(_mm_and_ps(mask, sum1), _mm_andnot_ps(mask, out1)));
+		sp += 4;
+		lp += 8;
+	}
+	MixSingleScalar(sp, lp, amp, count);
+}
+
+/*************** AVX2 kernels *****************/
+
+AVX2_TARGET static int ResampleAVX2(sample_t *dest, const sample_t *src, int ofs, int incr, int count)
+{
+	const __m256i step = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(incr));
+	const __m256i fracmask = _mm256_set1_epi32(FRACTION_MASK);
+	const __m256 scale = _mm256_set1_ps(1.f / (1 << FRACTION_BITS));
+
+	for (; count >= 8; count -= 8)
+	{
+		__m256i pos = _mm256_add_epi32(_mm256_set1_epi32(ofs), step);
+		__m256i index = _mm256_srai_epi32(pos, FRACTION_BITS);
+		__m256 a = _mm256_i32gather_ps(src, index, 4);
+		__m256 b = _mm256_i32gather_ps(src + 1, index, 4);
+		__m256 frac = _mm256_cvtepi32_ps(_mm256_and_si256(pos, fracmask));
+		_mm256_storeu_ps(dest, _mm256_add_ps(a, _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), frac), scale)));
+		dest += 8;
+		ofs += incr * 8;
+	}
+	return ResampleScalar(dest, src, ofs, incr, count);
+}
+
+// Spreads 8 samples over 16 interleaved floats: s0 s0 s1 s1 s2 s2 s3 s3 | s4 s4 s5 s5 s6 s6 s7 s7
+AVX2_TARGET static inline void Duplicate(__m256 s, __m256 &lo, __m256 &hi)
+{
+	__m256 a = _mm256_unpacklo_ps(s, s);	// s0 s0 s1 s1 | s4 s4 s5 s5
+	__m256 b = _mm256_unpackhi_ps(s, s);	// s2 s2 s3 s3 | s6 s6 s7 s7
+	lo = _mm256_permute2f128_ps(a, b, 0x20);
+	hi = _mm256_permute2f128_ps(a, b, 0x31);
+}
+
+AVX2_TARGET static void MixStereoAVX2(const sample_t *sp, float *lp, final_volume_t left, final_volume_t right, int count)
+{
+	const __m256 vol = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+	for (; count >= 8; count -= 8)
+	{
+		__m256 lo, hi;
+		Duplicate(_mm256_loadu_ps(sp), lo, hi);
+		_mm256_storeu_ps(lp, _mm256_add_ps(_mm256_loadu_ps(lp), _mm256_mul_ps(lo, vol)));
+		_mm256_storeu_ps(lp + 8, _mm256_add_ps(_mm256_loadu_ps(lp + 8), _mm256_mul_ps(hi, vol)));
+		sp += 8;
+		lp += 16;
+	}
+	MixStereoSSE2(sp, lp, left, right, count);
+}
+
+AVX2_TARGET static void MixSingleAVX2(const sample_t *sp, float *lp, final_volume_t amp, int count)
+{
+	const __m256 vol = _mm256_set1_ps(amp);
+
+	// The last float touched belongs to the next frame, so keep one sample for the tail.
+	for (; count > 8; count -= 8)
+	{
+		__m256 lo, hi;
+		Duplicate(_mm256_loadu_ps(sp), lo, hi);
+		__m256 out0 = _mm256_loadu_ps(lp);
+		__m256 out1 = _mm256_loadu_ps(lp + 8);
+		_mm256_storeu_ps(lp, _mm256_blend_ps(out0, _mm256_add_ps(out0, _mm256_mul_ps(lo, vol)), 0x55));
+		_mm256_storeu_ps(lp + 8, _mm256_blend_ps(out1, _mm256_add_ps(out1, _mm256_mul_ps(hi, vol)), 0x55));
+		sp += 8;
+		lp += 16;
+	}
+	MixSingleSSE2(sp, lp, amp, count);
+}
+
+static bool CPUHasAVX2()
+{
+#if defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+	__cpuid(regs, 1);
+	// The OS must save the YMM registers as well.
+	if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+#endif // MIXKERNELS_X86
+
+static const char *const LevelNames[MIXKERNELS_Count] = { "Scalar", "SSE2", "AVX2" };
+
+static const MixKernels Kernels[MIXKERNELS_Count] =
+{
+	{ "Scalar", ResampleScalar, MixStereoScalar, MixSingleScalar },
+#ifdef MIXKERNELS_X86
+	{ "SSE2", ResampleSSE2, MixStereoSSE2, MixSingleSSE2 },
+	{ "AVX2", ResampleAVX2, MixStereoAVX2, MixSingleAVX2 },
+#endif
+};
+
+const MixKernels *GetMixKernels(int level)
+{
+#ifdef MIXKERNELS_X86
+	static const bool hasAVX2 = CPUHasAVX2();
+
+	if (level == MIXKERNELS_AVX2 && !hasAVX2)
+		return NULL;
+	// SSE2 is part of every x86-64 CPU and has been required on 32 bit x86 for a long time.
+	if (level >= 0 && level < MIXKERNELS_Count)
+		return &Kernels[level];
+#else
+	if (level == MIXKERNELS_Scalar)
+		return &Kernels[level];
+#endif
+	return NULL;
+}
+
+const MixKernels *GetBestMixKernels()
+{
+	for (int level = MIXKERNELS_Count - 1; level > MIXKERNELS_Scalar; level--)
+	{
+		const MixKernels *k = GetMixKernels(level);
+		if (k != NULL)
+			return k;
+	}
+	return &Kernels[MIXKERNELS_Scalar];
+}
+
+/*************** benchmark *****************/
+
+enum
+{
+	BENCH_SAMPLE_LENGTH = 8192,
+	BENCH_BLOCK = 512
+};
+
+static void SetupBenchmarkVoices(Renderer *song, Sample *samples, int voices)
+{
+	uint32_t seed = 0x1234567;
+	auto rand32 = [&]() { seed = seed * 1664525 + 1013904223; return seed >> 8; };
+
+	memset(song->voice, 0, sizeof(Voice) * song->voices);
+	for (int i = 0; i < voices; i++)
+	{
+		Voice *v = &song->voice[i];
+		// One voice in three loops back and forth, another one has vibrato.
+		v->sample = &samples[i % 3];
+		v->status = VOICE_RUNNING | VOICE_LPE;
+		float ratio = 0.25f + (rand32() % 1000) * (1.75f / 1000);
+		v->frequency = v->sample->root_freq * ratio;
+		v->sample_increment = int(ratio * (1 << FRACTION_BITS));
+		v->sample_offset = (rand32() % (BENCH_SAMPLE_LENGTH / 2)) << FRACTION_BITS;
+		v->vibrato_control_ratio = v->sample->vibrato_control_ratio;
+		// A few voices are panned hard to one side.
+		switch (rand32() % 4)
+		{
+		case 0:		v->left_mix = 0.5f;		v->right_mix = 0;		break;
+		case 1:		v->left_mix = 0;		v->right_mix = 0.5f;	break;
+		default:	v->left_mix = (rand32() % 100) * 0.005f + 0.01f;	v->right_mix = 0.51f - v->left_mix;	break;
+		}
+	}
+}
+
+void BenchmarkMixKernels(float rate, int voices, int samples, MixBenchmark results[MIXKERNELS_Count])
+{
+	Instruments instruments(NULL);
+	std::vector<sample_t> data(BENCH_SAMPLE_LENGTH + 1);
+	std::vector<float> reference(samples * 2), output(samples * 2);
+	Sample patches[3];
+
+	for (int i = 0; i <= BENCH_SAMPLE_LENGTH; i++)
+	{
+		data[i] = sample_t(sin(i * 0.0625) * 0.5 + sin(i * 0.3) * 0.25);
+	}
+	memset(patches, 0, sizeof(patches));
+	for (int i = 0; i < 3; i++)
+	{
+		patches[i].data = data.data();
+		patches[i].data_length = BENCH_SAMPLE_LENGTH << FRACTION_BITS;
+		patches[i].loop_start = (BENCH_SAMPLE_LENGTH / 2) << FRACTION_BITS;
+		patches[i].loop_end = (BENCH_SAMPLE_LENGTH - 1) << FRACTION_BITS;
+		patches[i].sample_rate = int(rate);
+		patches[i].root_freq = 440;
+		patches[i].modes = PATCH_LOOPEN;
+	}
+	patches[1].modes |= PATCH_BIDIR;
+	patches[2].vibrato_depth = 64;
+	patches[2].vibrato_control_ratio = 64;
+
+	for (int level = 0; level < MIXKERNELS_Count; level++)
+	{
+		MixBenchmark &result = results[level];
+		const MixKernels *kernels = GetMixKernels(level);
+
+		result.name = LevelNames[level];
+		result.supported = kernels != NULL;
+		result.seconds = 0;
+		result.maxError = 0;
+		if (kernels == NULL)
+			continue;
+
+		Renderer song(rate, voices, &instruments);
+		song.kernels = kernels;
+		SetupBenchmarkVoices(&song, patches, voices);
+
+		std::vector<float> &out = level == MIXKERNELS_Scalar ? reference : output;
+		auto start = std::chrono::steady_clock::now();
+		for (int pos = 0; pos < samples; pos += BENCH_BLOCK)
+		{
+			song.ComputeOutput(&out[pos * 2], std::min<int>(BENCH_BLOCK, samples - pos));
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (level != MIXKERNELS_Scalar)
+		{
+			for (size_t i = 0; i < out.size(); i++)
+			{
+				result.maxError = std::max<double>(result.maxError, fabs(out[i] - reference[i]));
+			}
+		}
+	}
+}
+
+}
@@ -29,6 +29,7 @@
 #include "common.h"
 #include "instrum.h"
 #include "playmidi.h"
+#include "mixkernels.h"
 
 
 namespace Timidity
@@ -44,7 +45,7 @@ namespace Timidity
 
 /*************** resampling with fixed increment *****************/
 
-static sample_t *rs_plain(sample_t *resample_buffer, Voice *v, int *countptr)
+static sample_t *rs_plain(const MixKernels *kernels, sample_t *resample_buffer, Voice *v, int *countptr)
 {
 	/* Play sample until end, then free the voice. */
 
@@ -76,11 +77,8 @@ static sample_t *rs_plain(sample_t *resample_buffer, Voice *v, int *countptr)
 		count -= i;
 	}
 
-	while (i--) 
-	{
-		RESAMPLATION;
-		ofs += incr;
-	}
+	ofs = kernels->Resample(dest, src, ofs, incr, i);
+	dest += i;
 
 	if (ofs >= le) 
 	{
@@ -93,7 +91,7 @@ static sample_t *rs_plain(sample_t *resample_buffer, Voice *v, int *countptr)
 	return resample_buffer;
 }
 
-static sample_t *rs_loop(sample_t *resample_buffer, Voice *vp, int count)
+static sample_t *rs_loop(const MixKernels *kernels, sample_t *resample_buffer, Voice *vp, int count)
 {
 	/* Play sample until end-of-loop, skip back and continue. */
 
@@ -125,18 +123,15 @@ static sample_t *rs_loop(sample_t *resample_buffer, Voice *vp, int count)
 		{
 			count -= i;
 		}
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 	}
 
 	vp->sample_offset=ofs; /* Update offset */
 	return resample_buffer;
 }
 
-static sample_t *rs_bidir(sample_t *resample_buffer, Voice *vp, int count)
+static sample_t *rs_bidir(const MixKernels *kernels, sample_t *resample_buffer, Voice *vp, int count)
 {
 	int
 		ofs = vp->sample_offset,
@@ -169,11 +164,8 @@ static sample_t *rs_bidir(sample_t *resample_buffer, Voice *vp, int count)
 		{
 			count -= i;
 		}
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 	}
 
 	/* Then do the bidirectional looping */
@@ -191,11 +183,8 @@ static sample_t *rs_bidir(sample_t *resample_buffer, Voice *vp, int count)
 		{
 			count -= i;
 		}
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 		if (ofs >= le) 
 		{
 			/* fold the overshoot back in */
@@ -325,7 +314,7 @@ static sample_t *rs_vib_plain(sample_t *resample_buffer, float rate, Voice *vp,
 	return resample_buffer;
 }
 
-static sample_t *rs_vib_loop(sample_t *resample_buffer, float rate, Voice *vp, int count)
+static sample_t *rs_vib_loop(const MixKernels *kernels, sample_t *resample_buffer, float rate, Voice *vp, int count)
 {
 	/* Play sample until end-of-loop, skip back and continue. */
 
@@ -364,11 +353,8 @@ static sample_t *rs_vib_loop(sample_t *resample_buffer, float rate, Voice *vp, i
 			cc -= i;
 		}
 		count -= i;
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 		if (vibflag) 
 		{
 			cc = vp->vibrato_control_ratio;
@@ -383,7 +369,7 @@ static sample_t *rs_vib_loop(sample_t *resample_buffer, float rate, Voice *vp, i
 	return resample_buffer;
 }
 
-static sample_t *rs_vib_bidir(sample_t *resample_buffer, float rate, Voice *vp, int count)
+static sample_t *rs_vib_bidir(const MixKernels *kernels, sample_t *resample_buffer, float rate, Voice *vp, int count)
 {
 	int
 		ofs = vp->sample_offset, 
@@ -422,11 +408,8 @@ static sample_t *rs_vib_bidir(sample_t *resample_buffer, float rate, Voice *vp,
 			cc -= i;
 		}
 		count -= i;
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 		if (vibflag) 
 		{
 			cc = vp->vibrato_control_ratio;
@@ -455,11 +438,8 @@ static sample_t *rs_vib_bidir(sample_t *resample_buffer, float rate, Voice *vp,
 			cc -= i;
 		}
 		count -= i;
-		while (i--) 
-		{
-			RESAMPLATION;
-			ofs += incr;
-		}
+		ofs = kernels->Resample(dest, src, ofs, incr, i);
+		dest += i;
 		if (vibflag) 
 		{
 			cc = vp->vibrato_control_ratio;
@@ -526,9 +506,9 @@ sample_t *resample_voice(Renderer *song, Voice *vp, int *countptr)
 		if (vp->status & VOICE_LPE)
 		{
 			if (modes & PATCH_BIDIR)
-				return rs_vib_bidir(song->resample_buffer, song->rate, vp, *countptr);
+				return rs_vib_bidir(song->kernels, song->resample_buffer, song->rate, vp, *countptr);
 			else
-				return rs_vib_loop(song->resample_buffer, song->rate, vp, *countptr);
+				return rs_vib_loop(song->kernels, song->resample_buffer, song->rate, vp, *countptr);
 		}
 		else
 		{
@@ -540,13 +520,13 @@ sample_t *resample_voice(Renderer *song, Voice *vp, int *countptr)
 		if (vp->status & VOICE_LPE)
 		{
 			if (modes & PATCH_BIDIR)
-				return rs_bidir(song->resample_buffer, vp, *countptr);
+				return rs_bidir(song->kernels, song->resample_buffer, vp, *countptr);
 			else
-				return rs_loop(song->resample_buffer, vp, *countptr);
+				return rs_loop(song->kernels, song->resample_buffer, vp, *countptr);
 		}
 		else
 		{
-			return rs_plain(song->resample_buffer, vp, countptr);
+			return rs_plain(song->kernels, song->resample_buffer, vp, countptr);
 		}
 	}
 }
@@ -32,6 +32,7 @@
 #include "common.h"
 #include "instrum.h"
 #include "playmidi.h"
+#include "mixkernels.h"
 
 
 
@@ -735,6 +736,7 @@ Renderer::Renderer(float sample_rate, int voices_, Instruments *inst)
 	adjust_panning_immediately = false;
 
 	control_ratio = std::min(1, std::max(MAX_CONTROL_RATIO, int(rate / CONTROLS_PER_SECOND)));
+	kernels = GetBestMixKernels();
 
 	lost_notes = 0;
 	cut_notes = 0;
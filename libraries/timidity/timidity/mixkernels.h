@@ -0,0 +1,77 @@
+/*
+
+	TiMidity -- Experimental MIDI to WAVE converter
+	Copyright (C) 1995 Tuukka Toivonen <toivonen@clinet.fi>
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Lesser General Public
+	License as published by the Free Software Foundation; either
+	version 2.1 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+	mixkernels.h
+
+*/
+
+#ifndef TIMIDITY_MIXKERNELS_H
+#define TIMIDITY_MIXKERNELS_H
+
+namespace Timidity
+{
+typedef float sample_t;
+typedef float final_volume_t;
+
+enum
+{
+	MIXKERNELS_Scalar,
+	MIXKERNELS_SSE2,
+	MIXKERNELS_AVX2,
+	MIXKERNELS_Count
+};
+
+/* The inner loops of resample.cpp and mix.cpp, once per instruction set.
+   All versions do the same float operations in the same order, so they
+   produce identical output. */
+struct MixKernels
+{
+	const char *name;
+
+	/* Linear interpolation of count samples, starting at fixed point
+	   position ofs. Returns the position after the last sample. */
+	int (*Resample)(sample_t *dest, const sample_t *src, int ofs, int incr, int count);
+	/* Adds count samples to both channels of an interleaved stereo buffer. */
+	void (*MixStereo)(const sample_t *sp, float *lp, final_volume_t left, final_volume_t right, int count);
+	/* Adds count samples to every other float of lp, leaving the rest alone. */
+	void (*MixSingle)(const sample_t *sp, float *lp, final_volume_t amp, int count);
+};
+
+/* Returns NULL if the CPU cannot run this level. */
+const MixKernels *GetMixKernels(int level);
+const MixKernels *GetBestMixKernels();
+
+/* Largest difference to the scalar kernels that is still considered a match. */
+#define MIXKERNELS_TOLERANCE		1e-6
+
+struct MixBenchmark
+{
+	const char *name;
+	bool supported;
+	double seconds;				/* CPU time spent rendering */
+	double maxError;			/* largest difference to the scalar output */
+};
+
+/* Renders the same synthetic voices through every kernel set. The voices
+   loop forever and never touch their envelopes, so they are mixed by the
+   kernels alone. */
+void BenchmarkMixKernels(float rate, int voices, int samples, MixBenchmark results[MIXKERNELS_Count]);
+}
+
+#endif
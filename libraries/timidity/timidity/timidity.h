@@ -60,6 +60,7 @@ struct Sample;
 typedef float sample_t;
 typedef float final_volume_t;
 class Instruments;
+struct MixKernels;
 
 enum
 {
@@ -187,6 +188,7 @@ struct Renderer
 	int adjust_panning_immediately;
 	int voices;
 	int lost_notes, cut_notes;
+	const MixKernels *kernels;
 public:
 	Renderer(float sample_rate, int voices, Instruments *instr);
 	~Renderer();
@@ -56,21 +56,22 @@ bool IsMPG123Present()
 #if !defined DYN_MPG123
 	return true;
 #else
-	static bool cached_result = false;
-	static bool done = false;
-
-	if (!done)
+	static const bool cached_result = []()
 	{
-		done = true;
 		auto abspath = module_progdir + "/" MPG123LIB;
-		cached_result = MPG123Module.Load({abspath.c_str(), MPG123LIB});
-	}
+		return MPG123Module.Load({abspath.c_str(), MPG123LIB});
+	}();
 	return cached_result;
 #endif
 }
 
 
-static bool inited = false;
+// mpg123_init must be called exactly once, before any thread uses the library.
+static bool InitMPG123()
+{
+	static const bool inited = IsMPG123Present() && mpg123_init() == MPG123_OK;
+	return inited;
+}
 
 
 off_t MPG123Decoder::file_lseek(void *handle, off_t offset, int whence)
@@ -114,12 +115,8 @@ MPG123Decoder::~MPG123Decoder()
 
 bool MPG123Decoder::open(MusicIO::FileInterface *reader)
 {
-    if(!inited)
-    {
-		if (!IsMPG123Present()) return false;
-		if(mpg123_init() != MPG123_OK) return false;
-		inited = true;
-    }
+    if(!InitMPG123())
+        return false;
 
 	Reader = reader;
 
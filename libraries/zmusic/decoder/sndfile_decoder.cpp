@@ -55,15 +55,13 @@ bool IsSndFilePresent()
 #if !defined DYN_SNDFILE
 	return true;
 #else
-	static bool cached_result = false;
-	static bool done = false;
-
-	if (!done)
+	// Sounds may get decoded on several threads at once, so let the
+	// compiler make sure the library gets loaded only once.
+	static const bool cached_result = []()
 	{
-		done = true;
 		auto abspath = module_progdir + "/" SNDFILELIB;
-		cached_result = SndFileModule.Load({abspath.c_str(), SNDFILELIB});
-	}
+		return SndFileModule.Load({abspath.c_str(), SNDFILELIB});
+	}();
 	return cached_result;
 #endif
 }
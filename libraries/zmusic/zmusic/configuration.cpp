@@ -327,6 +327,12 @@ DLL_EXPORT bool ChangeMusicSettingInt(EIntConfigKey key, MusInfo *currSong, int
 			ChangeAndReturn(adlConfig.adl_volume_model, value, pRealValue);
 			return devType() == MDEV_ADL;
 
+		case zmusic_adl_chip_threads: 
+			if (value < 0)
+				value = 0;
+			ChangeAndReturn(adlConfig.adl_chip_threads, value, pRealValue);
+			return devType() == MDEV_ADL;
+
 		case zmusic_fluid_reverb: 
 			if (currSong != NULL)
 				currSong->ChangeSettingInt("fluidsynth.synth.reverb.active", value);
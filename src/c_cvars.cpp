@@ -58,6 +58,7 @@
 
 #include "w_wad.h"
 #include "version.h"
+#include "stats.h"
 
 #define SHOULD_BLACKLIST(name) \
 	if (#name[0]==CurrentFindCVar[0]) \
@@ -79,6 +80,12 @@ bool FBaseCVar::m_UseCallback = false;
 
 FBaseCVar *CVars = NULL;
 
+// The name index for FindCVar. Like the name manager this must not have a
+// constructor because cvars get registered during static initialization.
+enum { CVAR_HASH_SIZE = 2048 };
+static FBaseCVar *CVarHash[CVAR_HASH_SIZE];
+unsigned CVarGeneration = 1;
+
 int cvar_defflags;
 
 FBaseCVar::FBaseCVar (const char *var_name, uint32_t flags, void (*callback)(FBaseCVar &))
@@ -105,12 +112,22 @@ FBaseCVar::FBaseCVar (const char *var_name, uint32_t flags, void (*callback)(FBa
 	Name = NULL;
 	inCallback = false;
 
+	m_Next = nullptr;
+	m_NextHash = nullptr;
+	m_NameIndex = NAME_None;
+
 	if (var_name)
 	{
 		C_AddTabCommand (var_name);
 		Name = copystring (var_name);
 		m_Next = CVars;
 		CVars = this;
+
+		m_NameIndex = FName(var_name).GetIndex();
+		FBaseCVar *&bucket = CVarHash[m_NameIndex & (CVAR_HASH_SIZE - 1)];
+		m_NextHash = bucket;
+		bucket = this;
+		CVarGeneration++;
 	}
 
 	if (var)
@@ -138,17 +155,25 @@ FBaseCVar::~FBaseCVar ()
 {
 	if (Name)
 	{
-		FBaseCVar *var, *prev;
-
-		var = FindCVar (Name, &prev);
-
-		if (var == this)
+		// Unlink this exact cvar. Searching by name would find the
+		// replacement if this one gets destroyed because of a redefinition.
+		for (FBaseCVar **link = &CVars; *link != nullptr; link = &(*link)->m_Next)
 		{
-			if (prev)
-				prev->m_Next = m_Next;
-			else
-				CVars = m_Next;
+			if (*link == this)
+			{
+				*link = m_Next;
+				break;
+			}
 		}
+		for (FBaseCVar **link = &CVarHash[m_NameIndex & (CVAR_HASH_SIZE - 1)]; *link != nullptr; link = &(*link)->m_NextHash)
+		{
+			if (*link == this)
+			{
+				*link = m_NextHash;
+				break;
+			}
+		}
+		CVarGeneration++;
 		C_RemoveTabCommand(Name);
 		delete[] Name;
 	}
@@ -1637,17 +1662,42 @@ void C_ForgetCVars (void)
 	CVarBackups.Clear();
 }
 
+//===========================================================================
+//
+// FindCVar
+//
+// Names are case insensitive, just like FNames, so the name index is used
+// as the hash key. A name that is not in the name table cannot belong to
+// any cvar.
+//
+//===========================================================================
+
+FBaseCVar *FindCVar (FName var_name)
+{
+	FBaseCVar *var = CVarHash[var_name.GetIndex() & (CVAR_HASH_SIZE - 1)];
+	while (var != nullptr && var->m_NameIndex != var_name.GetIndex())
+	{
+		var = var->m_NextHash;
+	}
+	return var;
+}
+
 FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev)
 {
 	FBaseCVar *var;
-	FBaseCVar *dummy;
 
 	if (var_name == NULL)
 		return NULL;
 
 	if (prev == NULL)
-		prev = &dummy;
+	{
+		// NAME_None is also returned for names that are not in the name table.
+		FName name(var_name, true);
+		if (name == NAME_None && stricmp(var_name, "None") != 0) return nullptr;
+		return FindCVar(name);
+	}
 
+	// Only the console commands want to know the predecessor, so they need to walk the list.
 	var = CVars;
 	*prev = NULL;
 	while (var)
@@ -1664,7 +1714,7 @@ DEFINE_ACTION_FUNCTION(_CVar, FindCVar)
 {
 	PARAM_PROLOGUE;
 	PARAM_NAME(name);
-	ACTION_RETURN_POINTER(FindCVar(name, nullptr));
+	ACTION_RETURN_POINTER(FindCVar(name));
 }
 
 DEFINE_ACTION_FUNCTION(_CVar, GetCVar)
@@ -1677,29 +1727,38 @@ DEFINE_ACTION_FUNCTION(_CVar, GetCVar)
 
 FBaseCVar *FindCVarSub (const char *var_name, int namelen)
 {
-	FBaseCVar *var;
-
 	if (var_name == NULL)
 		return NULL;
 
-	var = CVars;
-	while (var)
-	{
-		const char *probename = var->GetName ();
+	FName name(var_name, namelen, true);
+	if (name == NAME_None && (namelen != 4 || strnicmp(var_name, "None", 4) != 0)) return nullptr;
+	return FindCVar(name);
+}
 
-		if (strnicmp (probename, var_name, namelen) == 0 &&
-			probename[namelen] == 0)
-		{
-			break;
-		}
-		var = var->m_Next;
+FBaseCVar *GetCVar(int playernum, const char *cvarname)
+{
+	FName name(cvarname, true);
+	if (name == NAME_None && (cvarname == nullptr || stricmp(cvarname, "None") != 0)) return nullptr;
+	return GetCVar(playernum, name);
+}
+
+FBaseCVar *GetCVar(int playernum, FCVarHandle &handle)
+{
+	FBaseCVar *cvar = handle.Get();
+	if (cvar == nullptr || (cvar->GetFlags() & CVAR_IGNORE))
+	{
+		return nullptr;
 	}
-	return var;
+	if (cvar->GetFlags() & CVAR_USERINFO)
+	{
+		return GetUserCVar(playernum, handle.GetName());
+	}
+	return cvar;
 }
 
-FBaseCVar *GetCVar(int playernum, const char *cvarname)
+FBaseCVar *GetCVar(int playernum, FName cvarname)
 {
-	FBaseCVar *cvar = FindCVar(cvarname, nullptr);
+	FBaseCVar *cvar = FindCVar(cvarname);
 	// Either the cvar doesn't exist, or it's for a mod that isn't loaded, so return nullptr.
 	if (cvar == nullptr || (cvar->GetFlags() & CVAR_IGNORE))
 	{
@@ -1717,12 +1776,17 @@ FBaseCVar *GetCVar(int playernum, const char *cvarname)
 }
 
 FBaseCVar *GetUserCVar(int playernum, const char *cvarname)
+{
+	return GetUserCVar(playernum, FName(cvarname, true));
+}
+
+FBaseCVar *GetUserCVar(int playernum, FName cvarname)
 {
 	if ((unsigned)playernum >= MAXPLAYERS || !playeringame[playernum])
 	{
 		return nullptr;
 	}
-	FBaseCVar **cvar_p = players[playernum].userinfo.CheckKey(FName(cvarname, true));
+	FBaseCVar **cvar_p = players[playernum].userinfo.CheckKey(cvarname);
 	FBaseCVar *cvar;
 	if (cvar_p == nullptr || (cvar = *cvar_p) == nullptr || (cvar->GetFlags() & CVAR_IGNORE))
 	{
@@ -2149,3 +2213,106 @@ void C_GrabCVarDefaults ()
 		}
 	}
 }
+
+//===========================================================================
+//
+// CCMD bench_cvars
+//
+// Compares the name index against the plain list walk it replaced. More
+// cvars get created until there are 2000 of them to get a realistic number
+// of registered cvars for a heavily modded game.
+//
+//===========================================================================
+
+static FBaseCVar *FindCVarLinear(const char *var_name)
+{
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		if (stricmp(var->GetName(), var_name) == 0) return var;
+	}
+	return nullptr;
+}
+
+CCMD(bench_cvars)
+{
+	int numcvars = argv.argc() > 1 ? (int)strtoull(argv[1], nullptr, 10) : 2000;
+	int numlookups = 1000000;
+
+	TArray<FBaseCVar *> created;
+	TArray<FString> names;
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		names.Push(var->GetName());
+	}
+	for (int i = names.Size(); i < numcvars; i++)
+	{
+		FString name;
+		name.Format("bench_cvar_%d", i);
+		created.Push(C_CreateCVar(name, CVAR_Int, 0));
+		names.Push(name);
+	}
+
+	TArray<FName> fnames;
+	TArray<FCVarHandle> handles;
+	for (auto &name : names)
+	{
+		fnames.Push(FName(name));
+		handles.Push(FCVarHandle(fnames.Last()));
+	}
+
+	cycle_t linear, hashed, byname, byhandle;
+	linear.Reset();
+	hashed.Reset();
+	byname.Reset();
+	byhandle.Reset();
+	int mismatches = 0;
+	uintptr_t sum[4] = {};
+
+	linear.Clock();
+	for (int i = 0; i < numlookups; i++)
+	{
+		sum[0] += (uintptr_t)FindCVarLinear(names[i % names.Size()]);
+	}
+	linear.Unclock();
+
+	hashed.Clock();
+	for (int i = 0; i < numlookups; i++)
+	{
+		sum[1] += (uintptr_t)FindCVar(names[i % names.Size()], nullptr);
+	}
+	hashed.Unclock();
+
+	byname.Clock();
+	for (int i = 0; i < numlookups; i++)
+	{
+		sum[2] += (uintptr_t)FindCVar(fnames[i % fnames.Size()]);
+	}
+	byname.Unclock();
+
+	byhandle.Clock();
+	for (int i = 0; i < numlookups; i++)
+	{
+		sum[3] += (uintptr_t)handles[i % handles.Size()].Get();
+	}
+	byhandle.Unclock();
+
+	for (unsigned i = 0; i < names.Size(); i++)
+	{
+		if (FindCVar(names[i], nullptr) != FindCVarLinear(names[i])) mismatches++;
+	}
+
+	Printf("%d lookups with %u cvars:\n", numlookups, names.Size());
+	Printf("  list walk:    %8.3f ms\n", linear.TimeMS());
+	Printf("  by string:    %8.3f ms\n", hashed.TimeMS());
+	Printf("  by name:      %8.3f ms\n", byname.TimeMS());
+	Printf("  cached:       %8.3f ms\n", byhandle.TimeMS());
+	if (mismatches > 0 || sum[0] != sum[1] || sum[0] != sum[2] || sum[0] != sum[3])
+	{
+		Printf(TEXTCOLOR_RED "Lookup results differ (%d mismatches)\n", mismatches);
+	}
+
+	for (auto var : created)
+	{
+		delete var;
+	}
+}
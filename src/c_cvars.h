@@ -172,6 +172,8 @@ private:
 
 	void (*m_Callback)(FBaseCVar &);
 	FBaseCVar *m_Next;
+	FBaseCVar *m_NextHash;		// next cvar in the same bucket of the name index
+	int m_NameIndex;			// the name as an FName index, kept as plain int so that no name lookup is needed after the name table is gone
 
 	static bool m_UseCallback;
 	static bool m_DoNoSet;
@@ -181,6 +183,7 @@ private:
 	friend void C_ReadCVars (uint8_t **demo_p);
 	friend void C_BackupCVars (void);
 	friend FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev);
+	friend FBaseCVar *FindCVar (FName var_name);
 	friend FBaseCVar *FindCVarSub (const char *var_name, int namelen);
 	friend void UnlatchCVars (void);
 	friend void DestroyCVarsFlagged (uint32_t flags);
@@ -209,11 +212,52 @@ void C_BackupCVars (void);
 
 // Finds a named cvar
 FBaseCVar *FindCVar (const char *var_name, FBaseCVar **prev);
+FBaseCVar *FindCVar (FName var_name);
 FBaseCVar *FindCVarSub (const char *var_name, int namelen);
 
 // Used for ACS and DECORATE.
 FBaseCVar *GetCVar(int playernum, const char *cvarname);
+FBaseCVar *GetCVar(int playernum, FName cvarname);
 FBaseCVar *GetUserCVar(int playernum, const char *cvarname);
+FBaseCVar *GetUserCVar(int playernum, FName cvarname);
+
+// Changes every time a cvar gets created or destroyed.
+extern unsigned CVarGeneration;
+
+// A cvar lookup for code that needs the same cvar over and over again.
+// The lookup only gets repeated after the set of cvars has changed.
+class FCVarHandle
+{
+public:
+	FCVarHandle() = default;
+	FCVarHandle(FName name) : Name(name) {}
+
+	FCVarHandle &operator= (FName name)
+	{
+		Name = name;
+		Generation = 0;
+		return *this;
+	}
+
+	FName GetName() const { return Name; }
+
+	FBaseCVar *Get()
+	{
+		if (Generation != CVarGeneration)
+		{
+			Var = FindCVar(Name);
+			Generation = CVarGeneration;
+		}
+		return Var;
+	}
+
+private:
+	FName Name = NAME_None;
+	FBaseCVar *Var = nullptr;
+	unsigned Generation = 0;
+};
+
+FBaseCVar *GetCVar(int playernum, FCVarHandle &handle);
 
 // Create a new cvar with the specified name and type
 FBaseCVar *C_CreateCVar(const char *var_name, ECVarType var_type, uint32_t flags);
@@ -2217,6 +2217,14 @@ static void AddAutoloadFiles(const char *autoname)
 
 	}
 
+	// -vmbench loads the script workloads for the bench_vm console command.
+	if (Args->CheckParm("-vmbench"))
+	{
+		const char *benchwad = BaseFileSearch ("vmbench.pk3", NULL, true);
+		if (benchwad)
+			D_AddFile (allwads, benchwad);
+	}
+
 	if (!(gameinfo.flags & GI_SHAREWARE) && !Args->CheckParm("-noautoload") && !disableautoload)
 	{
 		FString file;
@@ -78,6 +78,7 @@
 #include "vm.h"
 #include "gstrings.h"
 #include "s_music.h"
+#include "stats.h"
 
 EXTERN_CVAR (Int, disableautosave)
 EXTERN_CVAR (Int, autosavecount)
@@ -121,6 +122,8 @@ bool			nodejustleft[MAXNETNODES];				// set when a node just left
 bool	 		remoteresend[MAXNETNODES];				// set when local needs tics
 int 			resendto[MAXNETNODES];					// set when remote needs tics
 int 			resendcount[MAXNETNODES];
+int				resendend[MAXNETNODES];					// end of a selective resend, 0 if none
+int				resumeto[MAXNETNODES];					// where to continue after a selective resend
 
 uint64_t		lastrecvtime[MAXPLAYERS];				// [RH] Used for pings
 uint64_t		currrecvtime[MAXPLAYERS];
@@ -195,6 +198,47 @@ static TArray<PacketStore> InBuffer;
 static TArray<PacketStore> OutBuffer;
 #endif
 
+// Traffic counters for the "net" stat and the netstats command. Together
+// with the net_sim* link simulation in i_net.cpp they allow measuring
+// netcode throughput and stall behavior on loopback.
+static struct NetTrafficStats
+{
+	uint64_t BytesSent;		// as compressed by the driver, see Net_CountWireBytes
+	uint64_t BytesReceived;
+	int PacketsSent;
+	int PacketsReceived;
+	int ResendRequests;		// packets sent asking another node to retransmit
+	int Resends;			// retransmit requests honored for other nodes
+	int StalledFrames;		// due tics that could not run for lack of input
+	int Tics;
+	cycle_t StallTime;		// time spent waiting for other nodes' tics
+
+	void Reset()
+	{
+		BytesSent = BytesReceived = 0;
+		PacketsSent = PacketsReceived = 0;
+		ResendRequests = Resends = 0;
+		StalledFrames = 0;
+		Tics = 0;
+		StallTime.Reset();
+	}
+} NetTraffic;
+
+// Packets that arrived ahead of a gap in a node's tic stream. Instead of
+// throwing them away and having the sender repeat everything from the gap
+// onward, they are kept until the missing tics have been resent and are then
+// processed as if they had just arrived. The retransmit request tells the
+// sender how long the gap is so that it only needs to resend that range.
+struct HeldPacket
+{
+	int StartTic;
+	int EndTic;
+	int Node;
+	TArray<uint8_t> Data;
+};
+
+static TArray<HeldPacket> HeldPackets;
+
 // [RH] Special "ticcmds" get stored in here
 static struct TicSpecial
 {
@@ -343,6 +387,9 @@ void Net_ClearBuffers ()
 	memset (remoteresend, 0, sizeof(remoteresend));
 	memset (resendto, 0, sizeof(resendto));
 	memset (resendcount, 0, sizeof(resendcount));
+	memset (resendend, 0, sizeof(resendend));
+	memset (resumeto, 0, sizeof(resumeto));
+	HeldPackets.Clear();
 	memset (lastrecvtime, 0, sizeof(lastrecvtime));
 	memset (currrecvtime, 0, sizeof(currrecvtime));
 	memset (consistancy, 0, sizeof(consistancy));
@@ -361,6 +408,7 @@ void Net_ClearBuffers ()
 	maketic = 0;
 
 	lastglobalrecvtime = 0;
+	NetTraffic.Reset();
 }
 
 //
@@ -377,7 +425,7 @@ int NetbufferSize ()
 	int k = 2, count, numtics;
 
 	if (netbuffer[0] & NCMD_RETRANSMIT)
-		k++;
+		k += 2;
 
 	if (NetMode == NET_PacketServer && doomcom.remotenode == nodeforplayer[Net_Arbitrator])
 		k++;
@@ -478,7 +526,10 @@ void HSendPacket (int node, int len)
 			}
 
 			if (netbuffer[0] & NCMD_RETRANSMIT)
-				realretrans = ExpandTics (netbuffer[k++]);
+			{
+				realretrans = ExpandTics (netbuffer[k]);
+				k += 2;
+			}
 			else
 				realretrans = -1;
 
@@ -523,6 +574,8 @@ void HSendPacket (int node, int len)
 	if (!netgame)
 		I_Error ("Tried to transmit to another node");
 
+	NetTraffic.PacketsSent++;
+
 #if SIMULATEERRORS
 	if (rand() < SIMULATEERRORS)
 	{
@@ -646,7 +699,10 @@ bool HGetPacket (void)
 			}
 
 			if (netbuffer[0] & NCMD_RETRANSMIT)
-				realretrans = ExpandTics (netbuffer[k++]);
+			{
+				realretrans = ExpandTics (netbuffer[k]);
+				k += 2;
+			}
 			else
 				realretrans = -1;
 
@@ -670,6 +726,8 @@ bool HGetPacket (void)
 		}
 	}
 
+	NetTraffic.PacketsReceived++;
+
 	if (doomcom.datalength != NetbufferSize ())
 	{
 		Printf("Bad packet length %i (calculated %i)\n",
@@ -757,6 +815,91 @@ void PlayerIsGone (int netnode, int netconsole)
 	}
 }
 
+//
+// HoldPacket
+// Keeps a packet that arrived ahead of a gap until the gap is filled
+//
+
+static void HoldPacket (int node, int starttic, int endtic)
+{
+	for (auto &held : HeldPackets)
+	{
+		if (held.Node == node && held.StartTic == starttic)
+		{
+			return;
+		}
+	}
+	if (HeldPackets.Size() >= BACKUPTICS)
+	{
+		return;
+	}
+	unsigned i = HeldPackets.Reserve(1);
+	HeldPacket &held = HeldPackets[i];
+	held.Node = node;
+	held.StartTic = starttic;
+	held.EndTic = endtic;
+	held.Data.Resize(doomcom.datalength);
+	memcpy(held.Data.Data(), netbuffer, doomcom.datalength);
+}
+
+//
+// HeldGap
+// Returns the number of tics missing before the first packet held
+// for a node, or 0 if nothing is being held.
+//
+
+static int HeldGap (int node)
+{
+	int gap = 0;
+	for (auto &held : HeldPackets)
+	{
+		if (held.Node == node && held.StartTic > nettics[node])
+		{
+			int g = held.StartTic - nettics[node];
+			if (gap == 0 || g < gap)
+			{
+				gap = g;
+			}
+		}
+	}
+	return MIN(gap, 255);
+}
+
+//
+// GetHeldPacket
+// Puts a held packet that can now be processed into the net buffer.
+// Returns false if there is none.
+//
+
+static bool GetHeldPacket (int &starttic)
+{
+	for (unsigned i = 0; i < HeldPackets.Size(); )
+	{
+		HeldPacket &held = HeldPackets[i];
+		int node = held.Node;
+
+		if (!nodeingame[node] || held.EndTic <= nettics[node])
+		{
+			// Node left or the tics already arrived some other way.
+			HeldPackets.Delete(i);
+		}
+		else if (held.StartTic <= nettics[node])
+		{
+			memcpy(netbuffer, held.Data.Data(), held.Data.Size());
+			doomcom.remotenode = node;
+			doomcom.datalength = held.Data.Size();
+			starttic = held.StartTic;
+			HeldPackets.Delete(i);
+			return true;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return false;
+}
+
 //
 // GetPackets
 //
@@ -769,11 +912,16 @@ void GetPackets (void)
 	int realstart;
 	int numtics;
 	int retransmitfrom;
+	int retransmitgap;
 	int k;
 	uint8_t playerbytes[MAXNETNODES];
 	int numplayers;
+	int heldstart;
+	bool replay;
 								 
-	while ( HGetPacket() )
+	// A held packet is processed again once its gap has been filled, but
+	// everything in it that describes the time it arrived is out of date.
+	while ( (replay = GetHeldPacket (heldstart)) || HGetPacket() )
 	{
 		if (netbuffer[0] & NCMD_SETUP)
 		{
@@ -791,8 +939,11 @@ void GetPackets (void)
 
 		// [RH] Get "ping" times - totally useless, since it's bound to the frequency
 		// packets go out at.
-		lastrecvtime[netconsole] = currrecvtime[netconsole];
-		currrecvtime[netconsole] = I_msTime ();
+		if (!replay)
+		{
+			lastrecvtime[netconsole] = currrecvtime[netconsole];
+			currrecvtime[netconsole] = I_msTime ();
+		}
 
 		// check for exiting the game
 		if (netbuffer[0] & NCMD_EXIT)
@@ -833,16 +984,20 @@ void GetPackets (void)
 			netconsole == Net_Arbitrator &&
 			netconsole != consoleplayer)
 		{
-			mastertics = ExpandTics (netbuffer[k++]);
+			if (!replay)
+				mastertics = ExpandTics (netbuffer[k]);
+			k++;
 		}
 
 		if (netbuffer[0] & NCMD_RETRANSMIT)
 		{
 			retransmitfrom = netbuffer[k++];
+			retransmitgap = netbuffer[k++];
 		}
 		else
 		{
 			retransmitfrom = 0;
+			retransmitgap = 0;
 		}
 
 		numtics = (netbuffer[0] & NCMD_XTICS);
@@ -862,7 +1017,9 @@ void GetPackets (void)
 		}
 
 		// Pull current network delay from node
-		netdelay[netnode][(nettics[netnode]+1) % BACKUPTICS] = netbuffer[k++];
+		if (!replay)
+			netdelay[netnode][(nettics[netnode]+1) % BACKUPTICS] = netbuffer[k];
+		k++;
 
 		playerbytes[0] = netconsole;
 		if (netbuffer[0] & NCMD_MULTI)
@@ -878,7 +1035,8 @@ void GetPackets (void)
 
 		// to save bytes, only the low byte of tic numbers are sent
 		// Figure out what the rest of the bytes are
-		realstart = ExpandTics (netbuffer[1]);
+		// (A held packet's low byte may have wrapped since it arrived.)
+		realstart = replay ? heldstart : ExpandTics (netbuffer[1]);
 		realend = (realstart + numtics);
 		
 		nodeforplayer[netconsole] = netnode;
@@ -886,12 +1044,26 @@ void GetPackets (void)
 		// check for retransmit request
 		if (resendcount[netnode] <= 0 && (netbuffer[0] & NCMD_RETRANSMIT))
 		{
-			resendto[netnode] = ExpandTics (retransmitfrom);
+			int from = ExpandTics (retransmitfrom);
+
+			// If the other side is only missing a range in the middle of what
+			// was already sent, resend just that and then pick up where we were.
+			if (retransmitgap > 0 && resendto[netnode] >= from + retransmitgap)
+			{
+				resumeto[netnode] = resendto[netnode];
+				resendend[netnode] = from + retransmitgap;
+			}
+			else
+			{
+				resendend[netnode] = 0;
+			}
+			resendto[netnode] = from;
+			NetTraffic.Resends++;
 			if (debugfile)
-				fprintf (debugfile,"retransmit from %i\n", resendto[netnode]);
+				fprintf (debugfile,"retransmit from %i to %i\n", resendto[netnode], resendend[netnode]);
 			resendcount[netnode] = RESENDCOUNT;
 		}
-		else
+		else if (!replay)
 		{
 			resendcount[netnode]--;
 		}
@@ -916,6 +1088,10 @@ void GetPackets (void)
 				fprintf (debugfile, "missed tics from %i (%i to %i)\n",
 						 netnode, nettics[netnode], realstart);
 			remoteresend[netnode] = true;
+			if (!(netbuffer[0] & (NCMD_RETRANSMIT | NCMD_QUITTERS)))
+			{
+				HoldPacket (netnode, realstart, realend);
+			}
 			continue;
 		}
 
@@ -1160,6 +1336,8 @@ void NetUpdate (void)
 		netbuffer[1] = realstart = resendto[i];
 		k = 2;
 
+		int sendend;
+
 		if (NetMode == NET_PacketServer &&
 			consoleplayer == Net_Arbitrator &&
 			i != 0)
@@ -1174,17 +1352,36 @@ void NetUpdate (void)
 			netbuffer[k++] = lowtic;
 		}
 
-		numtics = MAX(0, lowtic - realstart);
+		if (resendend[i] > realstart)
+		{
+			// Selective resend: only fill the gap the other node reported.
+			sendend = MIN(lowtic, resendend[i]);
+		}
+		else
+		{
+			sendend = lowtic;
+		}
+
+		numtics = MAX(0, sendend - realstart);
 		if (numtics > BACKUPTICS)
 			I_Error ("NetUpdate: Node %d missed too many tics", i);
 
-		switch (net_extratic)
+		if (resendend[i] > realstart)
 		{
-		case 0:
-		default: 
-			resendto[i] = lowtic; break;
-		case 1: resendto[i] = MAX(0, lowtic - 1); break;
-		case 2: resendto[i] = nettics[i]; break;
+			resendto[i] = resumeto[i];
+			resendend[i] = 0;
+		}
+		else
+		{
+			resendend[i] = 0;
+			switch (net_extratic)
+			{
+			case 0:
+			default: 
+				resendto[i] = lowtic; break;
+			case 1: resendto[i] = MAX(0, lowtic - 1); break;
+			case 2: resendto[i] = nettics[i]; break;
+			}
 		}
 
 		if (numtics == 0 && resendOnly && !remoteresend[i] && nettics[i])
@@ -1194,8 +1391,10 @@ void NetUpdate (void)
 
 		if (remoteresend[i])
 		{
+			NetTraffic.ResendRequests++;
 			netbuffer[0] |= NCMD_RETRANSMIT;
 			netbuffer[k++] = nettics[i];
+			netbuffer[k++] = HeldGap (i);
 		}
 
 		if (numtics < 3)
@@ -1883,6 +2082,8 @@ void TryRunTics (void)
 	// get real tics
 	if (doWait)
 	{
+		// Give the collector the time that would otherwise be slept away.
+		GC::IdleStep (I_msUntilTic (oldentertics));
 		entertic = I_WaitForTic (oldentertics);
 	}
 	else
@@ -1930,6 +2131,9 @@ void TryRunTics (void)
 	// Uncapped framerate needs seprate checks
 	if (counts == 0 && !doWait)
 	{
+		// Only a tic that is due but cannot run for lack of input is a stall.
+		// Frames rendered in between tics are not.
+		if (netgame && realtics >= 1) NetTraffic.StalledFrames++;
 		TicStabilityWait();
 
 		// Check possible stall conditions
@@ -1954,6 +2158,11 @@ void TryRunTics (void)
 				 realtics, availabletics, counts);
 
 	// wait for new tics if needed
+	bool stalled = lowtic < gametic + counts;
+	if (stalled)
+	{
+		NetTraffic.StallTime.Clock();
+	}
 	while (lowtic < gametic + counts)
 	{
 		NetUpdate ();
@@ -1978,6 +2187,8 @@ void TryRunTics (void)
 		// don't stay in here forever -- give the menu a chance to work
 		if (I_GetTime () - entertic >= 1)
 		{
+			NetTraffic.StallTime.Unclock();
+			NetTraffic.StalledFrames++;
 			C_Ticker ();
 			M_Ticker ();
 			// Repredict the player for new buffered movement
@@ -1987,6 +2198,11 @@ void TryRunTics (void)
 		}
 	}
 
+	if (stalled)
+	{
+		NetTraffic.StallTime.Unclock();
+	}
+
 	//Tic lowtic is high enough to process this gametic. Clear all possible waiting info
 	hadlate = false;
 	for (i = 0; i < MAXPLAYERS; i++)
@@ -2013,6 +2229,7 @@ void TryRunTics (void)
 			M_Ticker ();
 			G_Ticker();
 			gametic++;
+			NetTraffic.Tics++;
 
 			NetUpdate ();	// check for new console commands
 			TicStabilityEnd();
@@ -2973,6 +3190,64 @@ CCMD (pings)
 					players[i].userinfo.GetName());
 }
 
+//==========================================================================
+//
+// Net_CountWireBytes
+//
+// The driver compresses packets, so only it knows how big they really are.
+//
+//==========================================================================
+
+void Net_CountWireBytes(int sent, int received)
+{
+	NetTraffic.BytesSent += sent;
+	NetTraffic.BytesReceived += received;
+}
+
+//==========================================================================
+//
+// STAT net
+//
+// Traffic and stall counters since the game started or netstats reset.
+//
+//==========================================================================
+
+ADD_STAT (net)
+{
+	FString out;
+	int tics = MAX(NetTraffic.Tics, 1);
+	out.Format("Sent: %d pkts %.1f B/tic  Recv: %d pkts %.1f B/tic  Resend req: %d  Resent: %d  Stalls: %d (%.2f ms/tic)",
+		NetTraffic.PacketsSent, double(NetTraffic.BytesSent) / tics,
+		NetTraffic.PacketsReceived, double(NetTraffic.BytesReceived) / tics,
+		NetTraffic.ResendRequests, NetTraffic.Resends,
+		NetTraffic.StalledFrames, NetTraffic.StallTime.TimeMS() / tics);
+	return out;
+}
+
+//==========================================================================
+//
+// CCMD netstats
+//
+//==========================================================================
+
+CCMD (netstats)
+{
+	if (argv.argc() > 1 && stricmp(argv[1], "reset") == 0)
+	{
+		NetTraffic.Reset();
+		return;
+	}
+	int tics = MAX(NetTraffic.Tics, 1);
+	Printf("%d tics run\n", NetTraffic.Tics);
+	Printf("Sent:     %d packets, %" PRIu64 " bytes (%.1f bytes/tic)\n",
+		NetTraffic.PacketsSent, NetTraffic.BytesSent, double(NetTraffic.BytesSent) / tics);
+	Printf("Received: %d packets, %" PRIu64 " bytes (%.1f bytes/tic)\n",
+		NetTraffic.PacketsReceived, NetTraffic.BytesReceived, double(NetTraffic.BytesReceived) / tics);
+	Printf("Resend requests: %d, resends: %d\n", NetTraffic.ResendRequests, NetTraffic.Resends);
+	Printf("Stalled frames: %d, stall time: %.2f ms (%.2f ms/tic)\n",
+		NetTraffic.StalledFrames, NetTraffic.StallTime.TimeMS(), NetTraffic.StallTime.TimeMS() / tics);
+}
+
 //==========================================================================
 //
 // Network_Controller
@@ -122,6 +122,9 @@ void TryRunTics (void);
 //Use for checking to see if the netgame has stalled
 void Net_CheckLastReceived(int);
 
+// Called by the network driver with the size of each packet on the wire
+void Net_CountWireBytes(int sent, int received);
+
 // [RH] Functions for making and using special "ticcmds"
 void Net_NewMakeTic ();
 void Net_WriteByte (uint8_t);
@@ -160,7 +163,8 @@ extern	int 			ticdup;
 //  One byte with following flags.
 //  One byte with starttic
 //  One byte with master's maketic (master -> slave only!)
-//  If NCMD_RETRANSMIT set, one byte with retransmitfrom
+//  If NCMD_RETRANSMIT set, one byte with retransmitfrom followed by one byte
+//     with the length of the gap to fill (0 = resend everything from there)
 //  If NCMD_XTICS set, one byte with number of tics (minus 3, so theoretically up to 258 tics in one packet)
 //  If NCMD_QUITTERS, one byte with number of players followed by one byte with each player's consolenum
 //  If NCMD_MULTI, one byte with number of players followed by one byte with each player's consolenum
@@ -67,6 +67,7 @@
 #include "sbar.h"
 #include "stats.h"
 #include "c_dispatch.h"
+#include "c_cvars.h"
 #include "s_sndseq.h"
 #include "r_data/r_interpolate.h"
 #include "doomstat.h"
@@ -77,6 +78,7 @@
 #include "textures/textures.h"
 #include "r_utility.h"
 #include "menu/menu.h"
+#include "i_time.h"
 #include "intermission/intermission.h"
 #include "g_levellocals.h"
 #include "events.h"
@@ -118,6 +120,15 @@
 // Cost of calling of one destructor
 #define GCFINALIZECOST	100
 
+// Number of single steps between clock reads when running on a time budget
+#define GCCLOCKSTEPS	16
+
+// Time left unused before the next tic when collecting while idle (ms)
+#define GCIDLEMARGIN	1.0
+
+// Number of buckets in the step time histogram
+#define GCTIMEBUCKETS	8
+
 // TYPES -------------------------------------------------------------------
 
 // This object is responsible for marking sectors during the propagate
@@ -146,6 +157,12 @@ static size_t CalcStepSize();
 
 // EXTERNAL DATA DECLARATIONS ----------------------------------------------
 
+// Milliseconds per tic to spend on collection. 0 paces by allocation alone.
+CVAR(Float, gc_budget, 0.f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Continue collections in the time left before the next tic.
+CVAR(Bool, gc_idle, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 extern DThinker *NextToThink;
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
@@ -174,6 +191,48 @@ static int LastCollectTime;		// Time last time collector finished
 static size_t LastCollectAlloc;	// Memory allocation when collector finished
 static size_t MinStepSize;		// Cover at least this much memory per step
 
+// Small objects are carved out of fixed-size blocks in larger chunks so that
+// the steady churn of actors and thinkers does not hit the system allocator
+// every time. Each block starts with a header that says where it came from.
+enum
+{
+	POOL_GRANULARITY = 32,
+	POOL_MAXSIZE = 4096,
+	POOL_NUMCLASSES = POOL_MAXSIZE / POOL_GRANULARITY,
+	POOL_CHUNKSIZE = 65536,
+	POOL_MINBLOCKS = 8
+};
+
+struct alignas(16) FPoolChunk
+{
+	FPoolChunk *Next;
+	size_t Used;				// Blocks currently handed out
+	size_t Size;				// Bytes allocated for the chunk
+};
+
+struct alignas(16) FObjectHeader
+{
+	FPoolChunk *Chunk;			// nullptr if allocated outside the pools
+	size_t SizeClass;
+};
+
+struct FObjectPool
+{
+	FPoolChunk *Chunks;
+	void *FreeList;				// Linked through the first word of each block
+};
+
+static FObjectPool Pools[POOL_NUMCLASSES];
+static size_t PoolBytes;		// Memory held by all pool chunks
+static size_t PoolUsedBytes;	// Memory in pool blocks that hold objects
+static uint64_t ObjectAllocs;	// Objects allocated since startup
+
+static double Throughput[GCS_Finalize + 1];	// Measured work units per ms for each state
+static const double StepTimeLimits[GCTIMEBUCKETS - 1] = { 0.1, 0.25, 0.5, 1, 2, 4, 8 };
+static unsigned StepTimes[GCTIMEBUCKETS];	// Histogram of time spent in Step()
+static double MaxStepTime;
+static double IdleTime;			// Time spent collecting while idle
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -487,6 +546,97 @@ static size_t SingleStep()
 	}
 }
 
+//==========================================================================
+//
+// UpdateThroughput
+//
+// Folds a measurement of how much work was done in how much time into the
+// running average for a collector state.
+//
+//==========================================================================
+
+static void UpdateThroughput(EGCState state, size_t work, uint64_t ns)
+{
+	// Very short intervals are mostly clock noise.
+	if (ns < 20'000)
+	{
+		return;
+	}
+	double rate = work * 1'000'000. / ns;
+	Throughput[state] = Throughput[state] > 0 ? Throughput[state] * 0.75 + rate * 0.25 : rate;
+}
+
+//==========================================================================
+//
+// TimedSteps
+//
+// Performs single steps until the given amount of work is done, the
+// deadline has passed or the collection is finished. The clock is only
+// read every few steps. Returns the amount of work done.
+//
+//==========================================================================
+
+static size_t TimedSteps(size_t work, uint64_t deadline)
+{
+	size_t total = 0;
+	size_t slice = 0;
+	int count = 0;
+	EGCState state = State;
+	uint64_t last = I_nsTime();
+
+	do
+	{
+		size_t done = SingleStep();
+		total += done;
+		slice += done;
+		if (++count == GCCLOCKSTEPS || State != state)
+		{
+			uint64_t now = I_nsTime();
+			UpdateThroughput(state, slice, now - last);
+			last = now;
+			slice = 0;
+			count = 0;
+			state = State;
+			if (now >= deadline)
+			{
+				break;
+			}
+		}
+	} while (total < work && State != GCS_Pause);
+	return total;
+}
+
+//==========================================================================
+//
+// FallingBehind
+//
+// True if memory has grown so far past the point where this collection
+// started that the time budget has to be ignored to catch up.
+//
+//==========================================================================
+
+static bool FallingBehind()
+{
+	return State != GCS_Pause && AllocBytes > (Estimate / 100) * Pause * 2;
+}
+
+//==========================================================================
+//
+// RecordStepTime
+//
+//==========================================================================
+
+static void RecordStepTime(double ms)
+{
+	int i = 0;
+	while (i < GCTIMEBUCKETS - 1 && ms >= StepTimeLimits[i])
+	{
+		i++;
+	}
+	StepTimes[i]++;
+	MaxStepTime = MAX(MaxStepTime, ms);
+}
+
 //==========================================================================
 //
 // Step
@@ -498,12 +648,22 @@ static size_t SingleStep()
 
 void Step()
 {
+	uint64_t start = I_nsTime();
+
 	// We recalculate a step size in case the rate of allocation went up
 	// since we started sweeping because we don't want to fall behind.
 	// However, we also don't want to go slower than what was decided upon
 	// when the sweep began if the rate of allocation has slowed.
 	size_t lim = MAX(CalcStepSize(), MinStepSize);
-	do
+	if (gc_budget > 0 && !FallingBehind())
+	{
+		// Do as much as fits in the budget, judging by how fast the
+		// collector has been going lately.
+		double rate = Throughput[State];
+		size_t work = rate > 0 ? MAX<size_t>(GCSTEPSIZE, size_t(rate * gc_budget)) : std::numeric_limits<size_t>::max() / 2;
+		TimedSteps(work, start + uint64_t(gc_budget * 1'000'000.));
+	}
+	else do
 	{
 		size_t done = SingleStep();
 		if (done < lim)
@@ -525,6 +685,38 @@ void Step()
 		SetThreshold();
 	}
 	StepCount++;
+	RecordStepTime((I_nsTime() - start) / 1'000'000.);
+}
+
+//==========================================================================
+//
+// IdleStep
+//
+// Uses spare time before the next tic to get ahead on a collection that
+// is already running, so fewer of the per-tic steps are needed later.
+//
+//==========================================================================
+
+void IdleStep(double ms)
+{
+	if (!gc_idle || State == GCS_Pause)
+	{
+		return;
+	}
+	ms -= GCIDLEMARGIN;
+	if (ms <= 0)
+	{
+		return;
+	}
+	uint64_t start = I_nsTime();
+	double rate = Throughput[State];
+	size_t work = rate > 0 ? MAX<size_t>(GCSTEPSIZE, size_t(rate * ms)) : std::numeric_limits<size_t>::max() / 2;
+	TimedSteps(work, start + uint64_t(ms * 1'000'000.));
+	if (State == GCS_Pause)
+	{
+		SetThreshold();
+	}
+	IdleTime += (I_nsTime() - start) / 1'000'000.;
 }
 
 //==========================================================================
@@ -556,6 +748,7 @@ void FullGC()
 		SingleStep();
 	}
 	SetThreshold();
+	TrimPools();
 }
 
 //==========================================================================
@@ -674,6 +867,154 @@ void DelSoftRoot(DObject *obj)
 	}
 }
 
+//==========================================================================
+//
+// NewPoolChunk
+//
+// Adds a chunk to a pool and puts all of its blocks on the free list.
+//
+//==========================================================================
+
+static void NewPoolChunk(FObjectPool &pool, size_t sizeclass)
+{
+	size_t stride = sizeof(FObjectHeader) + (sizeclass + 1) * POOL_GRANULARITY;
+	size_t count = MAX<size_t>(POOL_MINBLOCKS, (POOL_CHUNKSIZE - sizeof(FPoolChunk)) / stride);
+	size_t bytes = sizeof(FPoolChunk) + count * stride;
+	FPoolChunk *chunk = (FPoolChunk *)malloc(bytes);
+
+	if (chunk == nullptr)
+	{
+		I_FatalError("Could not allocate %zu bytes for object pool", bytes);
+	}
+	chunk->Next = pool.Chunks;
+	chunk->Used = 0;
+	chunk->Size = bytes;
+	pool.Chunks = chunk;
+	PoolBytes += bytes;
+
+	// Link the blocks back to front so they get handed out in address order.
+	uint8_t *block = (uint8_t *)(chunk + 1) + (count - 1) * stride;
+	for (size_t i = 0; i < count; ++i, block -= stride)
+	{
+		FObjectHeader *header = (FObjectHeader *)block;
+		header->Chunk = chunk;
+		header->SizeClass = sizeclass;
+		*(void **)(header + 1) = pool.FreeList;
+		pool.FreeList = header + 1;
+	}
+}
+
+//==========================================================================
+//
+// AllocObject
+//
+// Allocates memory for an object. Anything larger than the biggest size
+// class goes straight to M_Malloc.
+//
+//==========================================================================
+
+void *AllocObject(size_t size)
+{
+	ObjectAllocs++;
+	if (size > POOL_MAXSIZE)
+	{
+		FObjectHeader *header = (FObjectHeader *)M_Malloc(sizeof(FObjectHeader) + size);
+		header->Chunk = nullptr;
+		header->SizeClass = 0;
+		return header + 1;
+	}
+
+	size_t sizeclass = size == 0 ? 0 : (size - 1) / POOL_GRANULARITY;
+	FObjectPool &pool = Pools[sizeclass];
+
+	if (pool.FreeList == nullptr)
+	{
+		NewPoolChunk(pool, sizeclass);
+	}
+	void *mem = pool.FreeList;
+	pool.FreeList = *(void **)mem;
+	((FObjectHeader *)mem - 1)->Chunk->Used++;
+
+	size_t blocksize = (sizeclass + 1) * POOL_GRANULARITY;
+	PoolUsedBytes += blocksize;
+	AllocBytes += blocksize;
+	return mem;
+}
+
+//==========================================================================
+//
+// FreeObject
+//
+//==========================================================================
+
+void FreeObject(void *mem)
+{
+	if (mem == nullptr)
+	{
+		return;
+	}
+	FObjectHeader *header = (FObjectHeader *)mem - 1;
+	if (header->Chunk == nullptr)
+	{
+		M_Free(header);
+		return;
+	}
+
+	FObjectPool &pool = Pools[header->SizeClass];
+	header->Chunk->Used--;
+	*(void **)mem = pool.FreeList;
+	pool.FreeList = mem;
+
+	size_t blocksize = (header->SizeClass + 1) * POOL_GRANULARITY;
+	PoolUsedBytes -= blocksize;
+	AllocBytes -= blocksize;
+}
+
+//==========================================================================
+//
+// TrimPools
+//
+// Gives chunks without any live objects back to the system. Called after
+// a full collection, which is when most of them become empty.
+//
+//==========================================================================
+
+void TrimPools()
+{
+	for (auto &pool : Pools)
+	{
+		// Unlink the free blocks that belong to empty chunks first.
+		void **link = &pool.FreeList;
+		while (*link != nullptr)
+		{
+			if (((FObjectHeader *)*link - 1)->Chunk->Used == 0)
+			{
+				*link = *(void **)*link;
+			}
+			else
+			{
+				link = (void **)*link;
+			}
+		}
+
+		FPoolChunk **probe = &pool.Chunks;
+		while (*probe != nullptr)
+		{
+			FPoolChunk *chunk = *probe;
+			if (chunk->Used == 0)
+			{
+				*probe = chunk->Next;
+				PoolBytes -= chunk->Size;
+				free(chunk);
+			}
+			else
+			{
+				probe = &chunk->Next;
+			}
+		}
+	}
+}
+
 }
 
 //==========================================================================
@@ -770,6 +1111,50 @@ ADD_STAT(gc)
 		(GC::Estimate + 1023) >> 10,
 		GC::StepCount,
 		(GC::MinStepSize + 1023) >> 10);
+
+	// Allocation rate, averaged over about a second.
+	static uint64_t LastAllocs, LastTime;
+	static uint64_t AllocRate;
+	uint64_t now = I_msTime();
+	if (now - LastTime >= 1000)
+	{
+		AllocRate = (GC::ObjectAllocs - LastAllocs) * 1000 / (now - LastTime);
+		LastAllocs = GC::ObjectAllocs;
+		LastTime = now;
+	}
+	out.AppendFormat("\nPools:%6zuK  Used:%6zuK  Objects/s: %llu",
+		(GC::PoolBytes + 1023) >> 10,
+		(GC::PoolUsedBytes + 1023) >> 10,
+		(unsigned long long)AllocRate);
+	return out;
+}
+
+//==========================================================================
+//
+// STAT gctime
+//
+// Shows how long the collection steps took and how fast the collector
+// goes through objects.
+//
+//==========================================================================
+
+ADD_STAT(gctime)
+{
+	FString out = "Steps:";
+	for (int i = 0; i < GCTIMEBUCKETS; ++i)
+	{
+		if (i < GCTIMEBUCKETS - 1)
+		{
+			out.AppendFormat("  <%gms:%u", GC::StepTimeLimits[i], GC::StepTimes[i]);
+		}
+		else
+		{
+			out.AppendFormat("  >=%gms:%u", GC::StepTimeLimits[i - 1], GC::StepTimes[i]);
+		}
+	}
+	out.AppendFormat("\nMax:%.2fms  Idle:%.1fms  Mark:%.0f/ms  Sweep:%.0f/ms",
+		GC::MaxStepTime, GC::IdleTime,
+		GC::Throughput[GC::GCS_Propagate], GC::Throughput[GC::GCS_Sweep]);
 	return out;
 }
 
@@ -785,7 +1170,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|count|resettimes|pause [size]|stepmul [size]\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -806,6 +1191,12 @@ CCMD(gc)
 		for (DObject *obj = GC::Root; obj; obj = obj->ObjNext, cnt++);
 		Printf("%d active objects counted\n", cnt);
 	}
+	else if (stricmp(argv[1], "resettimes") == 0)
+	{
+		memset(GC::StepTimes, 0, sizeof(GC::StepTimes));
+		GC::MaxStepTime = 0;
+		GC::IdleTime = 0;
+	}
 	else if (stricmp(argv[1], "pause") == 0)
 	{
 		if (argv.argc() == 2)
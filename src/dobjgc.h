@@ -84,9 +84,21 @@ namespace GC
 	// Does one collection step.
 	void Step();
 
+	// Continues a running collection for at most the given milliseconds.
+	void IdleStep(double ms);
+
 	// Does a complete collection.
 	void FullGC();
 
+	// Allocates memory for an object. Small objects come from size-class pools.
+	void *AllocObject(size_t size);
+
+	// Returns memory obtained from AllocObject.
+	void FreeObject(void *mem);
+
+	// Releases pool chunks that no longer hold any live objects.
+	void TrimPools();
+
 	// Handles the grunt work for a write barrier.
 	void Barrier(DObject *pointing, DObject *pointed);
 
@@ -41,6 +41,8 @@
 #include "a_staticgeombaker.h"
 #include "g_levellocals.h"
 #include "p_tags.h"
+#include "md5.h"
+#include "files.h"
 
 #ifdef _WIN32
 #include <direct.h>
@@ -51,6 +53,12 @@
 
 EXTERN_CVAR(Int, r_fakecontrast)
 
+// Increase this whenever the generated output changes, so that existing bakes get redone.
+static const int BAKE_VERSION = 1;
+static const char* BAKE_MANIFEST = "MdlDump/staticgeom.manifest";
+static const char* BAKE_MODEL_DIR = "MdlDump/Models/GeomDump/";
+static const char* BAKE_ACTOR_PREFIX = "StaticGeomDump_";
+
 //==========================================================================
 //
 // FILE HELPERS
@@ -1047,6 +1055,9 @@ void StaticGeometryBaker::GenerateFlatGeometry(const FString& texName, int light
 
 void StaticGeometryBaker::GetTextureLightKeys(TArray<FString>& output)
 {
+	// Names of an up-to-date bake that was skipped
+	output.Append(cachedActorKeys);
+
 	TMap<FString, TMap<int, StaticGeometryBuffer>>::Iterator texIt(staticGeometryData);
 	TMap<FString, TMap<int, StaticGeometryBuffer>>::Pair* texPair;
 
@@ -1063,7 +1074,7 @@ void StaticGeometryBaker::GetTextureLightKeys(TArray<FString>& output)
 			int light = lightPair->Key;
 			FString lightPart;
 			lightPart.Format("_L%03d", light);
-			output.Push("StaticGeomDump_" + CleanTextureName(textureName) + lightPart);
+			output.Push(BAKE_ACTOR_PREFIX + CleanTextureName(textureName) + lightPart);
 		}
 	}
 }
@@ -2279,6 +2290,126 @@ void StaticGeometryBaker::GenerateStaticFiles()
 	}
 }
 
+//==========================================================================
+//
+// BAKE CACHE
+//
+// The output only changes when the map, the size of the textures it uses,
+// the MAPINFO lighting and panning settings or the baker settings change,
+// so a previous bake of the same map can be reused as is. The manifest records the key of the bake that is on disk
+// and the actors it defined.
+//
+//==========================================================================
+
+FString StaticGeometryBaker::CalculateBakeKey()
+{
+	MD5Context md5;
+	int settings[] =
+	{
+		BAKE_VERSION, r_fakecontrast,
+		// Level settings from MAPINFO that the fake contrast and texture panning depend on.
+		int(level.flags2 & LEVEL2_SMOOTHLIGHTING), int(level.flags3 & (LEVEL3_FORCEFAKECONTRAST | LEVEL3_FORCEWORLDPANNING)),
+		int(level.WallHorizLight), int(level.WallVertLight)
+	};
+	md5.Update((const uint8_t*)settings, sizeof(settings));
+	md5.Update(level.md5, sizeof(level.md5));
+
+	// Texture names and sizes go into the output but are not part of the map lumps.
+	auto addTexture = [&](FTextureID texID)
+	{
+		FTexture* tex = texID.isNull() ? nullptr : TexMan[texID];
+		if (!tex)
+		{
+			md5.Update((const uint8_t*)"", 1);
+			return;
+		}
+		md5.Update((const uint8_t*)tex->Name.GetChars(), tex->Name.Len() + 1);
+		int size[2] = { tex->GetWidth(), tex->GetHeight() };
+		md5.Update((const uint8_t*)size, sizeof(size));
+	};
+	for (unsigned i = 0; i < level.sectors.Size(); i++)
+	{
+		addTexture(level.sectors[i].GetTexture(sector_t::floor));
+		addTexture(level.sectors[i].GetTexture(sector_t::ceiling));
+	}
+	for (unsigned i = 0; i < level.sides.Size(); i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			addTexture(level.sides[i].GetTexture(j));
+		}
+	}
+
+	uint8_t digest[16];
+	md5.Final(digest);
+	FString key;
+	for (auto b : digest) key.AppendFormat("%02x", b);
+	return key;
+}
+
+bool StaticGeometryBaker::LoadBakeManifest(const FString& key)
+{
+	if (!FileExists("MdlDump/decorate.staticgeomdmp") || !FileExists("MdlDump/modeldef.staticgeomdmp")) return false;
+
+	FileReader fr;
+	if (!fr.OpenFile(BAKE_MANIFEST)) return false;
+	auto data = fr.Read();
+	FString content((const char*)data.Data(), data.Size());
+
+	// First line is the key, then one actor name per line.
+	TArray<FString> names;
+	long pos = 0;
+	while (pos < (long)content.Len())
+	{
+		long end = content.IndexOf('\n', pos);
+		if (end < 0) end = content.Len();
+		FString line = content.Mid(pos, end - pos);
+		line.StripRight();
+		if (line.IsNotEmpty()) names.Push(line);
+		pos = end + 1;
+	}
+	if (names.Size() == 0 || names[0].Compare(key) != 0) return false;
+
+	// The cached definitions are only usable if every model they refer to is still there.
+	size_t prefixlen = strlen(BAKE_ACTOR_PREFIX);
+	for (unsigned i = 1; i < names.Size(); i++)
+	{
+		if (strncmp(names[i], BAKE_ACTOR_PREFIX, prefixlen) != 0)
+		{
+			DPrintf(DMSG_WARNING, "%s: entry %u (%s) is not a static geometry actor, baking again\n", BAKE_MANIFEST, i, names[i].GetChars());
+			return false;
+		}
+		FString objfile;
+		objfile.Format("%s%s.obj", BAKE_MODEL_DIR, names[i].GetChars() + prefixlen);
+		if (!FileExists(objfile))
+		{
+			DPrintf(DMSG_WARNING, "%s: model %s for entry %u (%s) is missing, baking again\n", BAKE_MANIFEST, objfile.GetChars(), i, names[i].GetChars());
+			return false;
+		}
+	}
+
+	names.Delete(0);
+	cachedActorKeys = std::move(names);
+	return true;
+}
+
+void StaticGeometryBaker::WriteBakeManifest(const FString& key)
+{
+	TArray<FString> names;
+	GetTextureLightKeys(names);
+
+	FileWriter* file = FileWriter::Open(BAKE_MANIFEST);
+	if (file)
+	{
+		file->Printf("%s\n", key.GetChars());
+		for (auto& name : names)
+		{
+			file->Printf("%s\n", name.GetChars());
+		}
+		delete file;
+	}
+}
+
 //==========================================================================
 //
 // MAIN BAKE FUNCTION
@@ -2291,6 +2422,16 @@ void StaticGeometryBaker::Bake()
 	baked = true;
 	bakedLinedefs.Clear();
 	staticGeometryData.Clear();
+	cachedActorKeys.Clear();
+
+	FString bakeKey = CalculateBakeKey();
+	if (LoadBakeManifest(bakeKey))
+	{
+		DPrintf(DMSG_NOTIFY, "Static geometry bake is up to date, skipping\n");
+		return;
+	}
+	// The files are about to be overwritten, so the old manifest no longer describes them.
+	remove(BAKE_MANIFEST);
 
 	// Process all sectors FIRST
 	// This is when slopes are read from sector planes
@@ -2320,7 +2461,7 @@ void StaticGeometryBaker::Bake()
 	Process3DFloorWalls();
 
 	// Write OBJ files
-	FString baseDir = "MdlDump/Models/GeomDump/";
+	FString baseDir = BAKE_MODEL_DIR;
 	EnsureDirectoryExists("MdlDump");
 	EnsureDirectoryExists("MdlDump/Models");
 	EnsureDirectoryExists(baseDir);
@@ -2362,6 +2503,7 @@ void StaticGeometryBaker::Bake()
 
 	// Generate DECORATE and MODELDEF
 	GenerateStaticFiles();
+	WriteBakeManifest(bakeKey);
 }
 
 // Global instance
@@ -48,6 +48,11 @@ private:
 	void GenerateDecorateContent(FString& content);
 	void GenerateModelDefContent(FString& content);
 
+	// Bake cache
+	FString CalculateBakeKey();
+	bool LoadBakeManifest(const FString& key);
+	void WriteBakeManifest(const FString& key);
+
 
 	// Ear clipping structures and helpers
 	struct EarClipVertex
@@ -155,6 +160,7 @@ private:
 	bool baked = false;
 	TArray<line_t*> bakedLinedefs;
 	TMap<FString, TMap<int, StaticGeometryBuffer>> staticGeometryData;
+	TArray<FString> cachedActorKeys;
 };
 
 // Global instance
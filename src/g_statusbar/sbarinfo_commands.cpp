@@ -1180,10 +1180,11 @@ class CommandDrawNumber : public CommandDrawString
 							sc.MustGetToken(TK_Identifier);
 						
 						cvarName = sc.String;
+						cvarHandle = FName(cvarName);
 
 						// We have a name, but make sure it exists. If not, send notification so modders
 						// are aware of the situation.
-						FBaseCVar *CVar = FindCVar(cvarName, nullptr);
+						FBaseCVar *CVar = cvarHandle.Get();
 
 						if (CVar != nullptr)
 						{
@@ -1484,7 +1485,7 @@ class CommandDrawNumber : public CommandDrawString
 					break;
 				case INTCVAR:
 				{
-					FBaseCVar *CVar = GetCVar(int(statusBar->CPlayer - players), cvarName);
+					FBaseCVar *CVar = GetCVar(int(statusBar->CPlayer - players), cvarHandle);
 					if (CVar != nullptr)
 					{
 						ECVarType cvartype = CVar->GetRealType();
@@ -1602,6 +1603,7 @@ class CommandDrawNumber : public CommandDrawString
 
 		FString				prefixPadding;
 		FString				cvarName;
+		FCVarHandle			cvarHandle;
 
 		friend class CommandDrawInventoryBar;
 };
@@ -3497,7 +3499,8 @@ class CommandIfCVarInt : public SBarInfoNegatableFlowControl
 			}
 
 			cvarname = sc.String;
-			cvar = FindCVar(cvarname, nullptr);
+			cvarhandle = FName(cvarname);
+			cvar = cvarhandle.Get();
 
 			if (cvar != nullptr)
 			{
@@ -3534,7 +3537,7 @@ class CommandIfCVarInt : public SBarInfoNegatableFlowControl
 			SBarInfoNegatableFlowControl::Tick(block, statusBar, hudChanged);
 
 			bool result = false;
-			cvar = GetCVar(int(statusBar->CPlayer - players), cvarname);
+			cvar = GetCVar(int(statusBar->CPlayer - players), cvarhandle);
 
 			if (cvar != nullptr)
 			{
@@ -3546,6 +3549,7 @@ class CommandIfCVarInt : public SBarInfoNegatableFlowControl
 		}
 	protected:
 		FString		cvarname;
+		FCVarHandle	cvarhandle;
 		FBaseCVar	*cvar;
 		int			value;
 		bool		equalcomp;
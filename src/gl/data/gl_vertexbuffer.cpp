@@ -25,6 +25,7 @@
 **
 **/
 
+#include <algorithm>
 #include "gl/system/gl_system.h"
 #include "doomtype.h"
 #include "p_local.h"
@@ -431,13 +432,80 @@ void FFlatVertexBuffer::UpdatePlaneVertices(sector_t *sec, int plane)
 	int countvt = sec->vbocount[plane];
 	secplane_t &splane = sec->GetSecPlane(plane);
 	FFlatVertex *vt = &vbo_shadowdata[startvt];
-	FFlatVertex *mapvt = &map[startvt];
-	for(int i=0; i<countvt; i++, vt++, mapvt++)
+
+	FlatUpdate.Clock();
+	float offset = (plane == sector_t::floor && sec->transdoor) ? 1.f : 0.f;
+
+	if (!splane.isSlope())
+	{
+		float z = float(splane.ZatPoint(0., 0.)) - offset;
+		for (int i = 0; i < countvt; i++, vt++)
+		{
+			vt->z = z;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < countvt; i++, vt++)
+		{
+			vt->z = float(splane.ZatPoint(vt->x, vt->y)) - offset;
+		}
+	}
+
+	// The buffer itself only gets written once per scene by FlushUpdates.
+	// Writing single floats into mapped GPU memory is a lot slower than copying whole blocks.
+	if (countvt > 0)
 	{
-		vt->z = splane.ZatPoint(vt->x, vt->y);
-		if (plane == sector_t::floor && sec->transdoor) vt->z -= 1;
-		mapvt->z = vt->z;
+		mDirtyRanges.Push({ (unsigned)startvt, (unsigned)countvt });
+		flatupdateplanes++;
+		flatupdatevertices += countvt;
+	}
+	FlatUpdate.Unclock();
+}
+
+//==========================================================================
+//
+// Copies all planes that changed since the last call from the shadow
+// data to the buffer. Nearby ranges get merged so that the buffer gets
+// written in as few and as large blocks as possible. This must be called
+// while the buffer is mapped.
+//
+//==========================================================================
+
+void FFlatVertexBuffer::FlushUpdates()
+{
+	if (mDirtyRanges.Size() == 0) return;
+
+	FlatUpdate.Clock();
+	std::sort(mDirtyRanges.begin(), mDirtyRanges.end(), [](const FDirtyRange &a, const FDirtyRange &b)
+	{
+		return a.start < b.start;
+	});
+
+	// Gaps up to this size are copied along with the ranges around them. The
+	// static vertices in the gap are the same in the shadow data and the buffer.
+	const unsigned int maxgap = 64;
+
+	unsigned int start = mDirtyRanges[0].start;
+	unsigned int end = start + mDirtyRanges[0].count;
+	for (unsigned i = 1; i <= mDirtyRanges.Size(); i++)
+	{
+		if (i < mDirtyRanges.Size() && mDirtyRanges[i].start <= end + maxgap)
+		{
+			end = MAX(end, mDirtyRanges[i].start + mDirtyRanges[i].count);
+			continue;
+		}
+		memcpy(&map[start], &vbo_shadowdata[start], (end - start) * sizeof(FFlatVertex));
+		flatupdateranges++;
+
+		if (i < mDirtyRanges.Size())
+		{
+			start = mDirtyRanges[i].start;
+			end = start + mDirtyRanges[i].count;
+		}
 	}
+	mDirtyRanges.Clear();
+	FlatUpdate.Unclock();
 }
 
 //==========================================================================
@@ -448,6 +516,7 @@ void FFlatVertexBuffer::UpdatePlaneVertices(sector_t *sec, int plane)
 
 void FFlatVertexBuffer::CreateVBO()
 {
+	mDirtyRanges.Clear();
 	vbo_shadowdata.Resize(mNumReserved);
 	CreateFlatVBO();
 	mCurIndex = mIndex = vbo_shadowdata.Size();
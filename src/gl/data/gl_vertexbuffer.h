@@ -111,6 +111,15 @@ class FFlatVertexBuffer : public FVertexBuffer
 	unsigned int mCurIndex;
 	unsigned int mNumReserved;
 
+	// Vertex ranges of planes that have been updated in vbo_shadowdata but
+	// not been copied to the buffer yet.
+	struct FDirtyRange
+	{
+		unsigned int start;
+		unsigned int count;
+	};
+	TArray<FDirtyRange> mDirtyRanges;
+
 	void CheckPlanes(sector_t *sector);
 
 	static const unsigned int BUFFER_SIZE = 2000000;
@@ -139,6 +148,7 @@ public:
 
 	void CreateVBO();
 	void CheckUpdate(sector_t *sector);
+	void FlushUpdates();
 
 	FFlatVertex *GetBuffer()
 	{
@@ -27,6 +27,7 @@
 
 #include "gl/system/gl_system.h"
 #include "gl/system/gl_framebuffer.h"
+#include "gl/system/gl_debug.h"
 #include "gl/renderer/gl_renderer.h"
 #include "gl/renderer/gl_2ddrawer.h"
 #include "gl/textures/gl_material.h"
@@ -34,7 +35,181 @@
 #include "gl/renderer/gl_lightdata.h"
 #include "gl/scene/gl_drawinfo.h"
 #include "gl/textures/gl_translate.h"
+#include "gl/textures/gl_samplers.h"
 #include "vectors.h"
+#include "stats.h"
+
+static int commands2d, drawcalls2d, batchedquads2d, atlasquads2d;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+F2DAtlas::~F2DAtlas()
+{
+	Flush();
+}
+
+//==========================================================================
+//
+// Drops all pages, for when textures need to be created again
+//
+//==========================================================================
+
+void F2DAtlas::Flush()
+{
+	for (auto page : mPages)
+	{
+		if (FHardwareTexture::lastbound[0] == page->mTexID) FHardwareTexture::lastbound[0] = 0;
+		glDeleteTextures(1, &page->mTexID);
+		delete page;
+	}
+	mPages.Clear();
+	mGeneration++;
+}
+
+//==========================================================================
+//
+// Copies an image into its box with a one pixel border of its own edge
+// pixels, so that filtering does not pick up the neighboring images.
+//
+//==========================================================================
+
+void F2DAtlas::Upload(FPage *page, int x, int y, const unsigned char *buffer, int w, int h)
+{
+	TArray<uint32_t> padded((w + 2) * (h + 2), true);
+	const uint32_t *src = (const uint32_t *)buffer;
+	uint32_t *dest = padded.Data();
+	for (int y = -1; y <= h; y++)
+	{
+		const uint32_t *line = src + clamp(y, 0, h - 1) * w;
+		for (int x = -1; x <= w; x++)
+		{
+			*dest++ = line[clamp(x, 0, w - 1)];
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, page->mTexID);
+	FHardwareTexture::lastbound[0] = page->mTexID;
+	FMaterial::ClearLastTexture();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x - 1, y - 1, w + 2, h + 2, GL_BGRA, GL_UNSIGNED_BYTE, padded.Data());
+}
+
+//==========================================================================
+//
+// Returns where the image of a material is in the atlas, adding it if it
+// qualifies. Returns null if the material has to be bound by itself.
+//
+//==========================================================================
+
+const FMaterial::FAtlasPlacement *F2DAtlas::Find(FMaterial *mat, int translation)
+{
+	FTexture *tex = mat->tex;
+	FMaterial::FAtlasPlacement *placement = nullptr;
+	for (auto &p : mat->mAtlasPlacements)
+	{
+		if (p.translation == translation)
+		{
+			placement = &p;
+			break;
+		}
+	}
+
+	bool modified = false;
+	if (placement != nullptr && placement->generation == mGeneration)
+	{
+		if (placement->page < 0) return nullptr;
+		// Same check as in FGLTexture::Bind, which does not get called for these.
+		modified = tex->CheckModified(DefaultRenderStyle());
+		if (!modified) return placement;
+	}
+
+	// Legacy mode needs different texture data for alpha textures, and warped or
+	// otherwise shaded textures need their own texture coordinates.
+	if (gl.legacyMode || gl.gl1path || tex->bHasCanvas || tex->bWarped || mat->GetShaderIndex() != SHADER_Default || mat->GetLayers() > 1 ||
+		tex->GetWidth() > MAX_SOURCE_SIZE || tex->GetHeight() > MAX_SOURCE_SIZE)
+	{
+		return nullptr;
+	}
+
+	if (placement == nullptr)
+	{
+		placement = &mat->mAtlasPlacements[mat->mAtlasPlacements.Reserve(1)];
+		placement->translation = translation;
+	}
+
+	// This creates the same data as FGLTexture::Bind does for 2D drawing, which never uses hires replacements.
+	int w, h;
+	unsigned char *buffer = mat->CreateTexBuffer(translation, w, h, false, true);
+	tex->ProcessData(buffer, w, h, false);
+
+	if (modified && w == placement->w && h == placement->h)
+	{
+		// Changed contents go into the same place.
+		Upload(mPages[placement->page], placement->x, placement->y, buffer, w, h);
+		delete[] buffer;
+		return placement;
+	}
+
+	placement->generation = mGeneration;
+	placement->page = -1;
+	if (w <= MAX_IMAGE_SIZE && h <= MAX_IMAGE_SIZE)
+	{
+		for (unsigned i = 0; i < MAX_PAGES; i++)
+		{
+			if (i == mPages.Size())
+			{
+				FPage *page = new FPage;
+				glGenTextures(1, &page->mTexID);
+				glBindTexture(GL_TEXTURE_2D, page->mTexID);
+				FHardwareTexture::lastbound[0] = page->mTexID;
+				FMaterial::ClearLastTexture();
+				FGLDebug::LabelObject(GL_TEXTURE, page->mTexID, "F2DAtlas");
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PAGE_SIZE, PAGE_SIZE, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+				page->mPacker.Init(PAGE_SIZE, PAGE_SIZE, false);
+				mPages.Push(page);
+			}
+			Rect box = mPages[i]->mPacker.Insert(w + 2, h + 2);
+			if (box.width == 0) continue;
+
+			placement->page = i;
+			placement->x = box.x + 1;
+			placement->y = box.y + 1;
+			placement->w = w;
+			placement->h = h;
+			placement->u1 = float(placement->x) / PAGE_SIZE;
+			placement->v1 = float(placement->y) / PAGE_SIZE;
+			placement->u2 = float(placement->x + w) / PAGE_SIZE;
+			placement->v2 = float(placement->y + h) / PAGE_SIZE;
+			Upload(mPages[i], placement->x, placement->y, buffer, w, h);
+			break;
+		}
+	}
+	delete[] buffer;
+	return placement->page >= 0 ? placement : nullptr;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void F2DAtlas::BindPage(int page)
+{
+	unsigned int texid = mPages[page]->mTexID;
+	if (FHardwareTexture::lastbound[0] != texid)
+	{
+		glBindTexture(GL_TEXTURE_2D, texid);
+		FHardwareTexture::lastbound[0] = texid;
+	}
+	// The next material must be bound again.
+	FMaterial::ClearLastTexture();
+	GLRenderer->mSamplerManager->Bind(0, CLAMP_XY_NOMIP, 255);
+}
 
 //==========================================================================
 //
@@ -47,9 +222,40 @@ int F2DDrawer::AddData(const F2DDrawer::DataGeneric *data)
 	int addr = mData.Reserve(data->mLen);
 	memcpy(&mData[addr], data, data->mLen);
 	mLastLineCmd = -1;
+	mLastTextureCmd = -1;
 	return addr;
 }
 
+//==========================================================================
+//
+// Appends a quad to the previous texture command if both use the same
+// state. The quads are joined into one strip by two degenerate triangles.
+//
+//==========================================================================
+
+bool F2DDrawer::BatchTexture(const DataTexture &dg)
+{
+	if (mLastTextureCmd == -1 || dg.mColorOverlay != 0) return false;
+
+	DataTexture *last = (DataTexture *)&mData[mLastTextureCmd];
+	bool sameimage = dg.mAtlasPage >= 0 ? last->mAtlasPage == dg.mAtlasPage :
+		last->mAtlasPage < 0 && last->mTexture == dg.mTexture && last->mTranslation == dg.mTranslation;
+	if (last->mColorOverlay != 0 || !sameimage ||
+		last->mRenderStyle.AsDWORD != dg.mRenderStyle.AsDWORD || last->mMasked != dg.mMasked || last->mAlphaTexture != dg.mAlphaTexture ||
+		memcmp(last->mScissor, dg.mScissor, sizeof(dg.mScissor)) != 0 || last->mVertIndex + last->mVertCount != dg.mVertIndex)
+	{
+		return false;
+	}
+
+	mVertices.Reserve(2);
+	memmove(&mVertices[dg.mVertIndex + 2], &mVertices[dg.mVertIndex], 4 * sizeof(FSimpleVertex));
+	mVertices[dg.mVertIndex] = mVertices[dg.mVertIndex - 1];
+	mVertices[dg.mVertIndex + 1] = mVertices[dg.mVertIndex + 2];
+	last->mVertCount += 6;
+	mBatchedQuads++;
+	return true;
+}
+
 //==========================================================================
 //
 // Draws a texture
@@ -78,6 +284,7 @@ void F2DDrawer::AddTexture(FTexture *img, DrawParms &parms)
 	dg.mRenderStyle = parms.style;
 	dg.mMasked = !!parms.masked;
 	dg.mTexture = gltex;
+	dg.mAtlasPage = -1;
 
 	if (parms.colorOverlay && (parms.colorOverlay & 0xffffff) == 0)
 	{
@@ -132,6 +339,20 @@ void F2DDrawer::AddTexture(FTexture *img, DrawParms &parms)
 		u2 = float(u2 - (parms.texwidth - wi) / parms.texwidth);
 	}
 
+	if (!img->bHasCanvas && !dg.mAlphaTexture)
+	{
+		auto placement = mAtlas.Find(gltex, -dg.mTranslation);
+		if (placement != nullptr)
+		{
+			dg.mAtlasPage = placement->page;
+			u1 = placement->u1 + u1 * (placement->u2 - placement->u1);
+			u2 = placement->u1 + u2 * (placement->u2 - placement->u1);
+			v1 = placement->v1 + v1 * (placement->v2 - placement->v1);
+			v2 = placement->v1 + v2 * (placement->v2 - placement->v1);
+			mAtlasQuads++;
+		}
+	}
+
 	PalEntry color;
 	if (parms.style.Flags & STYLEF_ColorIsFixed)
 	{
@@ -166,7 +387,11 @@ void F2DDrawer::AddTexture(FTexture *img, DrawParms &parms)
 		ptr->Set(x + w, y + h, 0, u2, v2, color); ptr++;
 		dg.mVertCount = 8;
 	}
-	AddData(&dg);
+	if (!BatchTexture(dg))
+	{
+		int addr = AddData(&dg);
+		if (dg.mColorOverlay == 0) mLastTextureCmd = addr;
+	}
 }
 
 
@@ -396,6 +621,7 @@ void F2DDrawer::Draw()
 			EnableColorArray(false);
 		}
 		lasttype = dg->mType;
+		mCommands++;
 
 		switch (dg->mType)
 		{
@@ -407,7 +633,15 @@ void F2DDrawer::Draw()
 			DataTexture *dt = static_cast<DataTexture*>(dg);
 
 			gl_SetRenderStyle(dt->mRenderStyle, !dt->mMasked, false);
-			gl_RenderState.SetMaterial(dt->mTexture, CLAMP_XY_NOMIP, dt->mTranslation, -1, dt->mAlphaTexture);
+			if (dt->mAtlasPage >= 0)
+			{
+				gl_RenderState.SetAtlasTexture();
+				mAtlas.BindPage(dt->mAtlasPage);
+			}
+			else
+			{
+				gl_RenderState.SetMaterial(dt->mTexture, CLAMP_XY_NOMIP, dt->mTranslation, -1, dt->mAlphaTexture);
+			}
 
 			glEnable(GL_SCISSOR_TEST);
 			glScissor(dt->mScissor[0], dt->mScissor[1], dt->mScissor[2], dt->mScissor[3]);
@@ -415,15 +649,18 @@ void F2DDrawer::Draw()
 			gl_RenderState.AlphaFunc(GL_GEQUAL, 0.f);
 			gl_RenderState.Apply();
 
-			glDrawArrays(GL_TRIANGLE_STRIP, dt->mVertIndex, 4);
+			// commands with an overlay are never batched so they always consist of exactly two quads.
+			glDrawArrays(GL_TRIANGLE_STRIP, dt->mVertIndex, dt->mColorOverlay != 0 ? 4 : dt->mVertCount);
+			mDrawCalls++;
 
 			gl_RenderState.BlendEquation(GL_FUNC_ADD);
-			if (dt->mVertCount > 4)
+			if (dt->mColorOverlay != 0)
 			{
 				gl_RenderState.SetTextureMode(TM_MASK);
 				gl_RenderState.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 				gl_RenderState.Apply();
 				glDrawArrays(GL_TRIANGLE_STRIP, dt->mVertIndex + 4, 4);
+				mDrawCalls++;
 			}
 
 			const auto &viewport = GLRenderer->mScreenViewport;
@@ -443,6 +680,7 @@ void F2DDrawer::Draw()
 			gl_RenderState.SetObjectColor(dsp->mFlatColor|0xff000000);
 			gl_RenderState.Apply();
 			glDrawArrays(GL_TRIANGLE_FAN, dsp->mVertIndex, dsp->mVertCount);
+			mDrawCalls++;
 			gl_RenderState.SetObjectColor(0xffffffff);
 			break;
 		}
@@ -453,6 +691,7 @@ void F2DDrawer::Draw()
 			gl_RenderState.SetMaterial(dff->mTexture, CLAMP_NONE, 0, -1, false);
 			gl_RenderState.Apply();
 			glDrawArrays(GL_TRIANGLE_STRIP, dg->mVertIndex, dg->mVertCount);
+			mDrawCalls++;
 			break;
 		}
 
@@ -462,6 +701,7 @@ void F2DDrawer::Draw()
 			gl_RenderState.AlphaFunc(GL_GREATER, 0);
 			gl_RenderState.Apply();
 			glDrawArrays(GL_TRIANGLE_FAN, dg->mVertIndex, dg->mVertCount);
+			mDrawCalls++;
 			gl_RenderState.EnableTexture(true);
 			break;
 
@@ -469,6 +709,7 @@ void F2DDrawer::Draw()
 			gl_RenderState.EnableTexture(false);
 			gl_RenderState.Apply();
 			glDrawArrays(GL_LINES, dg->mVertIndex, dg->mVertCount);
+			mDrawCalls++;
 			gl_RenderState.EnableTexture(true);
 			break;
 
@@ -476,6 +717,7 @@ void F2DDrawer::Draw()
 			gl_RenderState.EnableTexture(false);
 			gl_RenderState.Apply();
 			glDrawArrays(GL_POINTS, dg->mVertIndex, dg->mVertCount);
+			mDrawCalls++;
 			gl_RenderState.EnableTexture(true);
 			break;
 
@@ -488,7 +730,25 @@ void F2DDrawer::Draw()
 
 void F2DDrawer::Clear()
 {
+	// Clear is called after the frame's 2D content has been drawn.
+	if (mCommands > 0)
+	{
+		commands2d = mCommands;
+		drawcalls2d = mDrawCalls;
+		batchedquads2d = mBatchedQuads;
+		atlasquads2d = mAtlasQuads;
+	}
+	mCommands = mDrawCalls = mBatchedQuads = mAtlasQuads = 0;
+
 	mVertices.Clear();
 	mData.Clear();
 	mLastLineCmd = -1;
+	mLastTextureCmd = -1;
+}
+
+ADD_STAT(draw2d)
+{
+	FString out;
+	out.Format("2D: %d commands, %d draw calls, %d batched quads, %d atlas quads", commands2d, drawcalls2d, batchedquads2d, atlasquads2d);
+	return out;
 }
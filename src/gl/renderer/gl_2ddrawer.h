@@ -3,6 +3,45 @@
 
 #include "tarray.h"
 #include "gl/data/gl_vertexbuffer.h"
+#include "gl/textures/gl_material.h"
+#include "SkylineBinPack.h"
+
+//==========================================================================
+//
+// Shared texture pages for small 2D images like font glyphs and status
+// bar graphics, so that consecutive draws of different images can be
+// batched into one draw call.
+//
+//==========================================================================
+
+class F2DAtlas
+{
+	enum
+	{
+		PAGE_SIZE = 1024,
+		MAX_PAGES = 4,
+		MAX_SOURCE_SIZE = 128,	// larger images are not worth packing
+		MAX_IMAGE_SIZE = 256,	// after upscaling
+	};
+
+	struct FPage
+	{
+		unsigned int mTexID;
+		SkylineBinPack mPacker;
+	};
+
+	TArray<FPage *> mPages;
+	int mGeneration = 1;
+
+	void Upload(FPage *page, int x, int y, const unsigned char *buffer, int w, int h);
+
+public:
+	~F2DAtlas();
+
+	const FMaterial::FAtlasPlacement *Find(FMaterial *mat, int translation);
+	void BindPage(int page);
+	void Flush();
+};
 
 class F2DDrawer : public FSimpleVertexBuffer
 {
@@ -33,6 +72,7 @@ class F2DDrawer : public FSimpleVertexBuffer
 		FRenderStyle mRenderStyle;
 		bool mMasked;
 		bool mAlphaTexture;
+		int mAtlasPage;		// -1 if the material is bound
 	};
 	
 	struct DataFlatFill : public DataGeneric
@@ -51,8 +91,18 @@ class F2DDrawer : public FSimpleVertexBuffer
 	TArray<FSimpleVertex> mVertices;
 	TArray<uint8_t> mData;
 	int mLastLineCmd = -1;	// consecutive lines can be batched into a single draw call so keep this info around.
+	int mLastTextureCmd = -1;	// same for textures with identical state.
+
+	// for the draw2d stat
+	int mCommands = 0;
+	int mDrawCalls = 0;
+	int mBatchedQuads = 0;
+	int mAtlasQuads = 0;
+
+	F2DAtlas mAtlas;
 	
 	int AddData(const DataGeneric *data);
+	bool BatchTexture(const DataTexture &dg);
 	
 public:
 	void AddTexture(FTexture *img, DrawParms &parms);
@@ -69,6 +119,7 @@ public:
 		
 	void Draw();
 	void Clear();
+	void FlushAtlas() { mAtlas.Flush(); }
 };
 
 
@@ -386,6 +386,7 @@ void FGLRenderer::Begin2D()
 void FGLRenderer::FlushTextures()
 {
 	FMaterial::FlushAll();
+	if (m2DDrawer != nullptr) m2DDrawer->FlushAtlas();
 }
 
 //===========================================================================
@@ -166,6 +166,14 @@ public:
 		mat->Bind(clampmode, translation);
 	}
 
+	// For images that the 2D drawer takes from its atlas instead of their material.
+	void SetAtlasTexture()
+	{
+		mTempTM = TM_MODULATE;
+		mEffectState = SHADER_Default;
+		mShaderTimer = 0;
+	}
+
 	bool IsBrightmapEnabled() const { return mBrightmapEnabled; }
 
 	void Apply();
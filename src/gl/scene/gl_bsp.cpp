@@ -34,6 +34,8 @@
 #include "po_man.h"
 #include "doomdata.h"
 #include "g_levellocals.h"
+#include "r_data/sprites.h"
+#include "r_data/models/models.h"
 
 #include "gl/renderer/gl_renderer.h"
 #include "gl/data/gl_data.h"
@@ -43,14 +45,19 @@
 #include "gl/scene/gl_wall.h"
 #include "gl/utility/gl_clock.h"
 
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 EXTERN_CVAR(Float, r_actorspriteshadowdist)
+EXTERN_CVAR(Float, gl_sprite_distance_cull)
 
 EXTERN_CVAR(Bool, gl_render_segs)
 
 CVAR(Bool, gl_render_things, true, 0)
 CVAR(Bool, gl_render_walls, true, 0)
 CVAR(Bool, gl_render_flats, true, 0)
+CVAR(Bool, gl_sprite_batchcull, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
 
 //==========================================================================
@@ -369,18 +376,271 @@ void GLSceneDrawer::AddSpecialPortalLines(subsector_t * sub, sector_t * sector,
 }
 
 
+//==========================================================================
+//
+// Sprite batch culling
+//
+// The things of a subsector are first gathered into packed arrays and
+// the cheap rejects - the distance limits and the horizontal view cone
+// the clipper was set up with - are done for all of them at once.
+// Only the survivors go through GLSprite::Process.
+// The tests are conservative, i.e. nothing gets rejected here that
+// Process would not have rejected itself or that could reach the screen.
+//
+//==========================================================================
+
+struct FSpriteCullBatch
+{
+	TArray<AActor *> Things;
+	TArray<double> PosX, PosY, PosZ;	// position used by the distance checks
+	TArray<double> ViewX, ViewY;		// interpolated position used for drawing
+	TArray<double> Radius;				// bounding circle around the origin
+	TArray<double> MaxDist;				// squared distance from which on the thing is culled
+	TArray<uint8_t> Result;
+
+	enum
+	{
+		InRange = 1,
+		InCone = 2,
+		Visible = InRange | InCone
+	};
+
+	void Clear()
+	{
+		Things.Clear();
+		PosX.Clear();
+		PosY.Clear();
+		PosZ.Clear();
+		ViewX.Clear();
+		ViewY.Clear();
+		Radius.Clear();
+		MaxDist.Clear();
+	}
+};
+
+static FSpriteCullBatch SpriteBatch;
+static TArray<float> SpriteBounds;
+
+//==========================================================================
+//
+// Largest distance any pixel of a sprite's frames can have from the origin
+// in any orientation. Calculated once per sprite.
+//
+//==========================================================================
+
+static double GetSpriteBound(int spritenum)
+{
+	if (SpriteBounds.Size() != sprites.Size())
+	{
+		SpriteBounds.Resize(sprites.Size());
+		for (auto &bound : SpriteBounds) bound = -1.f;
+	}
+	if ((unsigned)spritenum >= SpriteBounds.Size()) return INFINITY;
+
+	float &bound = SpriteBounds[spritenum];
+	if (bound < 0.f)
+	{
+		const spritedef_t &def = sprites[spritenum];
+		double maxdist = 0;
+		for (int f = 0; f < def.numframes; f++)
+		{
+			const spriteframe_t &frame = SpriteFrames[def.spriteframes + f];
+			for (int r = 0; r < 16; r++)
+			{
+				FTexture *tex = TexMan[frame.Texture[r]];
+				if (tex == nullptr) continue;
+
+				// The material puts a one pixel frame around sprites.
+				double sx = fabs(tex->Scale.X), sy = fabs(tex->Scale.Y);
+				double w = MAX(fabs(tex->LeftOffset + 1.), fabs(tex->GetWidth() - tex->LeftOffset + 1.)) / sx;
+				double h = MAX(fabs(tex->TopOffset + 1.), fabs(tex->GetHeight() - tex->TopOffset + 1.)) / sy;
+				maxdist = MAX(maxdist, w * w + h * h);
+			}
+		}
+		bound = float(sqrt(maxdist) + 1.);
+	}
+	return bound;
+}
+
+//==========================================================================
+//
+// Adds a thing to the batch
+//
+//==========================================================================
+
+static void AddToSpriteBatch(FSpriteCullBatch &batch, AActor *thing, double maxdist)
+{
+	DVector3 pos = thing->Pos();
+	DVector3 thingpos = thing->InterpolatedPosition(r_viewpoint.TicFrac);
+	double radius;
+
+	if (thing->player != nullptr || thing->picnum.isValid())
+	{
+		// Skins and picnum overrides are not looked up here, so never cull them against the view.
+		radius = INFINITY;
+	}
+	else
+	{
+		radius = GetSpriteBound(thing->sprite) * MAX(fabs(thing->Scale.X), fabs(thing->Scale.Y));
+		if (thing->renderflags & RF_ROLLCENTER) radius *= 2;
+		radius += thing->SpriteOffset.Length() + 1.;
+	}
+
+	FIntCVar *cvar = thing->GetInfo()->distancecheck;
+	if (cvar != NULL && *cvar >= 0)
+	{
+		double check = (double)**cvar;
+		maxdist = MIN(maxdist, check * check);
+	}
+
+	batch.Things.Push(thing);
+	batch.PosX.Push(pos.X);
+	batch.PosY.Push(pos.Y);
+	batch.PosZ.Push(pos.Z);
+	batch.ViewX.Push(thingpos.X);
+	batch.ViewY.Push(thingpos.Y);
+	batch.Radius.Push(radius);
+	batch.MaxDist.Push(maxdist);
+}
+
+//==========================================================================
+//
+// Runs the distance and view cone tests for the entire batch.
+// The cone is given by the inward facing normals of its two sides.
+// With zero normals everything passes the cone test.
+//
+//==========================================================================
+
+static void CullSpriteBatch(FSpriteCullBatch &batch, const DVector3 &view, const DVector2 &leftnormal, const DVector2 &rightnormal)
+{
+	unsigned count = batch.Things.Size();
+	batch.Result.Resize(count);
+
+	unsigned i = 0;
+#ifndef NO_SSE
+	const __m128d vx = _mm_set1_pd(view.X);
+	const __m128d vy = _mm_set1_pd(view.Y);
+	const __m128d vz = _mm_set1_pd(view.Z);
+	const __m128d lx = _mm_set1_pd(leftnormal.X);
+	const __m128d ly = _mm_set1_pd(leftnormal.Y);
+	const __m128d rx = _mm_set1_pd(rightnormal.X);
+	const __m128d ry = _mm_set1_pd(rightnormal.Y);
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d dx = _mm_sub_pd(_mm_loadu_pd(&batch.PosX[i]), vx);
+		__m128d dy = _mm_sub_pd(_mm_loadu_pd(&batch.PosY[i]), vy);
+		__m128d dz = _mm_sub_pd(_mm_loadu_pd(&batch.PosZ[i]), vz);
+		__m128d dist = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+		int inrange = _mm_movemask_pd(_mm_cmplt_pd(dist, _mm_loadu_pd(&batch.MaxDist[i])));
+
+		__m128d px = _mm_sub_pd(_mm_loadu_pd(&batch.ViewX[i]), vx);
+		__m128d py = _mm_sub_pd(_mm_loadu_pd(&batch.ViewY[i]), vy);
+		__m128d negradius = _mm_sub_pd(_mm_setzero_pd(), _mm_loadu_pd(&batch.Radius[i]));
+		__m128d left = _mm_cmpge_pd(_mm_add_pd(_mm_mul_pd(px, lx), _mm_mul_pd(py, ly)), negradius);
+		__m128d right = _mm_cmpge_pd(_mm_add_pd(_mm_mul_pd(px, rx), _mm_mul_pd(py, ry)), negradius);
+		int incone = _mm_movemask_pd(_mm_and_pd(left, right));
+
+		batch.Result[i] = (inrange & 1) | ((incone & 1) << 1);
+		batch.Result[i + 1] = ((inrange >> 1) & 1) | (incone & 2);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		double dx = batch.PosX[i] - view.X;
+		double dy = batch.PosY[i] - view.Y;
+		double dz = batch.PosZ[i] - view.Z;
+		double dist = dx * dx + dy * dy + dz * dz;
+
+		double px = batch.ViewX[i] - view.X;
+		double py = batch.ViewY[i] - view.Y;
+		double negradius = -batch.Radius[i];
+		bool incone = px * leftnormal.X + py * leftnormal.Y >= negradius && px * rightnormal.X + py * rightnormal.Y >= negradius;
+
+		batch.Result[i] = (dist < batch.MaxDist[i] ? FSpriteCullBatch::InRange : 0) | (incone ? FSpriteCullBatch::InCone : 0);
+	}
+}
+
 //==========================================================================
 //
 // R_RenderThings
 //
 //==========================================================================
 
+void GLSceneDrawer::ProcessThing(AActor *thing, sector_t *sector, int thruportal)
+{
+	GLSprite sprite(this);
+
+	// [Nash] draw sprite shadow
+	if (R_ShouldDrawSpriteShadow(thing))
+	{
+		double dist = (thing->Pos() - r_viewpoint.Pos).LengthSquared();
+		double check = r_actorspriteshadowdist;
+		if (dist <= check * check)
+		{
+			sprite.Process(thing, sector, thruportal, true);
+		}
+	}
+
+	sprite.Process(thing, sector, thruportal);
+}
+
 void GLSceneDrawer::RenderThings(subsector_t * sub, sector_t * sector)
 {
 	SetupSprite.Clock();
 	sector_t * sec=sub->sector;
 	// Handle all things in sector.
-	for (auto p = sec->touching_renderthings; p != nullptr; p = p->m_snext)
+	if (gl_sprite_batchcull)
+	{
+		// GLSprite::Process skips everything beyond gl_sprite_distance_cull.
+		double culldist = gl_sprite_distance_cull * gl_sprite_distance_cull;
+		double maxdist = culldist > 0 ? std::nextafter(culldist, INFINITY) : INFINITY;
+
+		auto &batch = SpriteBatch;
+		batch.Clear();
+		for (auto p = sec->touching_renderthings; p != nullptr; p = p->m_snext)
+		{
+			auto thing = p->m_thing;
+			if (thing->validcount == validcount) continue;
+			thing->validcount = validcount;
+			AddToSpriteBatch(batch, thing, maxdist);
+		}
+
+		if (batch.Things.Size() > 0)
+		{
+			// The cone is only convex while it is narrower than 180 degrees. Beyond that only the distance gets checked.
+			DVector2 leftnormal(0, 0), rightnormal(0, 0);
+			angle_t a1 = FrustumAngle();
+			if (a1 < ANGLE_90)
+			{
+				DAngle yaw = r_viewpoint.Angles.Yaw;
+				DAngle half = a1 * BAM_FACTOR;
+				DAngle left = yaw + half, right = yaw - half;
+				leftnormal = { left.Sin(), -left.Cos() };
+				rightnormal = { -right.Sin(), right.Cos() };
+			}
+			CullSpriteBatch(batch, r_viewpoint.Pos, leftnormal, rightnormal);
+
+			sprite_candidates += batch.Things.Size();
+			for (unsigned i = 0; i < batch.Things.Size(); i++)
+			{
+				AActor *thing = batch.Things[i];
+				int result = batch.Result[i];
+				// Models are not bounded by their sprite so only look for them when the cone would reject one.
+				if (result == FSpriteCullBatch::InRange && FindModelFrame(thing->GetClass(), thing->sprite, thing->frame, !!(thing->flags & MF_DROPPED)))
+				{
+					result = FSpriteCullBatch::Visible;
+				}
+				if (result != FSpriteCullBatch::Visible)
+				{
+					culled_sprites++;
+					continue;
+				}
+				ProcessThing(thing, sector, false);
+			}
+		}
+	}
+	else for (auto p = sec->touching_renderthings; p != nullptr; p = p->m_snext)
 	{
 		auto thing = p->m_thing;
 		if (thing->validcount == validcount) continue;
@@ -397,20 +657,7 @@ void GLSceneDrawer::RenderThings(subsector_t * sub, sector_t * sector)
 			}
 		}
 
-		GLSprite sprite(this);
-
-		// [Nash] draw sprite shadow
-		if (R_ShouldDrawSpriteShadow(thing))
-		{
-			double dist = (thing->Pos() - r_viewpoint.Pos).LengthSquared();
-			double check = r_actorspriteshadowdist;
-			if (dist <= check * check)
-			{
-				sprite.Process(thing, sector, false, true);
-			}
-		}
-
-		sprite.Process(thing, sector, false);
+		ProcessThing(thing, sector, false);
 	}
 	
 	for (msecnode_t *node = sec->sectorportal_thinglist; node; node = node->m_snext)
@@ -426,21 +673,7 @@ void GLSceneDrawer::RenderThings(subsector_t * sub, sector_t * sector)
 				continue;
 			}
 		}
-
-		GLSprite sprite(this);
-
-	// [Nash] draw sprite shadow
-	if (R_ShouldDrawSpriteShadow(thing))
-	{
-		double dist = (thing->Pos() - r_viewpoint.Pos).LengthSquared();
-		double check = r_actorspriteshadowdist;
-		if (dist <= check * check)
-		{
-			sprite.Process(thing, sector, true, true);
-		}
-	}
-
-		sprite.Process(thing, sector, true);
+		ProcessThing(thing, sector, true);
 	}
 	SetupSprite.Unclock();
 }
@@ -297,6 +297,7 @@ void GLSceneDrawer::CreateScene()
 	gl_drawinfo->HandleMissingTextures();	// Missing upper/lower textures
 	gl_drawinfo->HandleHackedSubsectors();	// open sector hacks for deep water
 	gl_drawinfo->ProcessSectorStacks();		// merge visplanes of sector stacks
+	GLRenderer->mVBO->FlushUpdates();		// copy all planes that moved to the buffer
 	GLRenderer->mVBO->Unmap();
 
 	ProcessAll.Unclock();
@@ -28,6 +28,7 @@ private:
 	void RenderMergedLine(seg_t *seg, angle_t startAngle, angle_t endAngle);
 	void AddLines(subsector_t * sub, sector_t * sector);
 	void AddSpecialPortalLines(subsector_t * sub, sector_t * sector, line_t *line);
+	void ProcessThing(AActor *thing, sector_t *sector, int thruportal);
 	void RenderThings(subsector_t * sub, sector_t * sector);
 	void DoSubsector(subsector_t * sub);
 	void RenderBSPNode(void *node);
@@ -272,6 +272,13 @@ void gl_LoadExtensions()
 			}
 
 			Printf("GL1 npot - to reduce blurriness, go vid-options -> txt hires upscale\n");
+
+			// Compressed uploads are core since GL 1.3; most cards of that era also do S3TC.
+			if (!gl.gl1_v1dot1 && gl_version >= 1.3f)
+			{
+				if (CheckExtension("GL_ARB_texture_compression")) gl.flags |= RFL_TEXTURE_COMPRESSION;
+				if (CheckExtension("GL_EXT_texture_compression_s3tc")) gl.flags |= RFL_TEXTURE_COMPRESSION_S3TC;
+			}
 		}
 
 
@@ -33,6 +33,11 @@
 #include <unistd.h>
 #endif
 
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #include "w_wad.h"
 #include "m_png.h"
 #include "sbar.h"
@@ -43,6 +48,10 @@
 #include "d_main.h"
 #include "zstring.h"
 #include "textures.h"
+#include "files.h"
+#include "md5.h"
+#include "m_misc.h"
+#include "textures/dxtencode.h"
 
 #ifndef _WIN32
 #define _access(a,b)	access(a,b)
@@ -359,3 +368,217 @@ int CheckExternalFile(FTexture *tex, bool & hascolorkey)
 }
 
 
+//==========================================================================
+//
+// DXT compressed copies of hires textures
+//
+// The file name is a hash of the resource file's size and time stamp and
+// the image's name and size, so an edited image never picks up a stale
+// copy. Images that are loose files in a directory get hashed instead.
+//
+//==========================================================================
+
+static const char DXTCacheMagic[4] = { 'D', 'X', 'T', 'C' };
+static const uint8_t DXTCacheVersion = 2;
+
+enum
+{
+	DXTCACHE_Masked = 1,	// smoothing the edges found transparent pixels
+};
+
+static const FString &GetHiresCacheDir()
+{
+	// The precache workers get here concurrently, this creates the directory once.
+	static const FString dir = []()
+	{
+		FString path = M_GetCachePath(true);
+		path << "/textures";
+		CreatePath(path);
+		return path;
+	}();
+	return dir;
+}
+
+FString gl_GetHiresCachePath(int lump, bool hascolorkey)
+{
+	MD5Context md5;
+	uint8_t digest[16];
+	uint8_t key[2] = { DXTCacheVersion, uint8_t(hascolorkey) };
+
+	const char *container = Wads.GetWadFullName(Wads.GetLumpFile(lump));
+	size_t filesize;
+	time_t filetime;
+	if (GetFileInfo(container, &filesize, &filetime))
+	{
+		FString id;
+		id.Format("%s;%llu;%lld;%s;%d", container, (unsigned long long)filesize, (long long)filetime, Wads.GetLumpFullName(lump), Wads.LumpLength(lump));
+		md5.Update((const uint8_t *)id.GetChars(), (unsigned)id.Len());
+	}
+	else
+	{
+		// Directories do not change their time stamp when a file in them gets edited.
+		FileReader fr = Wads.OpenLumpReader(lump);
+		TArray<uint8_t> data = fr.Read();
+		if (data.Size() == 0) return "";
+		md5.Update(data.Data(), data.Size());
+	}
+	md5.Update(key, 2);
+	md5.Final(digest);
+
+	FString path = GetHiresCacheDir();
+	path << '/';
+	for (auto b : digest) path.AppendFormat("%02x", b);
+	path << ".dxt";
+	return path;
+}
+
+FDXTImage *gl_ReadHiresCache(const FString &path, int width, int height, bool &masked)
+{
+	FileReader fr;
+	char magic[4];
+	if (path.IsEmpty() || !fr.OpenFile(path) || fr.Read(magic, 4) != 4 || memcmp(magic, DXTCacheMagic, 4) != 0)
+	{
+		return nullptr;
+	}
+
+	uint32_t version = fr.ReadUInt32();
+	uint32_t w = fr.ReadUInt32();
+	uint32_t h = fr.ReadUInt32();
+	uint32_t format = fr.ReadUInt32();
+	uint32_t levels = fr.ReadUInt32();
+	uint32_t flags = fr.ReadUInt32();
+	if (version != DXTCacheVersion || w != uint32_t(width) || h != uint32_t(height) || format > DXT_5 || levels != uint32_t(DXT_LevelCount(width, height)))
+	{
+		return nullptr;
+	}
+
+	masked = !!(flags & DXTCACHE_Masked);
+
+	FDXTImage *image = new FDXTImage;
+	image->Width = width;
+	image->Height = height;
+	image->Levels = levels;
+	image->Format = EDXTFormat(format);
+	image->Data.Resize(DXT_ImageSize(image->Format, width, height, levels));
+	if (fr.Read(image->Data.Data(), image->Data.Size()) != (long)image->Data.Size())
+	{
+		delete image;
+		return nullptr;
+	}
+	return image;
+}
+
+void gl_WriteHiresCache(const FString &path, const FDXTImage *image, bool masked)
+{
+	// Several precache workers may be writing the same image.
+	static std::atomic<int> tempcount;
+	FString temppath;
+	temppath.Format("%s.%d.tmp", path.GetChars(), tempcount++);
+
+	FileWriter *fw = FileWriter::Open(temppath);
+	if (fw == nullptr) return;
+
+	uint32_t header[6] = { DXTCacheVersion, uint32_t(image->Width), uint32_t(image->Height), uint32_t(image->Format), uint32_t(image->Levels),
+		uint32_t(masked ? DXTCACHE_Masked : 0) };
+	fw->Write(DXTCacheMagic, 4);
+	for (auto &v : header)
+	{
+		uint32_t le = LittleLong(v);
+		fw->Write(&le, 4);
+	}
+	bool ok = fw->Write(image->Data.Data(), image->Data.Size()) == image->Data.Size();
+	delete fw;
+
+	if (!ok || rename(temppath, path) != 0)
+	{
+		remove(temppath);
+	}
+}
+
+//==========================================================================
+//
+// Images that were bound before they were in the cache get compressed on
+// a thread of their own, so the next session can use them. Whatever is
+// still queued at exit is dropped.
+//
+//==========================================================================
+
+class FHiresCompressor
+{
+public:
+	~FHiresCompressor()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Quit = true;
+		}
+		Wake.notify_all();
+		if (Worker.joinable()) Worker.join();
+		for (auto &job : Jobs) delete[] job.buffer;
+	}
+
+	void Queue(const FString &path, unsigned char *buffer, int width, int height, bool masked)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			// Every job holds a full size image, so don't let them pile up.
+			bool queued = Jobs.Size() >= MaxJobs;
+			for (auto &job : Jobs)
+			{
+				if (job.path.Compare(path) == 0) queued = true;
+			}
+			if (queued)
+			{
+				delete[] buffer;
+				return;
+			}
+			Jobs.Push({ path, buffer, width, height, masked });
+			if (!Worker.joinable()) Worker = std::thread([this]() { WorkerProc(); });
+		}
+		Wake.notify_one();
+	}
+
+private:
+	struct FJob
+	{
+		FString path;
+		unsigned char *buffer;
+		int width, height;
+		bool masked;
+	};
+
+	void WorkerProc()
+	{
+		std::unique_lock<std::mutex> lock(Lock);
+		for (;;)
+		{
+			while (!Quit && Jobs.Size() == 0) Wake.wait(lock);
+			if (Quit) return;
+			FJob job = Jobs[0];
+			Jobs.Delete(0);
+			lock.unlock();
+
+			FDXTImage *image = DXT_Compress(job.buffer, job.width, job.height, true);
+			delete[] job.buffer;
+			gl_WriteHiresCache(job.path, image, job.masked);
+			delete image;
+
+			lock.lock();
+		}
+	}
+
+	static const unsigned MaxJobs = 16;
+
+	std::thread Worker;
+	TArray<FJob> Jobs;
+	std::mutex Lock;
+	std::condition_variable Wake;
+	bool Quit = false;
+};
+
+static FHiresCompressor HiresCompressor;
+
+void gl_CompressHiresInBackground(const FString &path, unsigned char *buffer, int width, int height, bool masked)
+{
+	HiresCompressor.Queue(path, buffer, width, height, masked);
+}
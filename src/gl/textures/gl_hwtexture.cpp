@@ -38,6 +38,7 @@
 #include "gl/system/gl_debug.h"
 #include "gl/renderer/gl_renderer.h"
 #include "gl/textures/gl_material.h"
+#include "textures/dxtencode.h"
 
 
 extern TexFilter_s TexFilter[];
@@ -349,6 +350,49 @@ unsigned int FHardwareTexture::CreateTexture(unsigned char * buffer, int w, int
 	return glTex->glTexID;
 }
 
+//===========================================================================
+// 
+//	Uploads a DXT compressed image with all of its mip levels
+//
+//===========================================================================
+
+bool FHardwareTexture::CanUploadCompressed(int w, int h)
+{
+	if (!(gl.flags & RFL_TEXTURE_COMPRESSION) || !(gl.flags & RFL_TEXTURE_COMPRESSION_S3TC)) return false;
+
+	// The cached image cannot be scaled, so it must already fit the hardware.
+	return GetTexDimension(w) == w && GetTexDimension(h) == h;
+}
+
+unsigned int FHardwareTexture::CreateCompressedTexture(const FDXTImage *image, int texunit, int translation, const FString &name)
+{
+	static const GLenum formats[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+
+	TranslatedTexture * glTex = GetTexID(translation);
+	if (glTex->glTexID == 0) glGenTextures(1, &glTex->glTexID);
+	if (texunit != 0) glActiveTexture(GL_TEXTURE0 + texunit);
+	glBindTexture(GL_TEXTURE_2D, glTex->glTexID);
+	FGLDebug::LabelObject(GL_TEXTURE, glTex->glTexID, name);
+	lastbound[texunit] = glTex->glTexID;
+
+	const uint8_t *data = image->Data.Data();
+	int w = image->Width;
+	int h = image->Height;
+	for (int level = 0; level < image->Levels; level++)
+	{
+		unsigned size = DXT_LevelSize(image->Format, w, h);
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, formats[image->Format], w, h, 0, size, data);
+		data += size;
+		w = MAX(w / 2, 1);
+		h = MAX(h / 2, 1);
+	}
+	// The image comes with all levels down to 1x1. Bind must not try glGenerateMipmap on it.
+	glTex->mipmapped = true;
+
+	if (texunit != 0) glActiveTexture(GL_TEXTURE0);
+	return glTex->glTexID;
+}
+
 //===========================================================================
 // 
 //	Creates a texture
@@ -13,6 +13,7 @@
 #include "gl/system/gl_interface.h"
 
 class FCanvasTexture;
+struct FDXTImage;
 class AActor;
 typedef TMap<int, bool> SpriteHits;
 
@@ -98,6 +99,8 @@ public:
 
 	unsigned int Bind(int texunit, int translation, bool needmipmap);
 	unsigned int CreateTexture(unsigned char * buffer, int w, int h, int texunit, bool mipmap, int translation, const FString &name);
+	unsigned int CreateCompressedTexture(const FDXTImage *image, int texunit, int translation, const FString &name);
+	static bool CanUploadCompressed(int w, int h);
 	unsigned int GetTextureHandle(int translation);
 
 	void Clean(bool all);
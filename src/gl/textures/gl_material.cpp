@@ -35,6 +35,7 @@
 #include "colormatcher.h"
 #include "textures/warpbuffer.h"
 #include "textures/bitmap.h"
+#include "textures/dxtencode.h"
 
 //#include "gl/gl_intern.h"
 
@@ -53,6 +54,7 @@ EXTERN_CVAR(Bool, gl_render_precise)
 EXTERN_CVAR(Int, gl_lightmode)
 EXTERN_CVAR(Bool, gl_precache)
 EXTERN_CVAR(Bool, gl_texture_usehires)
+EXTERN_CVAR(Bool, gl_texture_compresshires)
 
 extern TArray<UserShaderDesc> usershaders;
 
@@ -92,17 +94,18 @@ FGLTexture::FGLTexture(FTexture * tx, bool expandpatches)
 FGLTexture::~FGLTexture()
 {
 	Clean(true);
+	DiscardPreparedBuffers();
 	if (hirestexture) delete hirestexture;
 }
 
 //==========================================================================
 //
-// Checks for the presence of a hires texture replacement and loads it
+// Checks for the presence of a hires texture replacement
 //
 //==========================================================================
-unsigned char *FGLTexture::LoadHiresTexture(FTexture *tex, int *width, int *height)
+void FGLTexture::FindHiresTexture(FTexture *tex)
 {
-	if (bExpandFlag) return NULL;	// doesn't work for expanded textures
+	if (bExpandFlag) return;	// doesn't work for expanded textures
 
 	if (HiresLump==-1) 
 	{
@@ -115,6 +118,18 @@ unsigned char *FGLTexture::LoadHiresTexture(FTexture *tex, int *width, int *heig
 			hirestexture = FTexture::CreateTexture(HiresLump, ETextureType::Any);
 		}
 	}
+}
+
+//==========================================================================
+//
+// Checks for the presence of a hires texture replacement and loads it
+//
+//==========================================================================
+unsigned char *FGLTexture::LoadHiresTexture(FTexture *tex, int *width, int *height)
+{
+	if (bExpandFlag) return NULL;	// doesn't work for expanded textures
+
+	FindHiresTexture(tex);
 	if (hirestexture != NULL)
 	{
 		int w=hirestexture->GetWidth();
@@ -146,6 +161,101 @@ unsigned char *FGLTexture::LoadHiresTexture(FTexture *tex, int *width, int *heig
 	return NULL;
 }
 
+//==========================================================================
+//
+// Returns the hires replacement DXT compressed, from the texture cache if
+// it has been compressed before. This may run on a precache worker, so the
+// texture's flags are not changed here. ApplyCompressedHires does that
+// once the image gets uploaded.
+//
+// If 'uncompressed' is given, an image that is not in the cache yet is
+// returned there decoded instead of being compressed right away.
+//
+//==========================================================================
+
+FDXTImage *FGLTexture::LoadCompressedHires(FTexture *hirescheck, bool &masked, FUncompressedHires *uncompressed)
+{
+	if (!gl_texture_compresshires || !gl_texture_usehires || hirescheck == NULL || bExpandFlag) return NULL;
+	if (tex->bWarped || tex->gl_info.bNoCompress) return NULL;
+
+	FindHiresTexture(hirescheck);
+	if (hirestexture == NULL) return NULL;
+
+	int w = hirestexture->GetWidth();
+	int h = hirestexture->GetHeight();
+	if (!FHardwareTexture::CanUploadCompressed(w, h)) return NULL;
+
+	FString path = gl_GetHiresCachePath(HiresLump, bHasColorkey);
+	FDXTImage *image = gl_ReadHiresCache(path, w, h, masked);
+	if (image == NULL)
+	{
+		unsigned char *buffer = LoadHiresTexture(hirescheck, &w, &h);
+		if (buffer == NULL) return NULL;
+
+		// Same edge smoothing as ProcessData does, so the smoothed edges get stored.
+		masked = FTexture::SmoothEdges(buffer, w, h);
+		if (uncompressed != nullptr)
+		{
+			uncompressed->path = path;
+			uncompressed->buffer = buffer;
+			uncompressed->w = w;
+			uncompressed->h = h;
+			return NULL;
+		}
+		image = DXT_Compress(buffer, w, h, true);
+		delete[] buffer;
+		if (!path.IsEmpty()) gl_WriteHiresCache(path, image, masked);
+	}
+	return image;
+}
+
+//==========================================================================
+//
+// Updates the texture with what was found out about a compressed hires
+// image when it was created. Must be called on the main thread.
+//
+//==========================================================================
+
+void FGLTexture::ApplyCompressedHires(const FDXTImage *image, bool masked)
+{
+	if (tex->bMasked && !masked)
+	{
+		tex->bMasked = false;
+		tex->GetRedirect(false)->bMasked = false;
+	}
+	else if (tex->bMasked && tex->gl_info.areacount == 0 && image->Height <= 512)
+	{
+		// FindHoles needs the pixels, so look at the first level's alpha.
+		// (It skips anything taller than 512 anyway.)
+		TArray<uint8_t> pixels(image->Width * image->Height * 4, true);
+		DXT_DecompressLevel(image->Data.Data(), image->Width, image->Height, image->Format, pixels.Data());
+		tex->FindHoles(pixels.Data(), image->Width, image->Height);
+	}
+	if (hirestexture->gl_info.mIsTransparent == -1) hirestexture->gl_info.mIsTransparent = image->Format == DXT_5;
+	bIsTransparent = hirestexture->gl_info.mIsTransparent;
+}
+
+//==========================================================================
+//
+// The rest of ProcessData for a buffer whose edges were smoothed by a
+// precache worker. Must be called on the main thread, since a redirected
+// texture belongs to another worker's job.
+//
+//==========================================================================
+
+void FGLTexture::ApplySmoothedEdges(const unsigned char *buffer, int w, int h, bool masked)
+{
+	if (tex->bMasked)
+	{
+		if (!masked)
+		{
+			tex->bMasked = false;
+			tex->GetRedirect(false)->bMasked = false;
+		}
+		else tex->FindHoles(buffer, w, h);
+	}
+}
+
 //===========================================================================
 // 
 //	Deletes all allocated resources
@@ -390,6 +500,57 @@ unsigned char * FGLTexture::CreateTexBuffer(int translation, int & w, int & h, F
 }
 
 
+//===========================================================================
+// 
+//	Creates a texture buffer ahead of time so that Bind only needs to
+//	upload it. This gets called by the precache workers, so everything
+//	here must only touch data that belongs to this texture.
+//
+//===========================================================================
+
+void FGLTexture::PrepareBuffer(int translation, FTexture *hirescheck)
+{
+	FPreparedBuffer prep;
+	prep.translation = translation;
+	prep.buffer = NULL;
+	prep.compressed = LoadCompressedHires(hirescheck, prep.masked);
+	if (prep.compressed == NULL)
+	{
+		prep.buffer = CreateTexBuffer(translation, prep.w, prep.h, hirescheck, true, false);
+		// Only the pixel work of ProcessData; Bind takes care of the flags.
+		prep.masked = tex->bMasked && FTexture::SmoothEdges(prep.buffer, prep.w, prep.h);
+	}
+	mPreparedBuffers.Push(prep);
+}
+
+bool FGLTexture::TakePreparedBuffer(int translation, unsigned char *&buffer, FDXTImage *&compressed, int &w, int &h, bool &masked)
+{
+	for (unsigned i = 0; i < mPreparedBuffers.Size(); i++)
+	{
+		if (mPreparedBuffers[i].translation == translation)
+		{
+			buffer = mPreparedBuffers[i].buffer;
+			compressed = mPreparedBuffers[i].compressed;
+			w = mPreparedBuffers[i].w;
+			h = mPreparedBuffers[i].h;
+			masked = mPreparedBuffers[i].masked;
+			mPreparedBuffers.Delete(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FGLTexture::DiscardPreparedBuffers()
+{
+	for (auto &prep : mPreparedBuffers)
+	{
+		delete[] prep.buffer;
+		delete prep.compressed;
+	}
+	mPreparedBuffers.Clear();
+}
+
 //===========================================================================
 // 
 //	Create hardware texture for world use
@@ -450,29 +611,63 @@ const FHardwareTexture *FGLTexture::Bind(int texunit, int clampmode, int transla
 
 			// Create this texture
 			unsigned char * buffer = NULL;
+			FDXTImage *compressed = NULL;
+			FUncompressedHires uncompressed;
+			bool masked;
 			
-			if (!tex->bHasCanvas)
+			if (!tex->bHasCanvas && TakePreparedBuffer(translation, buffer, compressed, w, h, masked))
+			{
+				if (compressed != NULL) ApplyCompressedHires(compressed, masked);
+				else ApplySmoothedEdges(buffer, w, h, masked);
+			}
+			else if (!tex->bHasCanvas)
 			{
-				buffer = CreateTexBuffer(translation, w, h, hirescheck, true, alphatrans);
-				if (tex->bWarped && gl.legacyMode && w*h <= 256*256)	// do not software-warp larger textures, especially on the old systems that still need this fallback.
+				// Compressing takes far too long to do here, so an image that is
+				// not in the cache yet gets uploaded as it is this time.
+				if (!alphatrans) compressed = LoadCompressedHires(hirescheck, masked, &uncompressed);
+				if (compressed != NULL)
 				{
-					// need to do software warping
-					FWarpTexture *wt = static_cast<FWarpTexture*>(tex);
-					unsigned char *warpbuffer = new unsigned char[w*h*4];
-					WarpBuffer((uint32_t*)warpbuffer, (const uint32_t*)buffer, w, h, wt->WidthOffsetMultiplier, wt->HeightOffsetMultiplier, screen->FrameTime, wt->Speed, tex->bWarped);
-					delete[] buffer;
-					buffer = warpbuffer;
-					wt->GenTime[0] = screen->FrameTime;
+					ApplyCompressedHires(compressed, masked);
+				}
+				else if (uncompressed.buffer != NULL)
+				{
+					buffer = uncompressed.buffer;
+					w = uncompressed.w;
+					h = uncompressed.h;
+					ApplySmoothedEdges(buffer, w, h, masked);
+				}
+				else
+				{
+					buffer = CreateTexBuffer(translation, w, h, hirescheck, true, alphatrans);
+					if (tex->bWarped && gl.legacyMode && w*h <= 256*256)	// do not software-warp larger textures, especially on the old systems that still need this fallback.
+					{
+						// need to do software warping
+						FWarpTexture *wt = static_cast<FWarpTexture*>(tex);
+						unsigned char *warpbuffer = new unsigned char[w*h*4];
+						WarpBuffer((uint32_t*)warpbuffer, (const uint32_t*)buffer, w, h, wt->WidthOffsetMultiplier, wt->HeightOffsetMultiplier, screen->FrameTime, wt->Speed, tex->bWarped);
+						delete[] buffer;
+						buffer = warpbuffer;
+						wt->GenTime[0] = screen->FrameTime;
+					}
+					tex->ProcessData(buffer, w, h, false);
 				}
-				tex->ProcessData(buffer, w, h, false);
 			}
-			if (!hwtex->CreateTexture(buffer, w, h, texunit, needmipmap, translation, "FGLTexture.Bind")) 
+			if (compressed != NULL)
+			{
+				hwtex->CreateCompressedTexture(compressed, texunit, translation, "FGLTexture.Bind");
+				delete compressed;
+			}
+			else if (!hwtex->CreateTexture(buffer, w, h, texunit, needmipmap, translation, "FGLTexture.Bind")) 
 			{
 				// could not create texture
 				delete[] buffer;
 				return NULL;
 			}
-			delete[] buffer;
+			if (uncompressed.buffer != NULL && !uncompressed.path.IsEmpty())
+			{
+				gl_CompressHiresInBackground(uncompressed.path, buffer, w, h, masked);
+			}
+			else delete[] buffer;
 		}
 		if (tex->bHasCanvas) static_cast<FCanvasTexture*>(tex)->NeedUpdate();
 		if (translation != lastTranslation) lastSampler = 254;
@@ -850,6 +1045,45 @@ void FMaterial::PrecacheList(SpriteHits &translations)
 	while(it.NextPair(pair)) Bind(0, pair->Key);
 }
 
+//===========================================================================
+//
+// Adds a request for creating the base layer's buffer for the given
+// translation on a worker thread, if the texture is not uploaded yet and
+// its creation does not depend on any other texture, or only on patches
+// that can be made ready for it in advance.
+// This must be called on the main thread.
+//
+//===========================================================================
+
+bool FMaterial::QueuePrepare(TArray<FPrepareRequest> &list, int translation)
+{
+	FTexture *basetex = mBaseLayer->tex;
+
+	if (basetex != tex) return false;
+	if (gl.legacyMode && basetex->gl_info.ParentTexture != nullptr) return false;
+
+	// Same translation mapping and hires check as in Bind with clamp mode 0.
+	if (translation <= 0) translation = -translation;
+	else translation = GLTranslationPalette::GetInternalTranslation(translation);
+
+	if (mBaseLayer->mHwTexture != nullptr && mBaseLayer->mHwTexture->GetTextureHandle(translation) != 0) return false;
+
+	for (auto &req : list)
+	{
+		// Unexpandable textures share one material for both uses.
+		if (req.gltex == mBaseLayer && req.translation == translation) return false;
+	}
+	if (!basetex->PrepareThreadedCopy()) return false;
+
+	FTexture *hirescheck = (tex->Scale.X == 1 && tex->Scale.Y == 1 && !mExpanded) ? tex : nullptr;
+	if (hirescheck != nullptr && gl_texture_usehires)
+	{
+		mBaseLayer->FindHiresTexture(hirescheck);
+	}
+	list.Push({ mBaseLayer, translation, hirescheck });
+	return true;
+}
+
 //===========================================================================
 //
 //
@@ -32,6 +32,15 @@ enum
 //
 //===========================================================================
 class FMaterial;
+class FGLTexture;
+
+// A texture buffer that can be created on a worker thread during precaching.
+struct FPrepareRequest
+{
+	FGLTexture *gltex;
+	int translation;
+	FTexture *hirescheck;
+};
 
 
 class FGLTexture
@@ -51,7 +60,33 @@ private:
 	uint8_t lastSampler;
 	int lastTranslation;
 
+	// Buffers that were created ahead of time by a precache worker and
+	// are waiting to be uploaded by Bind.
+	struct FPreparedBuffer
+	{
+		int translation;
+		int w, h;
+		unsigned char *buffer;
+		FDXTImage *compressed;	// instead of the buffer for a cached hires texture
+		bool masked;			// what smoothing the edges found; Bind applies it to the texture
+	};
+	TArray<FPreparedBuffer> mPreparedBuffers;
+
+	// A hires image that has not been compressed yet. Bind uploads it as it
+	// is and leaves the compression to a background thread.
+	struct FUncompressedHires
+	{
+		FString path;
+		unsigned char *buffer = nullptr;
+		int w, h;
+	};
+
+	void FindHiresTexture(FTexture *hirescheck);
 	unsigned char * LoadHiresTexture(FTexture *hirescheck, int *width, int *height);
+	FDXTImage *LoadCompressedHires(FTexture *hirescheck, bool &masked, FUncompressedHires *uncompressed = nullptr);
+	void ApplyCompressedHires(const FDXTImage *image, bool masked);
+	void ApplySmoothedEdges(const unsigned char *buffer, int w, int h, bool masked);
+	bool TakePreparedBuffer(int translation, unsigned char *&buffer, FDXTImage *&compressed, int &w, int &h, bool &masked);
 
 	FHardwareTexture *CreateHwTexture();
 
@@ -63,6 +98,9 @@ public:
 
 	unsigned char * CreateTexBuffer(int translation, int & w, int & h, FTexture *hirescheck, bool createexpanded = true, bool alphatrans = false);
 
+	void PrepareBuffer(int translation, FTexture *hirescheck);
+	void DiscardPreparedBuffers();
+
 	void Clean(bool all);
 	void CleanUnused(SpriteHits &usedtranslations);
 	int Dump(int i);
@@ -108,16 +146,35 @@ class FMaterial
 
 public:
 	FTexture *tex;
+
+	// Where the 2D drawer's atlas holds this material's image, per translation.
+	// page is -1 if the image cannot go into the atlas. Placements from an
+	// older generation of the atlas are no longer valid.
+	struct FAtlasPlacement
+	{
+		int translation;
+		int generation;
+		int page;
+		int x, y, w, h;		// the image's box in the page, without the border
+		float u1, v1, u2, v2;
+	};
+	TArray<FAtlasPlacement> mAtlasPlacements;
 	
 	FMaterial(FTexture *tex, bool forceexpand);
 	~FMaterial();
 	void Precache();
 	void PrecacheList(SpriteHits &translations);
+	bool QueuePrepare(TArray<FPrepareRequest> &list, int translation);
 	bool isMasked() const
 	{
 		return mBaseLayer->tex->bMasked;
 	}
 
+	int GetShaderIndex() const
+	{
+		return mShaderIndex;
+	}
+
 	int GetLayers() const
 	{
 		return mTextureLayers.Size() + 1;
@@ -49,6 +49,7 @@
 #include "gl/textures/gl_translate.h"
 #include "gl/models/gl_models.h"
 #include "stats.h"
+#include "parallel_for.h"
 
 //==========================================================================
 //
@@ -90,7 +91,14 @@ CUSTOM_CVAR(Bool, gl_texture_usehires, true, CVAR_ARCHIVE|CVAR_NOINITCALL)
 	if (GLRenderer != NULL) GLRenderer->FlushTextures();
 }
 
+// Uploads hires replacements DXT compressed and keeps the compressed copies in the cache directory.
+CUSTOM_CVAR(Bool, gl_texture_compresshires, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	if (GLRenderer != NULL) GLRenderer->FlushTextures();
+}
+
 CVAR(Bool, gl_precache, false, CVAR_ARCHIVE)
+EXTERN_CVAR(Bool, r_precache_multithread)
 
 TexFilter_s TexFilter[]={
 	{GL_NEAREST,					GL_NEAREST,		false},
@@ -624,6 +632,32 @@ static void PrecacheSprite(FTexture *tex, SpriteHits &hits)
 	if (gltex) gltex->PrecacheList(hits);
 }
 
+//==========================================================================
+//
+// Collects the texture buffers of one texture that can be created by a
+// worker thread ahead of the actual precaching.
+//
+//==========================================================================
+
+static void QueuePrepareTexture(TArray<FPrepareRequest> &list, FTexture *tex, int cache, SpriteHits *hits)
+{
+	if (cache & (FTextureManager::HIT_Wall | FTextureManager::HIT_Flat | FTextureManager::HIT_Sky))
+	{
+		FMaterial * gltex = FMaterial::ValidateTexture(tex, false);
+		if (gltex) gltex->QueuePrepare(list, 0);
+	}
+	if (hits != nullptr && hits->CountUsed() > 0)
+	{
+		FMaterial * gltex = FMaterial::ValidateTexture(tex, true);
+		if (gltex)
+		{
+			SpriteHits::Iterator it(*hits);
+			SpriteHits::Pair *pair;
+			while (it.NextPair(pair)) gltex->QueuePrepare(list, pair->Key);
+		}
+	}
+}
+
 //==========================================================================
 //
 // DFrameBuffer :: Precache
@@ -632,6 +666,11 @@ static void PrecacheSprite(FTexture *tex, SpriteHits &hits)
 
 void gl_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitlist)
 {
+	cycle_t marking, purging;
+	marking.Reset();
+	purging.Reset();
+	marking.Clock();
+
 	SpriteHits *spritelist = new SpriteHits[sprites.Size()];
 	SpriteHits **spritehitlist = new SpriteHits*[TexMan.NumTextures()];
 	TMap<PClassActor*, bool>::Iterator it(actorhitlist);
@@ -720,6 +759,9 @@ void gl_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 		}
 	}
 
+	marking.Unclock();
+	purging.Clock();
+
 	// delete everything unused before creating any new resources to avoid memory usage peaks.
 
 	// delete unused models
@@ -746,36 +788,96 @@ void gl_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 		}
 	}
 
+	purging.Unclock();
+
 	if (gl_precache)
 	{
-		cycle_t precache;
+		cycle_t precache, decoding, uploading, models;
 		precache.Reset();
+		decoding.Reset();
+		uploading.Reset();
+		models.Reset();
 		precache.Clock();
 
-		// cache all used textures
-		for (int i = cnt - 1; i >= 0; i--)
+		// The textures are processed in batches. The buffers of all textures
+		// in a batch that do not depend on other textures, and of composites
+		// whose patches are ready, are created in parallel
+		// first, then everything gets uploaded on this thread, which picks up
+		// the prepared buffers. The batches keep the memory for prepared but not
+		// yet uploaded buffers in check.
+		const unsigned batchsize = 256;
+		TArray<FPrepareRequest> requests;
+		TArray<unsigned> jobstart;
+		int numprepared = 0;
+
+		for (int i = cnt - 1; i >= 0; )
 		{
-			FTexture *tex = TexMan.ByIndex(i);
-			if (tex != nullptr)
+			int batchend = i;
+
+			requests.Clear();
+			jobstart.Clear();
+			for (; i >= 0 && requests.Size() < batchsize; i--)
 			{
-				PrecacheTexture(tex, texhitlist[i]);
-				if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CountUsed() > 0)
+				FTexture *tex = TexMan.ByIndex(i);
+				if (tex != nullptr && r_precache_multithread)
 				{
-					PrecacheSprite(tex, *spritehitlist[i]);
+					// All requests for one texture form a single job because
+					// they share the texture's pixel data.
+					unsigned start = requests.Size();
+					QueuePrepareTexture(requests, tex, texhitlist[i], spritehitlist[i]);
+					if (requests.Size() > start) jobstart.Push(start);
 				}
 			}
+			jobstart.Push(requests.Size());
+			numprepared += requests.Size();
+
+			decoding.Clock();
+			parallel_for(int(jobstart.Size() - 1), [&](int job)
+			{
+				FThreadedLumpAccess threaded;
+				for (unsigned j = jobstart[job]; j < jobstart[job + 1]; j++)
+				{
+					requests[j].gltex->PrepareBuffer(requests[j].translation, requests[j].hirescheck);
+				}
+			});
+			decoding.Unclock();
+
+			// cache all used textures
+			uploading.Clock();
+			for (int k = batchend; k > i; k--)
+			{
+				FTexture *tex = TexMan.ByIndex(k);
+				if (tex != nullptr)
+				{
+					PrecacheTexture(tex, texhitlist[k]);
+					if (spritehitlist[k] != nullptr && (*spritehitlist[k]).CountUsed() > 0)
+					{
+						PrecacheSprite(tex, *spritehitlist[k]);
+					}
+				}
+			}
+			for (auto &req : requests)
+			{
+				// Anything that did not get used by the upload is not needed anymore.
+				req.gltex->DiscardPreparedBuffers();
+			}
+			uploading.Unclock();
 		}
 
 		// cache all used models
+		models.Clock();
 		FGLModelRenderer renderer;
 		for (unsigned i = 0; i < Models.Size(); i++)
 		{
 			if (modellist[i]) 
 				Models[i]->BuildVertexBuffer(&renderer);
 		}
+		models.Unclock();
 
 		precache.Unclock();
 		DPrintf(DMSG_NOTIFY, "Textures precached in %.3f ms\n", precache.TimeMS());
+		DPrintf(DMSG_NOTIFY, "  marking %.3f ms, purging %.3f ms, decoding %.3f ms (%d buffers), uploading %.3f ms, models %.3f ms\n",
+			marking.TimeMS(), purging.TimeMS(), decoding.TimeMS(), numprepared, uploading.TimeMS(), models.TimeMS());
 	}
 
 	delete[] spritehitlist;
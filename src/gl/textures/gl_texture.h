@@ -26,5 +26,11 @@ unsigned char *gl_CreateUpsampledTextureBuffer ( const FTexture *inputTexture, u
 int CheckDDPK3(FTexture *tex);
 int CheckExternalFile(FTexture *tex, bool & hascolorkey);
 
+struct FDXTImage;
+FString gl_GetHiresCachePath(int lump, bool hascolorkey);
+FDXTImage *gl_ReadHiresCache(const FString &path, int width, int height, bool &masked);
+void gl_WriteHiresCache(const FString &path, const FDXTImage *image, bool masked);
+void gl_CompressHiresInBackground(const FString &path, unsigned char *buffer, int width, int height, bool masked);
+
 #endif	// __GL_HQRESIZE_H__
 
@@ -68,9 +68,12 @@ glcycle_t ProcessAll, PostProcess;
 glcycle_t RenderAll;
 glcycle_t Dirty;
 glcycle_t drawcalls;
+glcycle_t FlatUpdate;
 int vertexcount, flatvertices, flatprimitives;
+int flatupdateplanes, flatupdatevertices, flatupdateranges;
 
 int rendered_lines,rendered_flats,rendered_sprites,render_vertexsplit,render_texsplit,rendered_decals, rendered_portals;
+int sprite_candidates, culled_sprites;
 int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
 
 double		gl_SecondsPerCycle = 1e-8;
@@ -151,9 +154,12 @@ void ResetProfilingData()
 	RenderSprite.Reset();
 	SetupSprite.Reset();
 	drawcalls.Reset();
+	FlatUpdate.Reset();
 
 	flatvertices=flatprimitives=vertexcount=0;
+	flatupdateplanes=flatupdatevertices=flatupdateranges=0;
 	render_texsplit=render_vertexsplit=rendered_lines=rendered_flats=rendered_sprites=rendered_decals=rendered_portals = 0;
+	sprite_candidates=culled_sprites=0;
 }
 
 //-----------------------------------------------------------------------------
@@ -181,8 +187,12 @@ static void AppendRenderStats(FString &out)
 {
 	out.AppendFormat("Walls: %d (%d splits, %d t-splits, %d vertices)\n"
 		"Flats: %d (%d primitives, %d vertices)\n"
-		"Sprites: %d, Decals=%d, Portals: %d\n",
-		rendered_lines, render_vertexsplit, render_texsplit, vertexcount, rendered_flats, flatprimitives, flatvertices, rendered_sprites,rendered_decals, rendered_portals );
+		"Flat updates: %d planes, %d vertices, %d copies, %2.3f ms\n"
+		"Sprites: %d, Decals=%d, Portals: %d\n"
+		"Sprite culling: %d candidates, %d culled\n",
+		rendered_lines, render_vertexsplit, render_texsplit, vertexcount, rendered_flats, flatprimitives, flatvertices,
+		flatupdateplanes, flatupdatevertices, flatupdateranges, FlatUpdate.TimeMS(), rendered_sprites,rendered_decals, rendered_portals,
+		sprite_candidates, culled_sprites );
 }
 
 static void AppendLightStats(FString &out)
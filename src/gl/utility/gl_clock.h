@@ -99,12 +99,15 @@ extern glcycle_t ProcessAll, PostProcess;
 extern glcycle_t RenderAll;
 extern glcycle_t Dirty;
 extern glcycle_t drawcalls;
+extern glcycle_t FlatUpdate;
 
 extern int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
 extern int rendered_lines,rendered_flats,rendered_sprites,rendered_decals,render_vertexsplit,render_texsplit;
 extern int rendered_portals;
+extern int sprite_candidates, culled_sprites;
 
 extern int vertexcount, flatvertices, flatprimitives;
+extern int flatupdateplanes, flatupdatevertices, flatupdateranges;
 
 void ResetProfilingData();
 void CheckBench();
@@ -61,6 +61,9 @@
 #include "d_player.h"
 #include "st_start.h"
 #include "m_misc.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "i_time.h"
 
 #include "i_net.h"
 
@@ -141,6 +144,117 @@ struct PreGamePacket
 
 uint8_t TransmitBuffer[TRANSMIT_SIZE];
 
+//==========================================================================
+//
+// Link simulation
+//
+// In-game packets can be held back and dropped on their way out to
+// emulate a bad connection, so netcode changes can be measured with
+// several instances on loopback (-host n / -join 127.0.0.1) instead of a
+// real network. Every instance conditions only what it sends, so the
+// round trip between two instances is twice net_simlatency. The pregame
+// handshake is never affected.
+//
+//==========================================================================
+
+CUSTOM_CVAR(Int, net_simlatency, 0, CVAR_NOSAVE)	// one-way delay in ms
+{
+	if (self < 0) self = 0;
+}
+CUSTOM_CVAR(Int, net_simjitter, 0, CVAR_NOSAVE)		// random extra delay in ms
+{
+	if (self < 0) self = 0;
+}
+CUSTOM_CVAR(Float, net_simloss, 0.f, CVAR_NOSAVE)	// percentage of packets dropped
+{
+	if (self < 0.f) self = 0.f;
+	else if (self > 100.f) self = 100.f;
+}
+
+struct FSimPacket
+{
+	uint64_t ReleaseTime;
+	int Node;
+	TArray<uint8_t> Data;
+};
+
+static TArray<FSimPacket> SimQueue;
+static int SimDropped;
+
+//==========================================================================
+//
+// SimFlush
+//
+// Sends all delayed packets whose time has come.
+//
+//==========================================================================
+
+static void SimFlush ()
+{
+	if (SimQueue.Size() == 0)
+		return;
+
+	uint64_t now = I_msTime();
+	for (unsigned i = 0; i < SimQueue.Size(); )
+	{
+		FSimPacket &packet = SimQueue[i];
+		if (packet.ReleaseTime <= now)
+		{
+			sendto(mysocket, (char *)packet.Data.Data(), packet.Data.Size(),
+				0, (sockaddr *)&sendaddress[packet.Node],
+				sizeof(sendaddress[packet.Node]));
+			SimQueue.Delete(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+//==========================================================================
+//
+// SimSend
+//
+// Sends a game packet, going through the link simulation if it is active.
+//
+//==========================================================================
+
+static int SimSend (const uint8_t *buffer, int len, int node)
+{
+	if (net_simlatency <= 0 && net_simjitter <= 0 && net_simloss <= 0)
+	{
+		return sendto(mysocket, (const char *)buffer, len, 0,
+			(sockaddr *)&sendaddress[node], sizeof(sendaddress[node]));
+	}
+
+	if (net_simloss > 0 && rand() < net_simloss * (RAND_MAX / 100.))
+	{
+		SimDropped++;
+		return len;
+	}
+
+	unsigned i = SimQueue.Reserve(1);
+	FSimPacket &packet = SimQueue[i];
+	packet.ReleaseTime = I_msTime() + net_simlatency;
+	if (net_simjitter > 0)
+	{
+		packet.ReleaseTime += rand() % (net_simjitter + 1);
+	}
+	packet.Node = node;
+	packet.Data.Resize(len);
+	memcpy(packet.Data.Data(), buffer, len);
+	SimFlush();
+	return len;
+}
+
+CCMD (net_simstatus)
+{
+	Printf("Latency: %d ms, jitter: %d ms, loss: %.1f%%\n",
+		*net_simlatency, *net_simjitter, *net_simloss);
+	Printf("%u packets in flight, %d dropped\n", SimQueue.Size(), SimDropped);
+}
+
 //
 // UDPsocket
 //
@@ -222,9 +336,8 @@ void PacketSend (void)
 	if (c == Z_OK && size < (uLong)doomcom.datalength)
 	{
 //		Printf("send %lu/%d\n", size, doomcom.datalength);
-		c = sendto(mysocket, (char *)TransmitBuffer, size,
-			0, (sockaddr *)&sendaddress[doomcom.remotenode],
-			sizeof(sendaddress[doomcom.remotenode]));
+		c = SimSend(TransmitBuffer, size, doomcom.remotenode);
+		Net_CountWireBytes(size, 0);
 	}
 	else
 	{
@@ -235,9 +348,8 @@ void PacketSend (void)
 		else
 		{
 //			Printf("send %d\n", doomcom.datalength);
-			c = sendto(mysocket, (char *)doomcom.data, doomcom.datalength,
-				0, (sockaddr *)&sendaddress[doomcom.remotenode],
-				sizeof(sendaddress[doomcom.remotenode]));
+			c = SimSend(doomcom.data, doomcom.datalength, doomcom.remotenode);
+			Net_CountWireBytes(doomcom.datalength, 0);
 		}
 	}
 	//	if (c == -1)
@@ -255,6 +367,8 @@ void PacketGet (void)
 	sockaddr_in fromaddress;
 	int node;
 
+	SimFlush();
+
 	fromlen = sizeof(fromaddress);
 	c = recvfrom (mysocket, (char*)TransmitBuffer, TRANSMIT_SIZE, 0,
 				  (sockaddr *)&fromaddress, &fromlen);
@@ -293,6 +407,7 @@ void PacketGet (void)
 	}
 	else if (node >= 0 && c > 0)
 	{
+		Net_CountWireBytes(0, c);
 		doomcom.data[0] = TransmitBuffer[0] & ~NCMD_COMPRESSED;
 		if (TransmitBuffer[0] & NCMD_COMPRESSED)
 		{
@@ -410,6 +525,7 @@ void BuildAddress (sockaddr_in *address, const char *name)
 
 void CloseNetwork (void)
 {
+	SimQueue.Clear();
 	if (mysocket != INVALID_SOCKET)
 	{
 		closesocket (mysocket);
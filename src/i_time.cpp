@@ -156,6 +156,14 @@ int I_WaitForTic(int prevtic)
 	return time;
 }
 
+double I_msUntilTic(int prevtic)
+{
+	const uint64_t next = FirstFrameStartTime + TicToNS(prevtic + 1);
+	const uint64_t now = I_nsTime();
+
+	return next > now ? (next - now) / 1'000'000. : 0.;
+}
+
 uint64_t I_nsTime()
 {
 	return GetClockTimeNS();
@@ -17,6 +17,9 @@ double I_GetTimeFrac();
 // like I_GetTime, except it waits for a new tic before returning
 int I_WaitForTic(int);
 
+// Returns the milliseconds left until the tic after prevtic begins
+double I_msUntilTic(int prevtic);
+
 // Freezes tic counting temporarily. While frozen, calls to I_GetTime()
 // will always return the same value.
 // You must also not call I_WaitForTic() while freezing time, since the
@@ -50,6 +50,10 @@
 #include "templates.h"
 #include "files.h"
 
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+
 // MACROS ------------------------------------------------------------------
 
 // The maximum size of an IDAT chunk ZDoom will write. This is also the
@@ -112,6 +116,7 @@ CUSTOM_CVAR(Int, png_level, 5, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 		self = 9;
 }
 CVAR(Float, png_gamma, 0.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR(Bool, png_fastdecode, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
@@ -466,12 +471,14 @@ void M_FreePNG (PNGHandle *png)
 //
 // ReadIDAT
 //
-// Reads image data out of a PNG
+// Reads image data out of a PNG, either into a buffer or, for 8 bit
+// images that are not interlaced, one row at a time into a callback.
 //
 //==========================================================================
 
-bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int pitch,
-				 uint8_t bitdepth, uint8_t colortype, uint8_t interlace, unsigned int chunklen)
+static bool ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int pitch,
+				 uint8_t bitdepth, uint8_t colortype, uint8_t interlace, unsigned int chunklen,
+				 const std::function<void(int, const uint8_t *)> *rowfunc)
 {
 	// Uninterlaced images are treated as a conceptual eighth pass by these tables.
 	static const uint8_t passwidthshift[8] =  { 3, 3, 2, 2, 1, 1, 0, 0 };
@@ -479,11 +486,11 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	static const uint8_t passrowoffset[8] =   { 0, 0, 4, 0, 2, 0, 1, 0 };
 	static const uint8_t passcoloffset[8] =   { 0, 4, 0, 2, 0, 1, 0, 0 };
 
-	Byte *inputLine, *prev, *curr, *adam7buff[3], *bufferend;
+	Byte *inputLine, *prev, *curr, *adam7buff[3];
 	Byte chunkbuffer[4096];
 	z_stream stream;
 	int err;
-	int i, pass, passbuff, passpitch, passwidth;
+	int i, pass, passbuff, passpitch, passwidth, y, ystep;
 	bool lastIDAT;
 	int bytesPerRowIn, bytesPerRowOut;
 	int bytesPerPixel;
@@ -497,9 +504,14 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	default:	bytesPerPixel = 1;		break;
 	}
 
+	if (rowfunc != nullptr && (interlace || bitdepth != 8))
+	{
+		return false;
+	}
+
 	bytesPerRowOut = width * bytesPerPixel;
 	i = 4 + bytesPerRowOut * 2;
-	if (interlace)
+	if (interlace || rowfunc != nullptr)
 	{
 		i += bytesPerRowOut * 2;
 	}
@@ -507,7 +519,6 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	adam7buff[0] = inputLine + 4 + bytesPerRowOut;
 	adam7buff[1] = adam7buff[0] + bytesPerRowOut;
 	adam7buff[2] = adam7buff[1] + bytesPerRowOut;
-	bufferend = buffer + pitch * height;
 
 	stream.next_in = Z_NULL;
 	stream.avail_in = 0;
@@ -526,7 +537,7 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	// before they're used, but it doesn't know that.
 	curr = prev = 0;
 	passwidth = passpitch = bytesPerRowIn = 0;
-	passbuff = 0;
+	passbuff = y = ystep = 0;
 
 	while (err != Z_STREAM_END && pass < 8 - interlace)
 	{
@@ -561,6 +572,8 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 			}
 			curr = buffer + rowoffset*pitch + coloffset*bytesPerPixel;
 			passpitch = pitch << passheightshift[pass];
+			y = rowoffset;
+			ystep = 1 << passheightshift[pass];
 			stream.next_out = inputLine;
 			stream.avail_out = bytesPerRowIn + 1;
 		}
@@ -580,7 +593,15 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 
 		if (stream.avail_out == 0)
 		{
-			if (pass >= 6)
+			if (rowfunc != nullptr)
+			{
+				// Unfilter into the row buffers and hand the row over
+				UnfilterRow (bytesPerRowIn, adam7buff[passbuff], inputLine, prev, bytesPerPixel);
+				prev = adam7buff[passbuff];
+				passbuff ^= 1;
+				(*rowfunc)(y, prev);
+			}
+			else if (pass >= 6)
 			{
 				// Store pixels directly into the output buffer
 				UnfilterRow (bytesPerRowIn, curr, inputLine, prev, bytesPerPixel);
@@ -646,7 +667,8 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 					break;
 				}
 			}
-			if ((curr += passpitch) >= bufferend)
+			curr += passpitch;
+			if ((y += ystep) >= height)
 			{
 				++pass;
 				initpass = true;
@@ -676,7 +698,7 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 
 	inflateEnd (&stream);
 
-	if (bitdepth < 8)
+	if (bitdepth < 8 && rowfunc == nullptr)
 	{
 		// Noninterlaced images must be unpacked completely.
 		// Interlaced images only need their final pass unpacked.
@@ -689,6 +711,18 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	return true;
 }
 
+bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int pitch,
+				 uint8_t bitdepth, uint8_t colortype, uint8_t interlace, unsigned int chunklen)
+{
+	return ReadIDAT (file, buffer, width, height, pitch, bitdepth, colortype, interlace, chunklen, nullptr);
+}
+
+bool M_ReadIDATRows (FileReader &file, int width, int height, uint8_t bitdepth, uint8_t colortype,
+				 uint8_t interlace, unsigned int chunklen, const std::function<void(int, const uint8_t *)> &rowfunc)
+{
+	return ReadIDAT (file, nullptr, width, height, 0, bitdepth, colortype, interlace, chunklen, &rowfunc);
+}
+
 // PRIVATE CODE ------------------------------------------------------------
 
 
@@ -1068,6 +1102,138 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 	return true;
 }
 
+#ifndef NO_SSE
+//==========================================================================
+//
+// UnfilterRowSSE2
+//
+// SSE2 versions of the PNG filters. Up works on 16 bytes at a time. Sub,
+// Average and Paeth depend on the pixel to the left, so they work on all
+// channels of one pixel at a time, which is only worth it for RGB and
+// RGBA. Returns false for the cases it does not handle.
+//
+//==========================================================================
+
+// RGB pixels are moved with 4 byte accesses, except for the last one of a
+// row. The byte that is read too much only ends up in the unused fourth
+// channel, and the byte written too much is overwritten by the next pixel.
+template<int bpp> static inline __m128i LoadPNGPixel (const uint8_t *p, bool last)
+{
+	uint32_t v = 0;
+	if (bpp == 4 || !last) memcpy (&v, p, 4);
+	else memcpy (&v, p, 3);
+	return _mm_cvtsi32_si128 (v);
+}
+
+template<int bpp> static inline void StorePNGPixel (uint8_t *p, __m128i v, bool last)
+{
+	uint32_t x = (uint32_t)_mm_cvtsi128_si32 (v);
+	if (bpp == 4 || !last) memcpy (p, &x, 4);
+	else memcpy (p, &x, 3);
+}
+
+template<int bpp> static void UnfilterPixelsSSE2 (int filter, int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	__m128i a = zero;
+	int x;
+
+	switch (filter)
+	{
+	case 1:		// Sub
+		for (x = 0; x < width; x += bpp)
+		{
+			bool last = x + bpp >= width;
+			a = _mm_add_epi8 (a, LoadPNGPixel<bpp> (row + x, last));
+			StorePNGPixel<bpp> (dest + x, a, last);
+		}
+		break;
+
+	case 3:		// Average
+	{
+		// _mm_avg_epu8 rounds up, the filter rounds down.
+		const __m128i one = _mm_set1_epi8 (1);
+		for (x = 0; x < width; x += bpp)
+		{
+			bool last = x + bpp >= width;
+			__m128i b = LoadPNGPixel<bpp> (prev + x, last);
+			__m128i avg = _mm_sub_epi8 (_mm_avg_epu8 (a, b), _mm_and_si128 (_mm_xor_si128 (a, b), one));
+			a = _mm_add_epi8 (avg, LoadPNGPixel<bpp> (row + x, last));
+			StorePNGPixel<bpp> (dest + x, a, last);
+		}
+		break;
+	}
+
+	case 4:		// Paeth
+	{
+		// Predictors are computed in 16 bits; a and c start out as 0 for the first pixel.
+		__m128i c = zero;
+		for (x = 0; x < width; x += bpp)
+		{
+			bool last = x + bpp >= width;
+			__m128i b = _mm_unpacklo_epi8 (LoadPNGPixel<bpp> (prev + x, last), zero);
+			__m128i pa = _mm_sub_epi16 (b, c);
+			__m128i pb = _mm_sub_epi16 (a, c);
+			__m128i pc = _mm_add_epi16 (pa, pb);
+			pa = _mm_max_epi16 (pa, _mm_sub_epi16 (zero, pa));
+			pb = _mm_max_epi16 (pb, _mm_sub_epi16 (zero, pb));
+			pc = _mm_max_epi16 (pc, _mm_sub_epi16 (zero, pc));
+
+			__m128i notusea = _mm_or_si128 (_mm_cmpgt_epi16 (pa, pb), _mm_cmpgt_epi16 (pa, pc));
+			__m128i notuseb = _mm_cmpgt_epi16 (pb, pc);
+			__m128i bc = _mm_or_si128 (_mm_andnot_si128 (notuseb, b), _mm_and_si128 (notuseb, c));
+			__m128i pred = _mm_or_si128 (_mm_andnot_si128 (notusea, a), _mm_and_si128 (notusea, bc));
+
+			__m128i d = _mm_add_epi8 (_mm_packus_epi16 (pred, pred), LoadPNGPixel<bpp> (row + x, last));
+			StorePNGPixel<bpp> (dest + x, d, last);
+			a = _mm_unpacklo_epi8 (d, zero);
+			c = b;
+		}
+		break;
+	}
+	}
+}
+
+static bool UnfilterRowSSE2 (int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev, int bpp)
+{
+	int filter = *row++;
+	int x;
+
+	switch (filter)
+	{
+	case 2:		// Up
+		for (x = 0; x + 16 <= width; x += 16)
+		{
+			__m128i v = _mm_add_epi8 (_mm_loadu_si128 ((const __m128i *)(row + x)), _mm_loadu_si128 ((const __m128i *)(prev + x)));
+			_mm_storeu_si128 ((__m128i *)(dest + x), v);
+		}
+		for (; x < width; ++x)
+		{
+			dest[x] = row[x] + prev[x];
+		}
+		return true;
+
+	case 1:		// Sub
+	case 3:		// Average
+	case 4:		// Paeth
+		if (bpp == 3)
+		{
+			UnfilterPixelsSSE2<3> (filter, width, dest, row, prev);
+			return true;
+		}
+		if (bpp == 4)
+		{
+			UnfilterPixelsSSE2<4> (filter, width, dest, row, prev);
+			return true;
+		}
+		return false;
+
+	default:
+		return false;
+	}
+}
+#endif
+
 //==========================================================================
 //
 // UnfilterRow
@@ -1082,6 +1248,13 @@ void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp
 {
 	int x;
 
+#ifndef NO_SSE
+	if (png_fastdecode && UnfilterRowSSE2 (width, dest, row, prev, bpp))
+	{
+		return;
+	}
+#endif
+
 	switch (*row++)
 	{
 	case 1:		// Sub
@@ -34,6 +34,7 @@
 */
 
 #include <stdio.h>
+#include <functional>
 #include "doomtype.h"
 #include "v_video.h"
 #include "files.h"
@@ -109,6 +110,12 @@ bool M_GetPNGText (PNGHandle *png, const char *keyword, char *buffer, size_t buf
 bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int pitch,
 				 uint8_t bitdepth, uint8_t colortype, uint8_t interlace, unsigned int idatlen);
 
+// Same as M_ReadIDAT, but passes every row to rowfunc as soon as it has been
+// decoded instead of storing the whole image. Only 8 bit images that are not
+// interlaced are supported; returns false for everything else.
+bool M_ReadIDATRows (FileReader &file, int width, int height, uint8_t bitdepth, uint8_t colortype,
+				 uint8_t interlace, unsigned int idatlen, const std::function<void(int, const uint8_t *)> &rowfunc);
+
 
 class FTexture;
 
@@ -180,6 +180,11 @@ public:
 	static void StaticWriteRNGState (FSerializer &file);
 	static FRandom *StaticFindRNG(const char *name);
 
+	// For code that has to refer to an RNG without having its name.
+	static FRandom *StaticFirstRNG() { return RNGList; }
+	FRandom *GetNextRNG() const { return Next; }
+	uint32_t GetNameCRC() const { return NameCRC; }
+
 #ifndef NDEBUG
 	static void StaticPrintSeeds ();
 #endif
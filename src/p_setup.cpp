@@ -119,6 +119,7 @@
 #include "i_time.h"
 #include "scripting/vm/vm.h"
 #include "s_music.h"
+#include <future>
 
 #include "fragglescript/t_fs.h"
 
@@ -148,6 +149,7 @@ CVAR (Bool, genblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, gennodes, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, genglnodes, false, CVAR_SERVERINFO);
 CVAR (Bool, showloadtimes, false, 0);
+CVAR (String, loadtimes_log, "", 0);	// if set, the load times of each level are appended to this file
 
 inline bool P_LoadBuildMap(uint8_t *mapdata, size_t len, FMapThing **things, int *numthings)
 {
@@ -2661,9 +2663,13 @@ bool FBlockmap::VerifyBlockMap(int count)
 //
 // killough 3/30/98: Rewritten to remove blockmap limit
 //
+// Returns false if the blockmap needs to be generated with P_CreateBlockMap.
+// That only reads the vertices and lines, so the caller can run it in the
+// background while the rest of the level is being set up.
+//
 //===========================================================================
 
-void P_LoadBlockMap (MapData * map)
+bool P_LoadBlockMap (MapData * map)
 {
 	int count = map->Size(ML_BLOCKMAP);
 
@@ -2673,7 +2679,7 @@ void P_LoadBlockMap (MapData * map)
 		)
 	{
 		DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-		P_CreateBlockMap ();
+		return false;
 	}
 	else
 	{
@@ -2703,18 +2709,33 @@ void P_LoadBlockMap (MapData * map)
 		if (!level.blockmap.VerifyBlockMap(count))
 		{
 			DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-			P_CreateBlockMap();
+			delete[] level.blockmap.blockmaplump;
+			level.blockmap.blockmaplump = nullptr;
+			return false;
 		}
 
 	}
+	return true;
+}
 
+//===========================================================================
+//
+// P_InitBlockLinks
+//
+// Sets up the blockmap header fields and the empty mobj chains once
+// the blockmap has been loaded or created.
+//
+//===========================================================================
+
+static void P_InitBlockLinks ()
+{
 	level.blockmap.bmaporgx = level.blockmap.blockmaplump[0];
 	level.blockmap.bmaporgy = level.blockmap.blockmaplump[1];
 	level.blockmap.bmapwidth = level.blockmap.blockmaplump[2];
 	level.blockmap.bmapheight = level.blockmap.blockmaplump[3];
 
 	// clear out mobj chains
-	count = level.blockmap.bmapwidth*level.blockmap.bmapheight;
+	int count = level.blockmap.bmapwidth*level.blockmap.bmapheight;
 	level.blockmap.blocklinks = new FBlockNode *[count];
 	memset (level.blockmap.blocklinks, 0, count*sizeof(*level.blockmap.blocklinks));
 	level.blockmap.blockmap = level.blockmap.blockmaplump+4;
@@ -3640,8 +3661,20 @@ void P_SetupLevel(const char *lumpname, int position, bool newGame)
 	// set the head node for gameplay purposes. If the separate gamenodes array is not empty, use that, otherwise use the render nodes.
 	level.headgamenode = level.gamenodes.Size() > 0 ? &level.gamenodes[level.gamenodes.Size() - 1] : level.nodes.Size() ? &level.nodes[level.nodes.Size() - 1] : nullptr;
 
+	// Generating a blockmap only depends on the vertices and lines, so for maps
+	// without a usable one it runs in the background while the sectors are being set up.
+	// The future is destroyed before the times array, so the job also gets joined if one of the following functions throws an error.
+	std::future<void> blockmapjob;
 	times[10].Clock();
-	P_LoadBlockMap(map);
+	if (!P_LoadBlockMap(map))
+	{
+		blockmapjob = std::async(std::launch::async, [&]()
+		{
+			times[19].Clock();
+			P_CreateBlockMap();
+			times[19].Unclock();
+		});
+	}
 	times[10].Unclock();
 
 	times[11].Clock();
@@ -3656,6 +3689,11 @@ void P_SetupLevel(const char *lumpname, int position, bool newGame)
 	P_FloodZones();
 	times[13].Unclock();
 
+	times[18].Clock();
+	if (blockmapjob.valid()) blockmapjob.get();
+	P_InitBlockLinks();
+	times[18].Unclock();
+
 	// --------------------------------------------------------
 	// Bake Static Geometry (OBJ Generation)
 	// --------------------------------------------------------
@@ -3891,35 +3929,49 @@ void P_SetupLevel(const char *lumpname, int position, bool newGame)
 	P_ResetSightCounters(true);
 	//Printf ("free memory: 0x%x\n", Z_FreeMemory());
 
+	static const char *timenames[] =
+	{
+		"load vertexes",
+		"load sectors",
+		"load sides",
+		"load lines",
+		"load sides 2",
+		"load lines 2",
+		"loop sides",
+		"load subsectors",
+		"load nodes",
+		"load segs",
+		"load blockmap",
+		"load reject",
+		"group lines",
+		"flood zones",
+		"load things",
+		"translate teleports",
+		"init polys",
+		"precache",
+		"wait for blockmap",
+		"create blockmap (background)"
+	};
 	if (showloadtimes)
 	{
 		Printf("---Total load times---\n");
-		for (i = 0; i < 18; ++i)
-		{
-			static const char *timenames[] =
-			{
-				"load vertexes",
-				"load sectors",
-				"load sides",
-				"load lines",
-				"load sides 2",
-				"load lines 2",
-				"loop sides",
-				"load subsectors",
-				"load nodes",
-				"load segs",
-				"load blockmap",
-				"load reject",
-				"group lines",
-				"flood zones",
-				"load things",
-				"translate teleports",
-				"init polys",
-				"precache"
-			};
+		for (i = 0; i < (int)countof(timenames); ++i)
+		{
 			Printf("Time%3d:%9.4f ms (%s)\n", i, times[i].TimeMS(), timenames[i]);
 		}
 	}
+	if (*loadtimes_log != 0)
+	{
+		FILE *log = fopen(loadtimes_log, "a");
+		if (log != nullptr)
+		{
+			for (i = 0; i < (int)countof(timenames); ++i)
+			{
+				fprintf(log, "%s\t%s\t%.4f\n", lumpname, timenames[i], times[i].TimeMS());
+			}
+			fclose(log);
+		}
+	}
 	MapThingsConverted.Clear();
 	MapThingsUserDataIndex.Clear();
 	MapThingsUserData.Clear();
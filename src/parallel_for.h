@@ -27,6 +27,7 @@
 
 #ifdef HAVE_PARALLEL_FOR
 
+// concurrency::parallel_for already passes exceptions on to the calling thread.
 #include <ppl.h>
 
 template <typename Index, typename Function>
@@ -35,19 +36,61 @@ inline void parallel_for(const Index first, const Index last, const Index step,
 	concurrency::parallel_for(first, last, step, function);
 }
 
-#elif defined HAVE_DISPATCH_APPLY
+#else
+
+#include <exception>
+#include <mutex>
+
+// An exception must not leave a worker thread, that would terminate the
+// process. The first one is kept and rethrown on the calling thread once
+// all slices are done.
+class FParallelException
+{
+	std::mutex mutex;
+	std::exception_ptr exception;
+
+public:
+	template <typename Function>
+	void Run(const Function& function)
+	{
+		try
+		{
+			function();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!exception) exception = std::current_exception();
+		}
+	}
+
+	void Rethrow()
+	{
+		if (exception) std::rethrow_exception(exception);
+	}
+};
+
+#ifdef HAVE_DISPATCH_APPLY
 
 #include <dispatch/dispatch.h>
 
 template <typename Index, typename Function>
 inline void parallel_for(const Index first, const Index last, const Index step, const Function& function)
 {
+	if (last <= first) return;
+
 	const dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	FParallelException error;
+	FParallelException *errorptr = &error;	// blocks would copy the object itself
 
-	dispatch_apply((last - first) / step + 1, queue, ^(size_t slice)
+	dispatch_apply((last - first + step - 1) / step, queue, ^(size_t slice)
 	{
-		function(slice * step);
+		const Index i = Index(first + slice * step);
+		if (i >= last) return;
+		errorptr->Run([&]() { function(i); });
 	});
+
+	error.Rethrow();
 }
 
 #else // Generic loop with optional OpenMP parallelization
@@ -55,13 +98,18 @@ inline void parallel_for(const Index first, const Index last, const Index step,
 template <typename Index, typename Function>
 inline void parallel_for(const Index first, const Index last, const Index step, const Function& function)
 {
+	FParallelException error;
+
 #pragma omp parallel for
 	for (Index i = first; i < last; i += step)
 	{
-		function(i);
+		error.Run([&]() { function(i); });
 	}
+
+	error.Rethrow();
 }
 
+#endif // HAVE_DISPATCH_APPLY
 #endif // HAVE_PARALLEL_FOR
 
 template <typename Index, typename Function>
@@ -37,6 +37,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <mutex>
 #include "doomtype.h"
 #include "i_system.h"
 #include "sc_man.h"
@@ -1189,6 +1190,10 @@ void FScriptPosition::Message (int severity, const char *message, ...) const
 	const char *color;
 	int level = PRINT_HIGH;
 
+	// The script compiler can emit code on several threads.
+	static std::mutex lock;
+	std::lock_guard<std::mutex> guard(lock);
+
 	switch (severity)
 	{
 	default:
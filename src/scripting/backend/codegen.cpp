@@ -2900,6 +2900,12 @@ error:
 //
 //==========================================================================
 
+unsigned *FxAddSub::TextureCountAddress()
+{
+	auto * ptr = (FArray*)&TexMan.Textures;
+	return &ptr->Count;
+}
+
 ExpEmit FxAddSub::Emit(VMFunctionBuilder *build)
 {
 	assert(Operator == '+' || Operator == '-');
@@ -2984,11 +2990,9 @@ ExpEmit FxAddSub::Emit(VMFunctionBuilder *build)
 
 texcheck:
 	// Do a bounds check for the texture index. Note that count can change at run time so this needs to read the value from the texture manager.
-	auto * ptr = (FArray*)&TexMan.Textures;
-	auto * countptr = &ptr->Count;
 	ExpEmit bndp(build, REGT_POINTER);
 	ExpEmit bndc(build, REGT_INT);
-	build->Emit(OP_LKP, bndp.RegNum, build->GetConstantAddress(countptr));
+	build->Emit(OP_LKP, bndp.RegNum, build->GetConstantAddress(TextureCountAddress()));
 	build->Emit(OP_LW, bndc.RegNum, bndp.RegNum, build->GetConstantInt(0));
 	build->Emit(OP_BOUND_R, to.RegNum, bndc.RegNum);
 	bndp.Free(build);
@@ -6826,6 +6830,41 @@ FxExpression *FxCVar::Resolve(FCompileContext &ctx)
 	return this;
 }
 
+void *FxCVar::ValueAddress(FBaseCVar *cvar)
+{
+	switch (cvar->GetRealType())
+	{
+	case CVAR_Int:
+		return &static_cast<FIntCVar *>(cvar)->Value;
+
+	case CVAR_Color:
+		return &static_cast<FColorCVar *>(cvar)->Value;
+
+	case CVAR_Float:
+		return &static_cast<FFloatCVar *>(cvar)->Value;
+
+	case CVAR_Bool:
+		return &static_cast<FBoolCVar *>(cvar)->Value;
+
+	case CVAR_String:
+		return &static_cast<FStringCVar *>(cvar)->Value;
+
+	case CVAR_DummyBool:
+	{
+		auto vcv = &static_cast<FFlagCVar *>(cvar)->ValueVar;
+		if (vcv == &compatflags) return &i_compatflags;
+		else if (vcv == &compatflags2) return &i_compatflags2;
+		else return &vcv->Value;
+	}
+
+	case CVAR_DummyInt:
+		return &static_cast<FMaskCVar *>(cvar)->ValueVar.Value;
+
+	default:
+		return nullptr;
+	}
+}
+
 ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 {
 	ExpEmit dest(build, CVar->GetRealType() == CVAR_String ? REGT_STRING : ValueType->GetRegType());
@@ -6834,39 +6873,30 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	switch (CVar->GetRealType())
 	{
 	case CVAR_Int:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FIntCVar *>(CVar)->Value));
-		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
-		break;
-
 	case CVAR_Color:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FColorCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Float:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FFloatCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LSP, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Bool:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FBoolCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LBU, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_String:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FStringCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LCS, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_DummyBool:
 	{
-		int *pVal;
 		auto cv = static_cast<FFlagCVar *>(CVar);
-		auto vcv = &cv->ValueVar;
-		if (vcv == &compatflags) pVal = &i_compatflags;
-		else if (vcv == &compatflags2) pVal = &i_compatflags2;
-		else pVal = &vcv->Value;
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(pVal));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(1));
@@ -6876,7 +6906,7 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	case CVAR_DummyInt:
 	{
 		auto cv = static_cast<FMaskCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(cv->BitVal));
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
@@ -9210,6 +9240,17 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 
 	VMFunction *vmfunc = Function->Variants[0].Implementation;
 	bool staticcall = ((vmfunc->VarFlags & VARF_Final) || vmfunc->VirtualIndex == ~0u || NoVirtual);
+	bool devirtualized = false;
+
+	// A virtual function that no class overrides can be called directly, just like a final one.
+	if (!staticcall && !(vmfunc->VarFlags & VARF_Abstract) && Self != nullptr && Self->ValueType->isObjectPointer())
+	{
+		auto cls = static_cast<PObjectPointer *>(Self->ValueType)->PointedClass();
+		if (cls != nullptr && cls->Virtuals.Size() > vmfunc->VirtualIndex && cls->Virtuals[vmfunc->VirtualIndex] == vmfunc)
+		{
+			staticcall = devirtualized = !FunctionBuildList.IsOverridden(vmfunc);
+		}
+	}
 
 	count = 0;
 	FunctionCallEmitter emitters(vmfunc);
@@ -9221,6 +9262,15 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 		selfemit = Self->Emit(build);
 		assert(selfemit.RegType == REGT_POINTER || selfemit.RegType == REGT_STRING || (selfemit.Fixed && selfemit.Target));
 
+		if (devirtualized)
+		{
+			// The vtable lookup would have aborted on a null self, so the direct call needs to check that itself.
+			assert(selfemit.RegType == REGT_POINTER && !selfemit.Konst);
+			build->Emit(OP_EQA_K, 0, selfemit.RegNum, build->GetConstantAddress(nullptr));
+			build->Emit(OP_JMP, 1);
+			build->Emit(OP_THROW, 2, X_READ_NIL);
+		}
+
 		int innerside = FScopeBarrier::SideFromFlags(Function->Variants[0].Flags);
 
 		if (innerside == FScopeBarrier::Side_Virtual)
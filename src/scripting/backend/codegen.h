@@ -106,7 +106,8 @@ struct FCompileContext
 
 //==========================================================================
 //
-//
+// Strings are always copied, not shared, so that constants of different
+// functions can be emitted on different threads.
 //
 //==========================================================================
 
@@ -137,7 +138,7 @@ struct ExpVal
 	ExpVal(const FString &str)
 	{
 		Type = TypeString;
-		::new(&pointer) FString(str);
+		::new(&pointer) FString(str.GetChars(), str.Len());
 	}
 
 	ExpVal(const ExpVal &o)
@@ -145,7 +146,7 @@ struct ExpVal
 		Type = o.Type;
 		if (o.Type == TypeString)
 		{
-			::new(&pointer) FString(*(FString *)&o.pointer);
+			::new(&pointer) FString(((FString *)&o.pointer)->GetChars(), ((FString *)&o.pointer)->Len());
 		}
 		else
 		{
@@ -162,7 +163,7 @@ struct ExpVal
 		Type = o.Type;
 		if (o.Type == TypeString)
 		{
-			::new(&pointer) FString(*(FString *)&o.pointer);
+			::new(&pointer) FString(((FString *)&o.pointer)->GetChars(), ((FString *)&o.pointer)->Len());
 		}
 		else
 		{
@@ -197,7 +198,7 @@ struct ExpVal
 
 	const FString GetString() const
 	{
-		return Type == TypeString ? *(FString *)&pointer : Type == TypeName ? FString(FName(ENamedName(Int)).GetChars()) : "";
+		return Type == TypeString ? FString(((FString *)&pointer)->GetChars(), ((FString *)&pointer)->Len()) : Type == TypeName ? FString(FName(ENamedName(Int)).GetChars()) : "";
 	}
 
 	bool GetBool() const
@@ -941,6 +942,9 @@ public:
 	FxAddSub(int, FxExpression*, FxExpression*);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+
+	// The texture count that the bounds check for texture IDs reads.
+	static unsigned *TextureCountAddress();
 };
 
 //==========================================================================
@@ -1384,6 +1388,9 @@ public:
 	FxCVar(FBaseCVar*, const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+
+	// The address the emitted code reads the CVar's value from.
+	static void *ValueAddress(FBaseCVar *cvar);
 };
 
 
@@ -40,6 +40,11 @@
 #include "scripting/vm/jit.h"
 #include "doomerrors.h"
 #include "vmintern.h"
+#include "vmcache.h"
+#include "stats.h"
+#include "c_dispatch.h"
+#include "v_text.h"
+#include "parallel_for.h"
 
 struct VMRemap
 {
@@ -752,6 +757,177 @@ void VMFunctionBuilder::BackpatchListToHere(TArray<size_t> &locs)
 		Backpatch(loc, Code.Size());
 }
 
+//==========================================================================
+//
+// VMFunctionBuilder :: Optimize
+//
+// Cleans up the emitted code before it gets turned into a function.
+// Jumps to jumps are threaded to their final target and jumps to a
+// return are replaced by the return itself. Afterward all unreachable
+// code, moves of a register onto itself and jumps to the next
+// instruction are removed.
+//
+// Returns the number of instructions that got removed.
+//
+//==========================================================================
+
+static bool SkipsNext(int op)
+{
+	// These conditionally skip the following instruction, so that one must stay where it is.
+	return op == OP_TEST || op == OP_TESTN || op == OP_CMPS || (OpInfo[op].Mode & MODE_ATYPE) == MODE_ACMP;
+}
+
+static bool IsFinalReturn(const VMOP &op)
+{
+	if (op.op == OP_RET) return op.b == REGT_NIL || (op.a & RET_FINAL);
+	if (op.op == OP_RETI) return (op.a & RET_FINAL) != 0;
+	return false;
+}
+
+int VMFunctionBuilder::Optimize()
+{
+	enum
+	{
+		PINNED = 1,		// must remain a jump at this location
+		REACHABLE = 2,
+		REMOVED = 4,
+	};
+
+	const int count = Code.Size();
+	if (count == 0) return 0;
+
+	TArray<uint8_t> flags;
+	flags.Resize(count);
+	memset(&flags[0], 0, count);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (SkipsNext(Code[i].op) && i + 1 < count)
+		{
+			flags[i + 1] |= PINNED;
+		}
+		else if (Code[i].op == OP_IJMP)
+		{
+			for (int j = i + 1; j <= i + Code[i].i16 && j < count; j++)
+			{
+				flags[j] |= PINNED;
+			}
+		}
+	}
+
+	// Thread jumps. Following a chain can never take more steps than there are instructions, so this also terminates for jumps to themselves.
+	for (int i = 0; i < count; i++)
+	{
+		if (Code[i].op != OP_JMP) continue;
+
+		int dest = i + 1 + Code[i].i24;
+		for (int n = 0; n < count && dest >= 0 && dest < count && Code[dest].op == OP_JMP; n++)
+		{
+			dest += 1 + Code[dest].i24;
+		}
+		if (!(flags[i] & PINNED) && dest >= 0 && dest < count && IsFinalReturn(Code[dest]))
+		{
+			Code[i] = Code[dest];
+		}
+		else
+		{
+			Code[i].i24 = dest - i - 1;
+		}
+	}
+
+	// Find everything that can actually be executed.
+	TArray<int> work;
+	auto visit = [&](int j)
+	{
+		if (j >= 0 && j < count && !(flags[j] & REACHABLE))
+		{
+			flags[j] |= REACHABLE;
+			work.Push(j);
+		}
+	};
+	visit(0);
+	int pc;
+	while (work.Pop(pc))
+	{
+		const VMOP &op = Code[pc];
+		if (op.op == OP_JMP)
+		{
+			visit(pc + 1 + op.i24);
+		}
+		else if (op.op == OP_IJMP)
+		{
+			for (int j = 1; j <= op.i16; j++) visit(pc + j);
+		}
+		else if (!IsFinalReturn(op))
+		{
+			visit(pc + 1);
+			if (SkipsNext(op.op)) visit(pc + 2);
+		}
+	}
+
+	TArray<int> remap;
+	remap.Resize(count + 1);
+	int newcount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const VMOP &op = Code[i];
+		bool remove = !(flags[i] & REACHABLE);
+		if (!remove && !(flags[i] & PINNED))
+		{
+			switch (op.op)
+			{
+			case OP_NOP:
+				remove = true;
+				break;
+
+			case OP_JMP:
+				remove = op.i24 == 0;
+				break;
+
+			case OP_MOVE:
+			case OP_MOVEF:
+			case OP_MOVES:
+			case OP_MOVEA:
+			case OP_MOVEV2:
+			case OP_MOVEV3:
+				remove = op.a == op.b;
+				break;
+			}
+		}
+		// A removed instruction's address is taken over by the next one that remains, so jumps to it still do the same thing.
+		remap[i] = newcount;
+		if (remove) flags[i] |= REMOVED;
+		else newcount++;
+	}
+	remap[count] = newcount;
+	if (newcount == count) return 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (flags[i] & REMOVED) continue;
+		VMOP op = Code[i];
+		if (op.op == OP_JMP)
+		{
+			int dest = i + 1 + op.i24;
+			assert(dest >= 0 && dest <= count);
+			op.i24 = remap[dest] - remap[i] - 1;
+		}
+		Code[remap[i]] = op;
+	}
+	Code.Resize(newcount);
+
+	// Statements whose code got removed entirely are superseded by the following entry.
+	unsigned lines = 0;
+	for (auto si : LineNumbers)
+	{
+		if (si.InstructionIndex <= count) si.InstructionIndex = (uint16_t)remap[si.InstructionIndex];
+		if (lines > 0 && LineNumbers[lines - 1].InstructionIndex == si.InstructionIndex) lines--;
+		LineNumbers[lines++] = si;
+	}
+	LineNumbers.Resize(lines);
+	return count - newcount;
+}
+
 //==========================================================================
 //
 // FFunctionBuildList
@@ -813,23 +989,120 @@ VMFunction *FFunctionBuildList::AddFunction(PNamespace *gnspc, const VersionInfo
 }
 
 
+//==========================================================================
+//
+// NumArgs for the VMFunction must be the amount of stack elements, which can
+// differ from the amount of logical function arguments if vectors are in the
+// list. For the VM a vector is 2 or 3 args, depending on size.
+//
+//==========================================================================
+
+static void SetNumArgs(VMScriptFunction *sfunc, PFunction *func)
+{
+	sfunc->NumArgs = 0;
+	auto &funcVariant = func->Variants[0];
+	for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
+	{
+		auto argType = funcVariant.Proto->ArgumentTypes[i];
+		auto argFlags = funcVariant.ArgFlags[i];
+		if (argFlags & VARF_Out)
+		{
+			auto argPointer = NewPointer(argType);
+			sfunc->NumArgs += argPointer->GetRegCount();
+		}
+		else
+		{
+			sfunc->NumArgs += argType->GetRegCount();
+		}
+	}
+}
+
+//==========================================================================
+//
+// FBuildJob
+//
+// A function between resolving it and turning its code into a VM function.
+// Everything the code generator needs to emit the code lives in its own
+// builder, including the constant tables.
+//
+//==========================================================================
+
+struct FBuildJob
+{
+	VMFunctionBuilder *Builder = nullptr;		// null if there is nothing to emit
+	VMFunctionBuilder *Unoptimized = nullptr;	// only with -checkvmopt
+	FString Error;
+	int Emitted = 0;
+	int Removed = 0;
+	bool Restored = false;
+	bool Failed = false;
+	bool Unsafe = false;
+	bool Cacheable = false;
+};
+
+//==========================================================================
+//
+// FFunctionBuildList :: Build
+//
+// Normally every function gets resolved and emitted before the next one.
+// With -parallelvmbuild all functions get resolved first, because that
+// changes global state, and then the code gets emitted and optimized on
+// several threads. The functions are made from it in the original order,
+// so the result is the same as with a serial build. -checkvmcache can
+// verify this against a cache that was written by a serial build.
+//
+//==========================================================================
+
 void FFunctionBuildList::Build()
 {
 	VMDisassemblyDumper disasmdump(VMDisassemblyDumper::Overwrite);
-
-	for (auto &item : mItems)
+	// -novmopt emits the code exactly as generated, to compare against the optimized output.
+	bool optimize = !Args->CheckParm("-novmopt");
+	// -checkvmopt also keeps the unoptimized code, so that bench_vm can compare both.
+	bool keepunoptimized = optimize && Args->CheckParm("-checkvmopt");
+	bool parallel = !!Args->CheckParm("-parallelvmbuild");
+	int emitted = 0, removed = 0, built = 0;
+	cycle_t resolvetime, emittime;
+	resolvetime.Reset();
+	emittime.Reset();
+
+	FVMCodeCache cache;
+	cache.Open(mItems.Size(), optimize);
+	mUnoptimized.Clear();
+
+	TArray<FBuildJob> jobs;
+	jobs.Resize(mItems.Size());
+
+	auto resolve = [&](unsigned index)
 	{
+		auto &item = mItems[index];
+		auto &job = jobs[index];
+
 		// [Player701] Do not emit code for abstract functions
 		bool isAbstract = (item.Func->Variants[0].Implementation->VarFlags & VARF_Abstract) != 0;
-		if (isAbstract) continue;
+		if (isAbstract)
+		{
+			return;
+		}
 
 		assert(item.Code != NULL);
 
+		if (cache.Restore(index, item.PrintableName, item.Func, item.Function))
+		{
+			job.Restored = true;
+			return;
+		}
+
+		// State label constants are indices into StateLabels, which only gets filled by
+		// Resolve. Functions that add labels must not be cached, since a restored
+		// function would refer to labels that were never added.
+		unsigned labelsize = StateLabels.Storage.Size();
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
 
 		// Allocate registers for the function's arguments and create local variable nodes before starting to resolve it.
-		VMFunctionBuilder buildit(item.Func->GetImplicitArgs());
+		auto buildit = new VMFunctionBuilder(item.Func->GetImplicitArgs());
 		for (unsigned i = 0; i < item.Func->Variants[0].Proto->ArgumentTypes.Size(); i++)
 		{
 			auto type = item.Func->Variants[0].Proto->ArgumentTypes[i];
@@ -837,97 +1110,336 @@ void FFunctionBuildList::Build()
 			auto flags = item.Func->Variants[0].ArgFlags[i];
 			// this won't get resolved and won't get emitted. It is only needed so that the code generator can retrieve the necessary info about this argument to do its work.
 			auto local = new FxLocalVariableDeclaration(type, name, nullptr, flags, FScriptPosition());
-			if (!(flags & VARF_Out)) local->RegNum = buildit.Registers[type->GetRegType()].Get(type->GetRegCount());
-			else local->RegNum = buildit.Registers[REGT_POINTER].Get(1);
+			if (!(flags & VARF_Out)) local->RegNum = buildit->Registers[type->GetRegType()].Get(type->GetRegCount());
+			else local->RegNum = buildit->Registers[REGT_POINTER].Get(1);
 			ctx.FunctionArgs.Push(local);
 		}
 
 		FScriptPosition::StrictErrors = !item.FromDecorate;
+		resolvetime.Clock();
 		item.Code = item.Code->Resolve(ctx);
+		resolvetime.Unclock();
 		// If we need extra space, load the frame pointer into a register so that we do not have to call the wasteful LFP instruction more than once.
 		if (item.Function->ExtraSpace > 0)
 		{
-			buildit.FramePointer = ExpEmit(&buildit, REGT_POINTER);
-			buildit.FramePointer.Fixed = true;
-			buildit.Emit(OP_LFP, buildit.FramePointer.RegNum);
+			buildit->FramePointer = ExpEmit(buildit, REGT_POINTER);
+			buildit->FramePointer.Fixed = true;
+			buildit->Emit(OP_LFP, buildit->FramePointer.RegNum);
 		}
 
 		// Make sure resolving it didn't obliterate it.
-		if (item.Code != nullptr)
+		if (item.Code == nullptr)
 		{
-			if (!item.Code->CheckReturn())
-			{
-				auto newcmpd = new FxCompoundStatement(item.Code->ScriptPosition);
-				newcmpd->Add(item.Code);
-				newcmpd->Add(new FxReturnStatement(nullptr, item.Code->ScriptPosition));
-				item.Code = newcmpd->Resolve(ctx);
-			}
+			delete buildit;
+			return;
+		}
 
-			item.Proto = ctx.ReturnProto;
-			if (item.Proto == nullptr)
-			{
-				item.Code->ScriptPosition.Message(MSG_ERROR, "Function %s without prototype", item.PrintableName.GetChars());
-				continue;
-			}
+		if (!item.Code->CheckReturn())
+		{
+			auto newcmpd = new FxCompoundStatement(item.Code->ScriptPosition);
+			newcmpd->Add(item.Code);
+			newcmpd->Add(new FxReturnStatement(nullptr, item.Code->ScriptPosition));
+			item.Code = newcmpd->Resolve(ctx);
+		}
 
-			// Generate prototype for anonymous functions.
-			VMScriptFunction *sfunc = item.Function;
-			// create a new prototype from the now known return type and the argument list of the function's template prototype.
-			if (sfunc->Proto == nullptr)
-			{
-				sfunc->Proto = NewPrototype(item.Proto->ReturnTypes, item.Func->Variants[0].Proto->ArgumentTypes);
-				sfunc->ArgFlags = item.Func->Variants[0].ArgFlags;
-			}
+		item.Proto = ctx.ReturnProto;
+		if (item.Proto == nullptr)
+		{
+			item.Code->ScriptPosition.Message(MSG_ERROR, "Function %s without prototype", item.PrintableName.GetChars());
+			delete buildit;
+			return;
+		}
 
-			// Emit code
-			try
-			{
-				sfunc->SourceFileName = item.Code->ScriptPosition.FileName;	// remember the file name for printing error messages if something goes wrong in the VM.
-				buildit.BeginStatement(item.Code);
-				item.Code->Emit(&buildit);
-				buildit.EndStatement();
-				buildit.MakeFunction(sfunc);
-				sfunc->NumArgs = 0;
-				// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
-				// For the VM a vector is 2 or 3 args, depending on size.
-				auto funcVariant = item.Func->Variants[0];
-				for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
-				{
-					auto argType = funcVariant.Proto->ArgumentTypes[i];
-					auto argFlags = funcVariant.ArgFlags[i];
-					if (argFlags & VARF_Out)
-					{
-						auto argPointer = NewPointer(argType);
-						sfunc->NumArgs += argPointer->GetRegCount();
-					}
-					else
-					{
-						sfunc->NumArgs += argType->GetRegCount();
-					}
-				}
+		// Generate prototype for anonymous functions.
+		VMScriptFunction *sfunc = item.Function;
+		// create a new prototype from the now known return type and the argument list of the function's template prototype.
+		if (sfunc->Proto == nullptr)
+		{
+			sfunc->Proto = NewPrototype(item.Proto->ReturnTypes, item.Func->Variants[0].Proto->ArgumentTypes);
+			sfunc->ArgFlags = item.Func->Variants[0].ArgFlags;
+		}
+		sfunc->SourceFileName = item.Code->ScriptPosition.FileName;	// remember the file name for printing error messages if something goes wrong in the VM.
+
+		job.Builder = buildit;
+		job.Unsafe = ctx.Unsafe;
+		job.Cacheable = StateLabels.Storage.Size() == labelsize;
+	};
+
+	// This may run for several functions at once, so it must not change anything but the job's own builder.
+	auto emit = [&](unsigned index)
+	{
+		auto &item = mItems[index];
+		auto &job = jobs[index];
+		try
+		{
+			job.Builder->BeginStatement(item.Code);
+			item.Code->Emit(job.Builder);
+			job.Builder->EndStatement();
+			job.Emitted = (int)job.Builder->GetAddress();
+			if (keepunoptimized) job.Unoptimized = new VMFunctionBuilder(*job.Builder);
+			if (optimize) job.Removed = job.Builder->Optimize();
+		}
+		catch (CRecoverableError &err)
+		{
+			// catch errors from the code generator and pring something meaningful.
+			job.Error = err.GetMessage();
+			job.Failed = true;
+		}
+	};
 
-				disasmdump.Write(sfunc, item.PrintableName);
+	auto finish = [&](unsigned index)
+	{
+		auto &item = mItems[index];
+		auto &job = jobs[index];
+		VMScriptFunction *sfunc = item.Function;
 
-				sfunc->Unsafe = ctx.Unsafe;
+		if (job.Restored)
+		{
+			SetNumArgs(sfunc, item.Func);
+			disasmdump.Write(sfunc, item.PrintableName);
+			built++;
+			cache.Add(item.PrintableName, item.Func, sfunc);
+		}
+		else if (job.Builder == nullptr)
+		{
+			cache.Add(item.PrintableName, item.Func, nullptr);
+		}
+		else if (job.Failed)
+		{
+			item.Code->ScriptPosition.Message(MSG_ERROR, "%s in %s", job.Error.GetChars(), item.PrintableName.GetChars());
+			cache.Add(item.PrintableName, item.Func, nullptr);
+		}
+		else
+		{
+			emitted += job.Emitted;
+			removed += job.Removed;
+			VMScriptFunction *unoptimized = nullptr;
+			emittime.Clock();
+			if (job.Unoptimized != nullptr)
+			{
+				unoptimized = new VMScriptFunction(sfunc->Name);
+				unoptimized->ExtraSpace = sfunc->ExtraSpace;
+				job.Unoptimized->MakeFunction(unoptimized);
 			}
-			catch (CRecoverableError &err)
+			job.Builder->MakeFunction(sfunc);
+			emittime.Unclock();
+			built++;
+			SetNumArgs(sfunc, item.Func);
+
+			disasmdump.Write(sfunc, item.PrintableName);
+
+			sfunc->Unsafe = job.Unsafe;
+			if (unoptimized != nullptr)
 			{
-				// catch errors from the code generator and pring something meaningful.
-				item.Code->ScriptPosition.Message(MSG_ERROR, "%s in %s", err.GetMessage(), item.PrintableName.GetChars());
+				unoptimized->PrintableName = sfunc->PrintableName;
+				unoptimized->SourceFileName = sfunc->SourceFileName;
+				unoptimized->ImplicitArgs = sfunc->ImplicitArgs;
+				unoptimized->VarFlags = sfunc->VarFlags;
+				unoptimized->Proto = sfunc->Proto;
+				unoptimized->ArgFlags = sfunc->ArgFlags;
+				unoptimized->SpecialInits = sfunc->SpecialInits;
+				unoptimized->NumArgs = sfunc->NumArgs;
+				unoptimized->Unsafe = sfunc->Unsafe;
+				mUnoptimized[sfunc] = unoptimized;
 			}
+			cache.Add(item.PrintableName, item.Func, job.Cacheable ? sfunc : nullptr);
 		}
+		delete job.Builder;
+		delete job.Unoptimized;
+		job.Builder = job.Unoptimized = nullptr;
 		delete item.Code;
 		disasmdump.Flush();
+	};
+
+	for (unsigned index = 0; index < mItems.Size(); index++)
+	{
+		resolve(index);
+		if (!parallel)
+		{
+			if (jobs[index].Builder != nullptr)
+			{
+				emittime.Clock();
+				emit(index);
+				emittime.Unclock();
+			}
+			finish(index);
+		}
 	}
+
+	if (parallel)
+	{
+		emittime.Clock();
+		parallel_for(int(mItems.Size()), [&](int index)
+		{
+			if (jobs[index].Builder != nullptr) emit(index);
+		});
+		emittime.Unclock();
+		for (unsigned index = 0; index < mItems.Size(); index++)
+		{
+			finish(index);
+		}
+	}
+	cache.Close(mVarArgInfo);
 	VMFunction::CreateRegUseInfo();
 	FScriptPosition::StrictErrors = false;
+	DPrintf(DMSG_NOTIFY, "Built %d functions (%d from cache), resolve: %.2f ms, emit: %.2f ms\n", built, cache.GetHits(), resolvetime.TimeMS(), emittime.TimeMS());
+	if (optimize) DPrintf(DMSG_NOTIFY, "VM code optimizer removed %d of %d instructions\n", removed, emitted);
 
 	if (FScriptPosition::ErrorCounter == 0 && Args->CheckParm("-dumpjit")) DumpJit();
 	mItems.Clear();
 	mItems.ShrinkToFit();
+	mOverridden.Clear();
+	mVarArgInfo.Clear();
 	FxAlloc.FreeAllBlocks();
 }
 
+//==========================================================================
+//
+// FFunctionBuildList :: IsOverridden
+//
+// Checks if any class replaces this virtual function in its vtable.
+// All scripts have been compiled when code gets emitted so the vtables
+// are complete by then, and classes created later only copy their
+// parent's vtable.
+//
+//==========================================================================
+
+bool FFunctionBuildList::IsOverridden(VMFunction *func)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	auto check = mOverridden.CheckKey(func);
+	if (check != nullptr) return *check;
+
+	unsigned index = func->VirtualIndex;
+	bool overridden = false;
+	for (auto cls : PClass::AllClasses)
+	{
+		auto parent = cls->ParentClass;
+		if (parent != nullptr && parent->Virtuals.Size() > index && parent->Virtuals[index] == func &&
+			(cls->Virtuals.Size() <= index || cls->Virtuals[index] != func))
+		{
+			overridden = true;
+			break;
+		}
+	}
+	mOverridden[func] = overridden;
+	return overridden;
+}
+
+//==========================================================================
+//
+// FFunctionBuildList :: AddVarArgInfo
+//
+// The list is allocated in the arena so that the pointer does not need to
+// be maintained.
+//
+//==========================================================================
+
+void *FFunctionBuildList::AddVarArgInfo(const uint8_t *info, unsigned size)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	void *buffer = ClassDataAllocator.Alloc(size);
+	memcpy(buffer, info, size);
+	mVarArgInfo[buffer] = size;
+	return buffer;
+}
+
+//==========================================================================
+//
+// FFunctionBuildList :: GetUnoptimized
+//
+// Returns the code of a function as it was before the optimizer ran. This
+// is only kept with -checkvmopt.
+//
+//==========================================================================
+
+VMScriptFunction *FFunctionBuildList::GetUnoptimized(VMFunction *func)
+{
+	auto check = mUnoptimized.CheckKey(func);
+	return check != nullptr ? *check : nullptr;
+}
+
+//==========================================================================
+//
+// Times the static functions of a script class that take no arguments and
+// return a single number. VMBenchmarks in vmbench.pk3, which -vmbench loads,
+// holds a set of them for the code generator. With -checkvmopt each also runs unoptimized and must return
+// the same value.
+//
+//==========================================================================
+
+static double RunBenchmarkFunction(VMFunction *func, bool isfloat, int iterations, cycle_t &time)
+{
+	int iresult = 0;
+	double fresult = 0;
+	time.Reset();
+	for (int i = 0; i < iterations; i++)
+	{
+		VMReturn ret;
+		if (isfloat) ret.FloatAt(&fresult);
+		else ret.IntAt(&iresult);
+		time.Clock();
+		VMCall(func, nullptr, 0, &ret, 1);
+		time.Unclock();
+	}
+	return isfloat ? fresult : iresult;
+}
+
+CCMD(bench_vm)
+{
+	const char *classname = argv.argc() > 1 ? argv[1] : "VMBenchmarks";
+	int iterations = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 10;
+
+	PClass *cls = PClass::FindClass(classname);
+	if (cls == nullptr || cls->VMType == nullptr)
+	{
+		Printf("Unknown class %s\n", classname);
+		if (argv.argc() < 2) Printf("Start with -vmbench to load the default workloads\n");
+		return;
+	}
+
+	TArray<PFunction *> funcs;
+	auto it = cls->VMType->Symbols.GetIterator();
+	PSymbolTable::MapType::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		auto func = dyn_cast<PFunction>(pair->Value);
+		if (func == nullptr || func->Variants.Size() != 1) continue;
+		auto &variant = func->Variants[0];
+		if (variant.Implementation == nullptr || variant.Implementation->ImplicitArgs != 0 || variant.Proto->ArgumentTypes.Size() != 0) continue;
+		if (variant.Proto->ReturnTypes.Size() != 1 || !variant.Proto->ReturnTypes[0]->isNumeric()) continue;
+		funcs.Push(func);
+	}
+	std::sort(funcs.begin(), funcs.end(), [](PFunction *a, PFunction *b) { return stricmp(a->SymbolName.GetChars(), b->SymbolName.GetChars()) < 0; });
+
+	int mismatches = 0;
+	for (auto func : funcs)
+	{
+		auto &variant = func->Variants[0];
+		bool isfloat = variant.Proto->ReturnTypes[0]->isFloat();
+		cycle_t time;
+		double result = RunBenchmarkFunction(variant.Implementation, isfloat, iterations, time);
+		Printf("%-24s %10.3f ms", func->SymbolName.GetChars(), time.TimeMS() / iterations);
+
+		auto unoptimized = FunctionBuildList.GetUnoptimized(variant.Implementation);
+		if (unoptimized != nullptr)
+		{
+			cycle_t unopttime;
+			double unoptresult = RunBenchmarkFunction(unoptimized, isfloat, iterations, unopttime);
+			Printf(", unoptimized %10.3f ms, %d/%d instructions", unopttime.TimeMS() / iterations,
+				static_cast<VMScriptFunction *>(variant.Implementation)->CodeSize, unoptimized->CodeSize);
+			if (unoptresult != result)
+			{
+				Printf(TEXTCOLOR_RED " result %g, unoptimized %g", result, unoptresult);
+				mismatches++;
+			}
+		}
+		Printf("\n");
+	}
+	if (funcs.Size() == 0) Printf("%s has no static functions without arguments that return a number\n", classname);
+	else if (mismatches > 0) Printf(TEXTCOLOR_RED "%d of %u functions return different results without the optimizer\n", mismatches, funcs.Size());
+}
+
 void FFunctionBuildList::DumpJit()
 {
 #ifdef HAVE_VM_JIT
@@ -1052,9 +1564,11 @@ void FunctionCallEmitter::AddParameterStringConst(const FString &konst)
 	numparams++;
 	if (target->VarFlags & VARF_VarArg)
 		reginfo.Push(REGT_STRING);
+	// Default arguments are shared by all callers, so this needs its own copy of the string for -parallelvmbuild.
+	FString str(konst.GetChars(), konst.Len());
 	emitters.push_back([=](VMFunctionBuilder *build) ->int
 	{
-		build->Emit(OP_PARAM, REGT_STRING | REGT_KONST, build->GetConstantString(konst));
+		build->Emit(OP_PARAM, REGT_STRING | REGT_KONST, build->GetConstantString(str));
 		return 1;
 	});
 }
@@ -1073,8 +1587,7 @@ ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit>
 	{
 		// Pass a hidden type information parameter to vararg functions.
 		// It would really be nicer to actually pass real types but that'd require a far more complex interface on the compiler side than what we have.
-		uint8_t *regbuffer = (uint8_t*)ClassDataAllocator.Alloc(reginfo.Size());	// Allocate in the arena so that the pointer does not need to be maintained.
-		memcpy(regbuffer, reginfo.Data(), reginfo.Size());
+		void *regbuffer = FunctionBuildList.AddVarArgInfo(reginfo.Data(), reginfo.Size());
 		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantAddress(regbuffer));
 		paramcount++;
 	}
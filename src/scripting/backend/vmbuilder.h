@@ -5,6 +5,7 @@
 #include "vmintern.h"
 #include <vector>
 #include <functional>
+#include <mutex>
 
 class VMFunctionBuilder;
 class FxExpression;
@@ -86,6 +87,9 @@ public:
 	void BackpatchList(TArray<size_t> &addrs, size_t target);
 	void BackpatchListToHere(TArray<size_t> &addrs);
 
+	// Cleans up the emitted code. Returns the number of removed instructions.
+	int Optimize();
+
 	// Write out complete constant tables.
 	void FillIntConstants(int *konst);
 	void FillFloatConstants(double *konst);
@@ -154,12 +158,21 @@ class FFunctionBuildList
 	};
 
 	TArray<Item> mItems;
+	TMap<VMFunction *, bool> mOverridden;
+	TMap<const void *, unsigned> mVarArgInfo;
+	TMap<VMFunction *, VMScriptFunction *> mUnoptimized;
+	// With -parallelvmbuild code for several functions gets emitted at once.
+	std::mutex mLock;
 
 	void DumpJit();
 
 public:
 	VMFunction *AddFunction(PNamespace *curglobals, const VersionInfo &ver, PFunction *func, FxExpression *code, const FString &name, bool fromdecorate, int currentstate, int statecnt, int lumpnum);
 	void Build();
+	bool IsOverridden(VMFunction *func);
+	VMScriptFunction *GetUnoptimized(VMFunction *func);
+	// Returns a permanent copy of a vararg type list. The script code cache needs to know which constants are such lists.
+	void *AddVarArgInfo(const uint8_t *info, unsigned size);
 };
 
 extern FFunctionBuildList FunctionBuildList;
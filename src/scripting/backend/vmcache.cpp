@@ -0,0 +1,917 @@
+/*
+** vmcache.cpp
+** Keeps the VM code of compiled script functions on disk
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 LZDoom07 contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The cache is only valid for the exact resource files and engine build it
+** was written with. Beyond that it depends on the compiler's state being
+** the same when code generation starts, which is verified by comparing the
+** name table and the number of functions and classes. Names that the code
+** generator creates are recreated in the same order before anything is
+** restored, so that name indices in the cached code stay valid.
+**
+*/
+
+#include "vmcache.h"
+#include "vmbuilder.h"
+#include "codegen.h"
+#include "info.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "m_random.h"
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "md5.h"
+#include "r_state.h"
+#include "textures/textures.h"
+#include "v_font.h"
+#include "v_text.h"
+#include "version.h"
+#include "w_wad.h"
+
+CVAR(Bool, vm_codecache, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Bool, vm_jit)
+
+static const char VMCacheMagic[4] = { 'Z', 'V', 'M', 'C' };
+static const uint32_t VMCacheVersion = 1;
+
+enum
+{
+	PTR_Null,
+	PTR_Named,
+	PTR_Data,
+};
+
+//==========================================================================
+//
+// Plain memory reader and writer for the cache file
+//
+//==========================================================================
+
+class FVMCodeCache::FReader
+{
+	const uint8_t *Data;
+	unsigned Size;
+	unsigned Pos = 0;
+	bool Fail = false;
+
+public:
+	FReader(const uint8_t *data, unsigned size) : Data(data), Size(size) {}
+
+	const uint8_t *Bytes(unsigned len)
+	{
+		if (Fail || len > Size - Pos)
+		{
+			Fail = true;
+			return nullptr;
+		}
+		Pos += len;
+		return Data + Pos - len;
+	}
+
+	bool Read(void *dest, unsigned len)
+	{
+		auto src = Bytes(len);
+		if (src != nullptr) memcpy(dest, src, len);
+		return src != nullptr;
+	}
+
+	uint8_t UInt8()
+	{
+		uint8_t v = 0;
+		Read(&v, 1);
+		return v;
+	}
+
+	uint32_t UInt32()
+	{
+		uint32_t v = 0;
+		Read(&v, 4);
+		return v;
+	}
+
+	// Reads the length of an array whose elements take at least minsize
+	// bytes each, so that a damaged file cannot make it allocate too much.
+	unsigned Count(unsigned minsize)
+	{
+		uint32_t count = UInt32();
+		if (uint64_t(count) * minsize > Size - Pos)
+		{
+			Fail = true;
+			return 0;
+		}
+		return count;
+	}
+
+	FString String()
+	{
+		uint32_t len = UInt32();
+		auto src = Bytes(len);
+		return src != nullptr ? FString((const char *)src, len) : FString();
+	}
+
+	unsigned Position() const { return Pos; }
+	bool Failed() const { return Fail; }
+};
+
+class FVMCodeCache::FWriter
+{
+	TArray<uint8_t> &Data;
+
+public:
+	FWriter(TArray<uint8_t> &data) : Data(data) {}
+
+	void Write(const void *src, unsigned len)
+	{
+		unsigned pos = Data.Reserve(len);
+		if (len > 0) memcpy(&Data[pos], src, len);
+	}
+
+	void UInt8(uint8_t v) { Write(&v, 1); }
+	void UInt32(uint32_t v) { Write(&v, 4); }
+
+	void String(const FString &str)
+	{
+		UInt32((uint32_t)str.Len());
+		Write(str.GetChars(), (unsigned)str.Len());
+	}
+};
+
+//==========================================================================
+//
+// Types that are stored by their index in this list
+//
+//==========================================================================
+
+static PType *GetBasicType(unsigned index)
+{
+	PType *const types[] = { TypeVoid, TypeSInt8, TypeUInt8, TypeSInt16, TypeUInt16, TypeSInt32, TypeUInt32, TypeBool,
+		TypeFloat32, TypeFloat64, TypeString, TypeName, TypeSound, TypeColor, TypeTextureID, TypeSpriteID, TypeVector2,
+		TypeVector3, TypeState, TypeFont, TypeStateLabel, TypeNullPtr, TypeVoidPtr };
+
+	return index < countof(types) ? types[index] : nullptr;
+}
+
+static int GetBasicTypeIndex(const PType *type)
+{
+	for (unsigned i = 0; GetBasicType(i) != nullptr; i++)
+	{
+		if (GetBasicType(i) == type) return i;
+	}
+	return -1;
+}
+
+static FString GetCachePath(bool create)
+{
+	FString path = M_GetCachePath(create);
+	if (create) CreatePath(path);
+	path << "/scriptcode.zvmc";
+	return path;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: MakeKey
+//
+// Everything the cache depends on that cannot be checked later: the engine
+// build, the settings that change the generated code and the identity of
+// every loaded resource file.
+//
+//==========================================================================
+
+void FVMCodeCache::MakeKey(bool optimized, uint8_t *digest)
+{
+	MD5Context md5;
+	FString info;
+	uint32_t byteorder = 0x01020304;
+
+	info.Format("%s %s %d %08x %d %d\n", GetVersionString(), GetGitHash(), int(sizeof(void*)), byteorder, int(optimized), int(vm_jit));
+	md5.Update((const uint8_t *)info.GetChars(), (unsigned)info.Len());
+
+	for (int i = 0; i < Wads.GetNumWads(); i++)
+	{
+		const char *path = Wads.GetWadFullName(i);
+		if (path == nullptr) continue;
+
+		size_t size;
+		time_t time;
+		if (GetFileInfo(path, &size, &time))
+		{
+			info.Format("%s %llu %lld\n", path, (unsigned long long)size, (long long)time);
+		}
+		else
+		{
+			// Directories and files inside other archives. For the latter
+			// the containing file already covers any change.
+			info.Format("%s\n", path);
+			for (int lump = Wads.GetFirstLump(i); lump >= 0 && lump <= Wads.GetLastLump(i); lump++)
+			{
+				FString lumppath = path;
+				lumppath << Wads.GetLumpFullName(lump);
+				if (GetFileInfo(lumppath, &size, &time))
+				{
+					info.AppendFormat("%s %llu %lld\n", Wads.GetLumpFullName(lump), (unsigned long long)size, (long long)time);
+				}
+				else
+				{
+					info.AppendFormat("%s %d\n", Wads.GetLumpFullName(lump), Wads.LumpLength(lump));
+				}
+			}
+		}
+		md5.Update((const uint8_t *)info.GetChars(), (unsigned)info.Len());
+	}
+	md5.Final(digest);
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: MakeNameDigest
+//
+//==========================================================================
+
+void FVMCodeCache::MakeNameDigest(uint8_t *digest)
+{
+	MD5Context md5;
+	for (int i = 0; i < FName::GetNumNames(); i++)
+	{
+		const char *name = FName(ENamedName(i)).GetChars();
+		md5.Update((const uint8_t *)name, (unsigned)strlen(name) + 1);
+	}
+	md5.Final(digest);
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Open
+//
+//==========================================================================
+
+void FVMCodeCache::Open(unsigned numitems, bool optimized)
+{
+	// -checkvmcache compiles everything and compares the result with the cache.
+	Checking = !!Args->CheckParm("-checkvmcache");
+	Enabled = vm_codecache || Checking;
+	if (!Enabled) return;
+
+	MakeKey(optimized, Key);
+	MakeNameDigest(NameDigest);
+	NumNames = FName::GetNumNames();
+	NumItems = numitems;
+	NumFunctions = VMFunction::AllFunctions.Size();
+	NumClasses = PClass::AllClasses.Size();
+	NumTextures = TexMan.NumTextures();
+	NumSprites = sprites.Size();
+
+	Valid = ReadFile();
+	if (!Valid)
+	{
+		Entries.Clear();
+		FileData.Clear();
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: ReadFile
+//
+//==========================================================================
+
+bool FVMCodeCache::ReadFile()
+{
+	FileReader fr;
+	if (!fr.OpenFile(GetCachePath(false))) return false;
+	FileData = fr.Read();
+
+	FReader r(FileData.Data(), FileData.Size());
+	char magic[4];
+	uint8_t key[16], namedigest[16];
+	if (!r.Read(magic, 4) || memcmp(magic, VMCacheMagic, 4) != 0 || r.UInt32() != VMCacheVersion) return false;
+	r.Read(key, 16);
+	r.Read(namedigest, 16);
+	int numnames = (int)r.UInt32();
+	unsigned numitems = r.UInt32();
+	unsigned numfunctions = r.UInt32();
+	unsigned numclasses = r.UInt32();
+	if (r.Failed() || memcmp(key, Key, 16) != 0 || memcmp(namedigest, NameDigest, 16) != 0 || numnames != NumNames ||
+		numitems != NumItems || numfunctions != NumFunctions || numclasses != NumClasses)
+	{
+		return false;
+	}
+
+	// The names that code generation created the last time. Since everything
+	// before was the same, they get the same indices again.
+	unsigned newnames = r.Count(4);
+	for (unsigned i = 0; i < newnames && !r.Failed(); i++)
+	{
+		FName name = r.String();
+		if (name.GetIndex() != NumNames + (int)i) return false;
+	}
+
+	Entries.Resize(r.Count(9));
+	if (r.Failed() || Entries.Size() != NumItems) return false;
+	for (auto &entry : Entries)
+	{
+		entry.Name = r.String();
+		entry.Cached = r.UInt8() != 0;
+		entry.Size = r.UInt32();
+		entry.Offset = r.Position();
+		r.Bytes(entry.Size);
+	}
+	return !r.Failed();
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: WriteFile
+//
+//==========================================================================
+
+void FVMCodeCache::WriteFile(const TArray<uint8_t> &data)
+{
+	FString path = GetCachePath(true);
+	FString temppath = path + ".tmp";
+
+	FileWriter *fw = FileWriter::Open(temppath);
+	if (fw == nullptr) return;
+	bool ok = fw->Write(data.Data(), data.Size()) == data.Size();
+	delete fw;
+
+	remove(path);
+	if (!ok || rename(temppath, path) != 0)
+	{
+		remove(temppath);
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: MapFields
+//
+// Static fields hold the address of their variable. They get named by the
+// type or namespace they are in, and names that are not unique are left out.
+//
+//==========================================================================
+
+void FVMCodeCache::MapFields(TMap<FString, void *> &fields)
+{
+	TMap<FString, bool> ambiguous;
+
+	auto add = [&](const char *scope, PSymbolTable &symbols)
+	{
+		auto it = symbols.GetIterator();
+		PSymbolTable::MapType::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			if (!pair->Value->IsKindOf(RUNTIME_CLASS(PField))) continue;
+			auto field = static_cast<PField *>(pair->Value);
+			// Meta fields are offsets into the class's meta data, not addresses.
+			if (!(field->Flags & VARF_Static) || (field->Flags & VARF_Meta)) continue;
+
+			FString key;
+			key.Format("field:%s.%s", scope, field->SymbolName.GetChars());
+			void *address = (void *)(intptr_t)field->Offset;
+			void **existing = fields.CheckKey(key);
+			if (existing != nullptr && *existing != address) ambiguous[key] = true;
+			else fields[key] = address;
+		}
+	};
+
+	for (auto ns : Namespaces.AllNamespaces)
+	{
+		add("", ns->Symbols);
+	}
+	for (size_t i = 0; i < countof(TypeTable.TypeHash); ++i)
+	{
+		for (PType *ty = TypeTable.TypeHash[i]; ty != nullptr; ty = ty->HashNext)
+		{
+			if (ty->isContainer()) add(ty->DescriptiveName(), ty->Symbols);
+		}
+	}
+
+	TMap<FString, bool>::Iterator it(ambiguous);
+	TMap<FString, bool>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		fields.Remove(pair->Key);
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: MapPointers
+//
+// Names everything that generated code can refer to by address, except for
+// states, which are looked up through their owner.
+//
+//==========================================================================
+
+void FVMCodeCache::MapPointers()
+{
+	FString name;
+
+	for (auto cls : PClass::AllClasses)
+	{
+		name.Format("class:%s", cls->TypeName.GetChars());
+		PointerNames[cls] = name;
+	}
+
+	for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+	{
+		auto func = VMFunction::AllFunctions[i];
+		name.Format("function:%u:%s", i, func->PrintableName.GetChars());
+		PointerNames[func] = name;
+	}
+
+	for (auto cvar = CVars; cvar != nullptr; cvar = cvar->GetNext())
+	{
+		// Several flag CVars share the variable of the CVar they are part of.
+		void *address = FxCVar::ValueAddress(cvar);
+		if (address != nullptr && PointerNames.CheckKey(address) == nullptr)
+		{
+			name.Format("cvar:%s", cvar->GetName());
+			PointerNames[address] = name;
+		}
+	}
+
+	TMap<FString, void *> fields;
+	MapFields(fields);
+	TMap<FString, void *>::Iterator it(fields);
+	TMap<FString, void *>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		if (PointerNames.CheckKey(pair->Value) == nullptr) PointerNames[pair->Value] = pair->Key;
+	}
+
+	// RNGs are found by the CRC of their name. If two share one, the lookup
+	// could return the wrong one, so these are left out.
+	TMap<uint32_t, FRandom *> rngs;
+	for (auto rng = FRandom::StaticFirstRNG(); rng != nullptr; rng = rng->GetNextRNG())
+	{
+		FRandom **existing = rngs.CheckKey(rng->GetNameCRC());
+		rngs[rng->GetNameCRC()] = existing == nullptr ? rng : nullptr;
+	}
+	TMap<uint32_t, FRandom *>::Iterator rit(rngs);
+	TMap<uint32_t, FRandom *>::Pair *rpair;
+	while (rit.NextPair(rpair))
+	{
+		if (rpair->Value != nullptr)
+		{
+			name.Format("rng:%u", rpair->Key);
+			PointerNames[rpair->Value] = name;
+		}
+	}
+
+	for (auto font = FFont::GetFirstFont(); font != nullptr; font = font->GetNextFont())
+	{
+		if (font->GetName() != NAME_None)
+		{
+			name.Format("font:%s", font->GetName().GetChars());
+			PointerNames[font] = name;
+		}
+	}
+
+	PointerNames[FxAddSub::TextureCountAddress()] = "texturecount";
+
+	for (unsigned i = 0; GetBasicType(i) != nullptr; i++)
+	{
+		name.Format("type:%u", i);
+		PointerNames[GetBasicType(i)] = name;
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: FindPointer
+//
+//==========================================================================
+
+void *FVMCodeCache::FindPointer(const FString &key)
+{
+	long colon = key.IndexOf(':');
+	if (colon < 0) return nullptr;
+	FString kind = key.Left(colon);
+	FString value = key.Mid(colon + 1);
+
+	if (kind.Compare("class") == 0)
+	{
+		return PClass::FindClass(value);
+	}
+	else if (kind.Compare("function") == 0)
+	{
+		long sep = value.IndexOf(':');
+		unsigned index = (unsigned)strtoul(value, nullptr, 10);
+		if (sep < 0 || index >= VMFunction::AllFunctions.Size()) return nullptr;
+		auto func = VMFunction::AllFunctions[index];
+		return func->PrintableName.Compare(value.Mid(sep + 1)) == 0 ? func : nullptr;
+	}
+	else if (kind.Compare("cvar") == 0)
+	{
+		FBaseCVar *cvar = FindCVar(value, nullptr);
+		return cvar != nullptr ? FxCVar::ValueAddress(cvar) : nullptr;
+	}
+	else if (kind.Compare("field") == 0)
+	{
+		if (!FieldsMapped)
+		{
+			MapFields(FieldPointers);
+			FieldsMapped = true;
+		}
+		void **address = FieldPointers.CheckKey(key);
+		return address != nullptr ? *address : nullptr;
+	}
+	else if (kind.Compare("rng") == 0)
+	{
+		uint32_t crc = (uint32_t)strtoul(value, nullptr, 10);
+		FRandom *found = nullptr;
+		for (auto rng = FRandom::StaticFirstRNG(); rng != nullptr; rng = rng->GetNextRNG())
+		{
+			if (rng->GetNameCRC() != crc) continue;
+			if (found != nullptr) return nullptr;
+			found = rng;
+		}
+		return found;
+	}
+	else if (kind.Compare("font") == 0)
+	{
+		// Fonts may be loaded by the code generator, so this must do the same.
+		return V_GetFont(value);
+	}
+	else if (kind.Compare("state") == 0)
+	{
+		long sep = value.LastIndexOf(':');
+		if (sep < 0) return nullptr;
+		PClassActor *owner = PClass::FindActor(value.Left(sep));
+		unsigned index = (unsigned)strtoul(value.Mid(sep + 1), nullptr, 10);
+		return owner != nullptr && index < owner->GetStateCount() ? owner->GetStates() + index : nullptr;
+	}
+	else if (kind.Compare("texturecount") == 0)
+	{
+		return FxAddSub::TextureCountAddress();
+	}
+	else if (kind.Compare("type") == 0)
+	{
+		return GetBasicType((unsigned)strtoul(value, nullptr, 10));
+	}
+	return nullptr;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: WritePointer
+//
+//==========================================================================
+
+bool FVMCodeCache::WritePointer(FWriter &w, void *ptr, const TMap<const void *, unsigned> &varargs)
+{
+	if (ptr == nullptr)
+	{
+		w.UInt8(PTR_Null);
+		return true;
+	}
+
+	const unsigned *size = varargs.CheckKey(ptr);
+	if (size != nullptr)
+	{
+		w.UInt8(PTR_Data);
+		w.UInt32(*size);
+		w.Write(ptr, *size);
+		return true;
+	}
+
+	FString *name = PointerNames.CheckKey(ptr);
+	FString statename;
+	if (name == nullptr)
+	{
+		PClassActor *owner = FState::StaticFindStateOwner((FState *)ptr);
+		if (owner == nullptr) return false;
+		size_t offset = (uint8_t *)ptr - (uint8_t *)owner->GetStates();
+		if (offset % sizeof(FState) != 0) return false;
+		statename.Format("state:%s:%u", owner->TypeName.GetChars(), unsigned(offset / sizeof(FState)));
+		name = &statename;
+	}
+	w.UInt8(PTR_Named);
+	w.String(*name);
+	return true;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: ReadPointer
+//
+//==========================================================================
+
+bool FVMCodeCache::ReadPointer(FReader &r, void *&ptr)
+{
+	switch (r.UInt8())
+	{
+	case PTR_Null:
+		ptr = nullptr;
+		return !r.Failed();
+
+	case PTR_Named:
+		ptr = FindPointer(r.String());
+		return !r.Failed() && ptr != nullptr;
+
+	case PTR_Data:
+	{
+		unsigned size = r.UInt32();
+		auto src = r.Bytes(size);
+		if (src == nullptr) return false;
+		// Like the code generator's copy this lives as long as the function.
+		ptr = ClassDataAllocator.Alloc(size);
+		memcpy(ptr, src, size);
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: WriteFunction
+//
+//==========================================================================
+
+bool FVMCodeCache::WriteFunction(FWriter &w, const FItem &item, const TMap<const void *, unsigned> &varargs)
+{
+	auto sfunc = item.Function;
+
+	w.String(sfunc->SourceFileName);
+
+	// Anonymous functions get their prototype from the code.
+	if (item.Func->SymbolName == NAME_None)
+	{
+		auto &rets = sfunc->Proto->ReturnTypes;
+		w.UInt32(rets.Size());
+		for (auto type : rets)
+		{
+			int index = GetBasicTypeIndex(type);
+			if (index < 0) return false;
+			w.UInt8(index);
+		}
+	}
+
+	w.UInt32(sfunc->ExtraSpace);
+	w.UInt32(sfunc->SpecialInits.Size());
+	for (auto &init : sfunc->SpecialInits)
+	{
+		int index = GetBasicTypeIndex(init.first);
+		if (index < 0) return false;
+		w.UInt8(index);
+		w.UInt32(init.second);
+	}
+
+	w.UInt8(sfunc->NumRegD);
+	w.UInt8(sfunc->NumRegF);
+	w.UInt8(sfunc->NumRegS);
+	w.UInt8(sfunc->NumRegA);
+	w.UInt32(sfunc->MaxParam);
+	w.UInt8(sfunc->Unsafe);
+
+	w.UInt32(sfunc->CodeSize);
+	w.Write(sfunc->Code, sfunc->CodeSize * sizeof(VMOP));
+	w.UInt32(sfunc->LineInfoCount);
+	w.Write(sfunc->LineInfo, sfunc->LineInfoCount * sizeof(FStatementInfo));
+	w.UInt32(sfunc->NumKonstD);
+	w.Write(sfunc->KonstD, sfunc->NumKonstD * sizeof(int));
+	w.UInt32(sfunc->NumKonstF);
+	w.Write(sfunc->KonstF, sfunc->NumKonstF * sizeof(double));
+	w.UInt32(sfunc->NumKonstS);
+	for (unsigned i = 0; i < sfunc->NumKonstS; i++)
+	{
+		w.String(sfunc->KonstS[i]);
+	}
+	w.UInt32(sfunc->NumKonstA);
+	for (unsigned i = 0; i < sfunc->NumKonstA; i++)
+	{
+		if (!WritePointer(w, sfunc->KonstA[i].v, varargs)) return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Restore
+//
+// Nothing gets changed in the function until the entire entry has been
+// read and everything it refers to has been found.
+//
+//==========================================================================
+
+bool FVMCodeCache::Restore(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc)
+{
+	if (!Valid || Checking || index >= Entries.Size()) return false;
+	auto &entry = Entries[index];
+	if (!entry.Cached) return false;
+	if (entry.Name.Compare(name) != 0)
+	{
+		Stale = true;
+		return false;
+	}
+
+	FReader r(FileData.Data() + entry.Offset, entry.Size);
+	FString source = r.String();
+
+	TArray<PType *> rets;
+	bool anonymous = func->SymbolName == NAME_None;
+	if (anonymous)
+	{
+		rets.Resize(r.Count(1));
+		for (auto &type : rets)
+		{
+			type = GetBasicType(r.UInt8());
+			if (type == nullptr) r.Bytes(~0u);
+		}
+	}
+
+	int extraspace = (int)r.UInt32();
+	TArray<FTypeAndOffset> inits(r.Count(5), true);
+	for (auto &init : inits)
+	{
+		init.first = GetBasicType(r.UInt8());
+		init.second = r.UInt32();
+		if (init.first == nullptr) r.Bytes(~0u);
+	}
+
+	uint8_t regs[4];
+	r.Read(regs, 4);
+	unsigned maxparam = r.UInt32();
+	bool isunsafe = r.UInt8() != 0;
+
+	TArray<VMOP> code(r.Count(sizeof(VMOP)), true);
+	r.Read(code.Data(), code.Size() * sizeof(VMOP));
+	TArray<FStatementInfo> lines(r.Count(sizeof(FStatementInfo)), true);
+	r.Read(lines.Data(), lines.Size() * sizeof(FStatementInfo));
+	TArray<int> konstd(r.Count(sizeof(int)), true);
+	r.Read(konstd.Data(), konstd.Size() * sizeof(int));
+	TArray<double> konstf(r.Count(sizeof(double)), true);
+	r.Read(konstf.Data(), konstf.Size() * sizeof(double));
+	TArray<FString> konsts(r.Count(4), true);
+	for (auto &str : konsts)
+	{
+		str = r.String();
+	}
+	TArray<void *> konsta(r.Count(1), true);
+	bool found = true;
+	for (auto &ptr : konsta)
+	{
+		if (!r.Failed() && !ReadPointer(r, ptr)) found = false;
+	}
+
+	if (r.Failed() || !found || code.Size() == 0 || maxparam > 65535 || konstd.Size() > 65535 || konstf.Size() > 65535 ||
+		konsts.Size() > 65535 || konsta.Size() > 65535 || lines.Size() > 65535)
+	{
+		Stale = true;
+		return false;
+	}
+
+	if (anonymous && sfunc->Proto == nullptr)
+	{
+		sfunc->Proto = NewPrototype(rets, func->Variants[0].Proto->ArgumentTypes);
+		sfunc->ArgFlags = func->Variants[0].ArgFlags;
+	}
+	sfunc->SourceFileName = source;
+	sfunc->ExtraSpace = extraspace;
+	sfunc->SpecialInits = std::move(inits);
+
+	sfunc->Alloc(code.Size(), konstd.Size(), konstf.Size(), konsts.Size(), konsta.Size(), lines.Size());
+	memcpy(sfunc->Code, code.Data(), code.Size() * sizeof(VMOP));
+	if (lines.Size() > 0) memcpy(sfunc->LineInfo, lines.Data(), lines.Size() * sizeof(FStatementInfo));
+	if (konstd.Size() > 0) memcpy(sfunc->KonstD, konstd.Data(), konstd.Size() * sizeof(int));
+	if (konstf.Size() > 0) memcpy(sfunc->KonstF, konstf.Data(), konstf.Size() * sizeof(double));
+	for (unsigned i = 0; i < konsts.Size(); i++)
+	{
+		sfunc->KonstS[i] = konsts[i];
+	}
+	for (unsigned i = 0; i < konsta.Size(); i++)
+	{
+		sfunc->KonstA[i].v = konsta[i];
+	}
+
+	sfunc->NumRegD = regs[0];
+	sfunc->NumRegF = regs[1];
+	sfunc->NumRegS = regs[2];
+	sfunc->NumRegA = regs[3];
+	sfunc->MaxParam = maxparam;
+	sfunc->StackSize = VMFrame::FrameSize(sfunc->NumRegD, sfunc->NumRegF, sfunc->NumRegS, sfunc->NumRegA, sfunc->MaxParam, sfunc->ExtraSpace);
+	sfunc->Unsafe = isunsafe;
+	Hits++;
+	return true;
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Add
+//
+//==========================================================================
+
+void FVMCodeCache::Add(const FString &name, PFunction *func, VMScriptFunction *sfunc)
+{
+	if (Enabled)
+	{
+		Items.Push({ name, func, sfunc });
+	}
+}
+
+//==========================================================================
+//
+// FVMCodeCache :: Close
+//
+//==========================================================================
+
+void FVMCodeCache::Close(const TMap<const void *, unsigned> &varargs)
+{
+	if (!Enabled || (Valid && !Stale && !Checking) || FScriptPosition::ErrorCounter > 0) return;
+
+	// A restored function could not find anything that code generation
+	// created, and the checks in Open would fail on the next start.
+	if (Items.Size() != NumItems || VMFunction::AllFunctions.Size() != NumFunctions || PClass::AllClasses.Size() != NumClasses ||
+		TexMan.NumTextures() != NumTextures || sprites.Size() != NumSprites)
+	{
+		DPrintf(DMSG_NOTIFY, "Script code not cached because code generation created new functions, classes or textures\n");
+		return;
+	}
+
+	MapPointers();
+
+	TArray<uint8_t> data;
+	FWriter w(data);
+	w.Write(VMCacheMagic, 4);
+	w.UInt32(VMCacheVersion);
+	w.Write(Key, 16);
+	w.Write(NameDigest, 16);
+	w.UInt32(NumNames);
+	w.UInt32(NumItems);
+	w.UInt32(NumFunctions);
+	w.UInt32(NumClasses);
+	w.UInt32(FName::GetNumNames() - NumNames);
+	for (int i = NumNames; i < FName::GetNumNames(); i++)
+	{
+		w.String(FName(ENamedName(i)).GetChars());
+	}
+
+	int cached = 0, mismatches = 0;
+	w.UInt32(Items.Size());
+	for (unsigned i = 0; i < Items.Size(); i++)
+	{
+		auto &item = Items[i];
+		w.String(item.Name);
+		unsigned flagpos = data.Reserve(5);
+		unsigned start = data.Size();
+		bool ok = item.Function != nullptr && WriteFunction(w, item, varargs);
+		if (ok) cached++;
+		else data.Resize(start);
+		uint32_t size = data.Size() - start;
+		data[flagpos] = ok;
+		memcpy(&data[flagpos + 1], &size, 4);
+
+		if (Checking && Valid)
+		{
+			auto &entry = Entries[i];
+			if (entry.Cached != ok || entry.Size != size || (size > 0 && memcmp(&FileData[entry.Offset], &data[start], size) != 0))
+			{
+				Printf(TEXTCOLOR_RED "Cached code for %s differs from the compiled code\n", item.Name.GetChars());
+				mismatches++;
+			}
+		}
+	}
+
+	if (Checking)
+	{
+		if (Valid) Printf("%d of %u functions differ from the script code cache\n", mismatches, Items.Size());
+		else Printf("No script code cache for the loaded files to check against\n");
+		if (Valid && mismatches == 0) return;
+	}
+	WriteFile(data);
+	DPrintf(DMSG_NOTIFY, "Wrote %d of %u functions to the script code cache\n", cached, Items.Size());
+}
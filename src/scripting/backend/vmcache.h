@@ -0,0 +1,93 @@
+#pragma once
+
+#include "vmintern.h"
+
+class PFunction;
+class PType;
+
+//==========================================================================
+//
+// Keeps the VM code of all compiled script functions on disk, so that the
+// next start with the same set of resource files can skip resolving and
+// emitting them.
+//
+// Everything a function's code refers to by address is stored by name and
+// looked up again when it is restored. Functions that refer to something
+// that cannot be named that way are compiled on every start.
+//
+//==========================================================================
+
+class FVMCodeCache
+{
+public:
+	// Reads the cache if it was written for the current resource files and
+	// the same list of functions. This must be called before anything of the
+	// code generation runs, since it restores the name table's state.
+	void Open(unsigned numitems, bool optimized);
+
+	// Fills in the function from the cache. Returns false if the function has
+	// to be compiled.
+	bool Restore(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc);
+
+	// Every function in the build list must be added in order, with a null
+	// sfunc if it was not built or must not be cached.
+	void Add(const FString &name, PFunction *func, VMScriptFunction *sfunc);
+
+	// Writes the cache if it was missing or outdated. varargs holds the size
+	// of every vararg type list the code generator has allocated.
+	void Close(const TMap<const void *, unsigned> &varargs);
+
+	int GetHits() const { return Hits; }
+
+private:
+	struct FEntry
+	{
+		FString Name;
+		unsigned Offset, Size;
+		bool Cached;
+	};
+
+	struct FItem
+	{
+		FString Name;
+		PFunction *Func;
+		VMScriptFunction *Function;
+	};
+
+	class FReader;
+	class FWriter;
+
+	void MakeKey(bool optimized, uint8_t *digest);
+	void MakeNameDigest(uint8_t *digest);
+	bool ReadFile();
+	void WriteFile(const TArray<uint8_t> &data);
+	void MapPointers();
+	void MapFields(TMap<FString, void *> &fields);
+	void *FindPointer(const FString &key);
+	bool WriteFunction(FWriter &w, const FItem &item, const TMap<const void *, unsigned> &varargs);
+	bool WritePointer(FWriter &w, void *ptr, const TMap<const void *, unsigned> &varargs);
+	bool ReadPointer(FReader &r, void *&ptr);
+
+	bool Enabled = false;
+	bool Checking = false;
+	bool Valid = false;
+	bool Stale = false;
+	int Hits = 0;
+
+	uint8_t Key[16];
+	uint8_t NameDigest[16];
+	int NumNames = 0;
+	unsigned NumItems = 0;
+	unsigned NumFunctions = 0;
+	unsigned NumClasses = 0;
+	int NumTextures = 0;
+	unsigned NumSprites = 0;
+
+	TArray<uint8_t> FileData;
+	TArray<FEntry> Entries;
+	TArray<FItem> Items;
+
+	TMap<const void *, FString> PointerNames;
+	TMap<FString, void *> FieldPointers;
+	bool FieldsMapped = false;
+};
@@ -466,20 +466,29 @@ void SynthesizeFlagFields();
 
 void LoadActors()
 {
-	cycle_t timer;
+	cycle_t timer, zscripttime, decoratetime, buildtime;
 
 	timer.Reset(); timer.Clock();
+	zscripttime.Reset();
+	decoratetime.Reset();
+	buildtime.Reset();
 	FScriptPosition::ResetErrorCounter();
 
 	InitThingdef();
 	FScriptPosition::StrictErrors = true;
+	zscripttime.Clock();
 	ParseScripts();
+	zscripttime.Unclock();
 
 	FScriptPosition::StrictErrors = false;
+	decoratetime.Clock();
 	ParseAllDecorate();
 	SynthesizeFlagFields();
+	decoratetime.Unclock();
 
+	buildtime.Clock();
 	FunctionBuildList.Build();
+	buildtime.Unclock();
 
 	if (FScriptPosition::ErrorCounter > 0)
 	{
@@ -544,6 +553,9 @@ void LoadActors()
 
 	timer.Unclock();
 	if (!batchrun) Printf("script parsing took %.2f ms\n", timer.TimeMS());
+	DPrintf(DMSG_NOTIFY, "ZScript: %.2f ms, DECORATE: %.2f ms, code generation: %.2f ms, postprocessing: %.2f ms\n",
+		zscripttime.TimeMS(), decoratetime.TimeMS(), buildtime.TimeMS(),
+		timer.TimeMS() - zscripttime.TimeMS() - decoratetime.TimeMS() - buildtime.TimeMS());
 
 	// Now we may call the scripted OnDestroy method.
 	PClass::bVMOperational = true;
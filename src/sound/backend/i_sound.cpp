@@ -331,6 +331,83 @@ FString SoundStream::GetStats()
 	return "No stream stats available.";
 }
 
+//==========================================================================
+//
+// I_DecodeSound
+//
+// Decodes a sound the renderer has no loader of its own for. Everything
+// here only works on local data so that sounds can be decoded by several
+// threads at once.
+//
+//==========================================================================
+
+bool I_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out)
+{
+	ChannelConfig chans;
+	SampleType type;
+	int srate;
+	uint32_t loop_start = 0, loop_end = ~0u;
+	bool startass = false, endass = false;
+
+	FindLoopTags(sfxdata, length, &loop_start, &startass, &loop_end, &endass);
+	auto decoder = CreateDecoder(sfxdata, length, true);
+	if (!decoder)
+		return false;
+
+	SoundDecoder_GetInfo(decoder, &srate, &chans, &type);
+	int channels = chans == ChannelConfig_Mono ? 1 : chans == ChannelConfig_Stereo ? 2 : 0;
+	int bits = type == SampleType_UInt8 ? 8 : type == SampleType_Int16 ? 16 : 0;
+	if (channels == 0 || bits == 0)
+	{
+		SoundDecoder_Close(decoder);
+		out.error.Format("Unsupported audio format: %s, %s\n", GetChannelConfigName(chans), GetSampleTypeName(type));
+		return false;
+	}
+
+	unsigned total = 0;
+	unsigned got;
+
+	out.data.Resize(32768);
+	while ((got = (unsigned)SoundDecoder_Read(decoder, &out.data[total], out.data.Size() - total)) > 0)
+	{
+		total += got;
+		out.data.Resize(total * 2);
+	}
+	out.data.Resize(total);
+	SoundDecoder_Close(decoder);
+	if (total == 0)
+	{
+		return false;
+	}
+
+	if (!startass) loop_start = uint32_t(uint64_t(loop_start) * srate / 1000);
+	if (!endass && loop_end != ~0u) loop_end = uint32_t(uint64_t(loop_end) * srate / 1000);
+	const uint32_t samples = total / (channels * bits / 8);
+	if (loop_start > samples) loop_start = 0;
+	if (loop_end > samples) loop_end = samples;
+
+	out.samplerate = srate;
+	out.channels = channels;
+	out.bits = bits;
+	if (loop_end > loop_start && (loop_start > 0 || loop_end < samples))
+	{
+		out.loopstart = loop_start;
+		out.loopend = loop_end;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// SoundRenderer :: LoadDecodedSound
+//
+//==========================================================================
+
+SoundHandle SoundRenderer::LoadDecodedSound(FDecodedSound &decoded)
+{
+	return LoadSoundRaw(decoded.data.Data(), decoded.data.Size(), decoded.samplerate, decoded.channels, decoded.bits, decoded.loopstart, decoded.loopend);
+}
+
 //==========================================================================
 //
 // SoundRenderer :: LoadSoundVoc
@@ -83,6 +83,18 @@ public:
 	virtual FString GetStats();
 };
 
+// A compressed sound decoded to PCM, before it gets handed to the sound renderer.
+struct FDecodedSound
+{
+	TArray<uint8_t> data;
+	int samplerate = 0;
+	int channels = 0;
+	int bits = 0;
+	int loopstart = 0;		// in samples
+	int loopend = -1;		// -1 means no loop points
+	FString error;			// set if decoding failed because of an unsupported format
+};
+
 typedef bool (*SoundStreamCallback)(SoundStream *stream, void *buff, int len, void *userdata);
 
 struct SoundDecoder;
@@ -100,6 +112,7 @@ public:
 	virtual SoundHandle LoadSound(uint8_t *sfxdata, int length) = 0;
 	SoundHandle LoadSoundVoc(uint8_t *sfxdata, int length);
 	virtual SoundHandle LoadSoundRaw(uint8_t *sfxdata, int length, int frequency, int channels, int bits, int loopstart, int loopend = -1) = 0;
+	virtual SoundHandle LoadDecodedSound(FDecodedSound &decoded);
 	virtual void UnloadSound (SoundHandle sfx) = 0;	// unloads a sound from memory
 	virtual unsigned int GetMSLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
 	virtual unsigned int GetSampleLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
@@ -166,6 +179,9 @@ extern bool nosound;
 void I_InitSound ();
 void I_CloseSound();
 
+// Decodes a compressed sound. Unlike the renderer this may be called from any thread.
+bool I_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out);
+
 extern ReverbContainer *DefaultEnvironments[26];
 
 bool IsOpenALPresent();
@@ -60,6 +60,7 @@ CVAR(Bool, snd_waterreverb, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 CVAR (String, snd_aldevice, "Default", CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, snd_efx, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (String, snd_alresampler, "Default", CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR (Int, snd_streamlead, 250, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)	// ms of stream audio rendered ahead; 0 renders on the stream thread
 
 #ifdef _WIN32
 #define OPENALLIB "openal32.dll"
@@ -184,6 +185,106 @@ class OpenALSoundStream : public SoundStream
 	//bool Looping;
 	ALfloat Volume;
 
+	// Render-ahead state. A worker thread runs the callback and writes whole
+	// buffers into Ring, so Process only has to copy them out. The positions
+	// only ever grow and are taken modulo the ring size.
+	TArray<ALubyte> Ring;
+	TArray<ALubyte> Scratch;
+	std::atomic<size_t> ReadPos;
+	std::atomic<size_t> WritePos;
+	std::atomic<bool> WorkerQuit;
+	std::atomic<bool> WorkerEnded;
+	std::atomic<unsigned> Underruns;
+	std::thread Worker;
+	std::mutex WorkerLock;
+	std::condition_variable WorkerWake;
+
+	void StartWorker()
+	{
+		if(snd_streamlead <= 0)
+			return;
+
+		size_t chunk = Data.Size();
+		size_t lead = (size_t)SampleRate * FrameSize * snd_streamlead / 1000;
+		size_t chunks = MAX<size_t>(2, (lead + chunk - 1) / chunk);
+		Ring.Resize(unsigned(chunks * chunk));
+		Scratch.Resize(unsigned(chunk));
+		ReadPos.store(0);
+		WritePos.store(0);
+		WorkerQuit.store(false);
+		WorkerEnded.store(false);
+		Worker = std::thread(std::mem_fn(&OpenALSoundStream::RenderAhead), this);
+	}
+
+	void StopWorker()
+	{
+		if(!Worker.joinable())
+			return;
+
+		std::unique_lock<std::mutex> lock(WorkerLock);
+		WorkerQuit.store(true);
+		lock.unlock();
+		WorkerWake.notify_all();
+		Worker.join();
+	}
+
+	void RenderAhead()
+	{
+		std::unique_lock<std::mutex> lock(WorkerLock);
+		while(!WorkerQuit.load())
+		{
+			size_t write = WritePos.load(std::memory_order_relaxed);
+			if(Ring.Size() - (write - ReadPos.load(std::memory_order_acquire)) < Scratch.Size())
+			{
+				// Full; wait until Process takes a buffer out.
+				WorkerWake.wait_for(lock, std::chrono::milliseconds(50));
+				continue;
+			}
+
+			lock.unlock();
+			bool more = Callback(this, &Scratch[0], Scratch.Size(), UserData);
+			if(more)
+			{
+				// The ring holds a whole number of buffers, so this never wraps.
+				memcpy(&Ring[write % Ring.Size()], &Scratch[0], Scratch.Size());
+				WritePos.store(write + Scratch.Size(), std::memory_order_release);
+			}
+			lock.lock();
+
+			if(!more)
+			{
+				WorkerEnded.store(true);
+				break;
+			}
+		}
+	}
+
+	// Gets the next buffer's worth of data, either from the render-ahead ring
+	// or straight from the callback. Returns false once the stream has ended.
+	bool FillData()
+	{
+		if(!Worker.joinable())
+			return Callback(this, &Data[0], Data.Size(), UserData);
+
+		size_t read = ReadPos.load(std::memory_order_relaxed);
+		if(WritePos.load(std::memory_order_acquire) - read < Data.Size())
+		{
+			if(WorkerEnded.load())
+				return false;
+
+			// The worker fell behind. Play silence rather than let the source
+			// run dry.
+			Underruns++;
+			memset(&Data[0], (Format == AL_FORMAT_MONO8 || Format == AL_FORMAT_STEREO8) ? 0x80 : 0, Data.Size());
+			return true;
+		}
+
+		memcpy(&Data[0], &Ring[read % Ring.Size()], Data.Size());
+		ReadPos.store(read + Data.Size(), std::memory_order_release);
+		WorkerWake.notify_one();
+		return true;
+	}
+
 	bool SetupSource()
 	{
 		/* Get a source, killing the farthest, lowest-priority sound if needed */
@@ -227,7 +328,8 @@ class OpenALSoundStream : public SoundStream
 
 public:
 	OpenALSoundStream(OpenALSoundRenderer *renderer)
-	  : Renderer(renderer), Source(0), Playing(false), Volume(1.0f)
+	  : Renderer(renderer), Source(0), Playing(false), Volume(1.0f),
+	    ReadPos(0), WritePos(0), WorkerQuit(false), WorkerEnded(false), Underruns(0)
 	{
 		memset(Buffers, 0, sizeof(Buffers));
 		Renderer->AddStream(this);
@@ -236,6 +338,7 @@ public:
 	virtual ~OpenALSoundStream()
 	{
 		Renderer->RemoveStream(this);
+		StopWorker();
 
 		if(Source)
 		{
@@ -283,6 +386,9 @@ public:
 		if(getALError() != AL_NO_ERROR)
 			return false;
 
+		// The buffers queued above came from the callback directly, so the
+		// worker picks up right where they end.
+		StartWorker();
 		Playing.store(true);
 		return true;
 	}
@@ -296,6 +402,7 @@ public:
 		alSourceStop(Source);
 		alSourcei(Source, AL_BUFFER, 0);
 		getALError();
+		StopWorker();
 
 		Playing.store(false);
 	}
@@ -361,6 +468,13 @@ public:
 		if(state == AL_PLAYING)
 			stats += ", playing";
 		stats.AppendFormat(", %uHz", SampleRate);
+		if(Worker.joinable())
+		{
+			size_t ahead = WritePos.load() - ReadPos.load();
+			stats.AppendFormat(", %ums ahead (%u%% full), %u underruns",
+				unsigned(ahead * 1000 / (SampleRate * FrameSize)),
+				unsigned(ahead * 100 / Ring.Size()), Underruns.load());
+		}
 		if(!Playing)
 			stats += " XX";
 		return stats;
@@ -390,7 +504,7 @@ public:
 			alSourceUnqueueBuffers(Source, 1, &bufid);
 			processed--;
 
-			if(Callback(this, &Data[0], Data.Size(), UserData))
+			if(FillData())
 			{
 				alBufferData(bufid, Format, &Data[0], Data.Size(), SampleRate);
 				alSourceQueueBuffers(Source, 1, &bufid);
@@ -1054,60 +1168,41 @@ SoundHandle OpenALSoundRenderer::LoadSoundRaw(uint8_t *sfxdata, int length, int
 SoundHandle OpenALSoundRenderer::LoadSound(uint8_t *sfxdata, int length)
 {
 	SoundHandle retval = { NULL };
-	ALenum format = AL_NONE;
-	ChannelConfig chans;
-	SampleType type;
-	int srate;
-	uint32_t loop_start = 0, loop_end = ~0u;
-	bool startass = false, endass = false;
-
-	FindLoopTags(sfxdata, length, &loop_start, &startass, &loop_end, &endass);
-	auto decoder = CreateDecoder(sfxdata, length, true);
-	if (!decoder)
-		return retval;
+	FDecodedSound decoded;
 
-	SoundDecoder_GetInfo(decoder, &srate, &chans, &type);
-	int samplesize = 1;
-	if (chans == ChannelConfig_Mono)
-	{
-		if (type == SampleType_UInt8) format = AL_FORMAT_MONO8, samplesize = 1;
-		if (type == SampleType_Int16) format = AL_FORMAT_MONO16, samplesize = 2;
-	}
-	else if (chans == ChannelConfig_Stereo)
+	if (!I_DecodeSound(sfxdata, length, decoded))
 	{
-		if (type == SampleType_UInt8) format = AL_FORMAT_STEREO8, samplesize = 2;
-		if (type == SampleType_Int16) format = AL_FORMAT_STEREO16, samplesize = 4;
-	}
-
-	if (format == AL_NONE)
-	{
-		SoundDecoder_Close(decoder);
-		Printf("Unsupported audio format: %s, %s\n", GetChannelConfigName(chans),
-			GetSampleTypeName(type));
+		if (decoded.error.IsNotEmpty())
+			Printf("%s", decoded.error.GetChars());
 		return retval;
 	}
+	return LoadDecodedSound(decoded);
+}
 
-	std::vector<uint8_t> data;
-	unsigned total = 0;
-	unsigned got;
+SoundHandle OpenALSoundRenderer::LoadDecodedSound(FDecodedSound &decoded)
+{
+	SoundHandle retval = { NULL };
+	ALenum format = AL_NONE;
 
-	data.resize(total + 32768);
-	while ((got = (unsigned)SoundDecoder_Read(decoder, (char*)&data[total], data.size() - total)) > 0)
+	if (decoded.channels == 1)
 	{
-		total += got;
-		data.resize(total * 2);
+		if (decoded.bits == 8) format = AL_FORMAT_MONO8;
+		if (decoded.bits == 16) format = AL_FORMAT_MONO16;
 	}
-	data.resize(total);
-	if (total == 0)
+	else if (decoded.channels == 2)
+	{
+		if (decoded.bits == 8) format = AL_FORMAT_STEREO8;
+		if (decoded.bits == 16) format = AL_FORMAT_STEREO16;
+	}
+	if (format == AL_NONE || decoded.data.Size() == 0)
 	{
 		return retval;
 	}
-	SoundDecoder_Close(decoder);
 
 	ALenum err;
 	ALuint buffer = 0;
 	alGenBuffers(1, &buffer);
-	alBufferData(buffer, format, &data[0], (ALsizei)data.size(), srate);
+	alBufferData(buffer, format, decoded.data.Data(), (ALsizei)decoded.data.Size(), decoded.samplerate);
 	if((err=getALError()) != AL_NO_ERROR)
 	{
 		Printf("Failed to buffer data: %s\n", alGetString(err));
@@ -1116,15 +1211,9 @@ SoundHandle OpenALSoundRenderer::LoadSound(uint8_t *sfxdata, int length)
 		return retval;
 	}
 
-	if (!startass) loop_start = Scale(loop_start, srate, 1000);
-	if (!endass && loop_end != ~0u) loop_end = Scale(loop_end, srate, 1000);
-	const uint32_t samples = (uint32_t)data.size() / samplesize;
-	if (loop_start > samples) loop_start = 0;
-	if (loop_end > samples) loop_end = samples;
-
-	if ((loop_start > 0 || loop_end > 0) && loop_end > loop_start && AL.SOFT_loop_points)
+	if (decoded.loopend > decoded.loopstart && AL.SOFT_loop_points)
 	{
-		ALint loops[2] = { static_cast<ALint>(loop_start), static_cast<ALint>(loop_end) };
+		ALint loops[2] = { decoded.loopstart, decoded.loopend };
 		DPrintf(DMSG_NOTIFY, "Setting loop points %d -> %d\n", loops[0], loops[1]);
 		alBufferiv(buffer, AL_LOOP_POINTS_SOFT, loops);
 		// no console messages here, please!
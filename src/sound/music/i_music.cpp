@@ -54,6 +54,8 @@
 #include "s_music.h"
 #include "doomstat.h"
 #include "filereadermusicinterface.h"
+#include "adlmidi.h"
+#include "timidity/mixkernels.h"
 
 
 
@@ -346,6 +348,80 @@ CCMD(testmusicvol)
 		Printf("Current relative volume is %1.2f\n", relative_volume);
 }
 
+//==========================================================================
+//
+// CCMD adl_benchmark
+//
+// Times every libADLMIDI emulator core playing held notes through
+// adl_generate, with the chips rendered one after the other and on a
+// number of threads, and checks that both agree. The block size is the
+// number of frames requested at once. The MIDI player requests up to the
+// next event, which is usually less than 512.
+//
+//==========================================================================
+
+CCMD(adl_benchmark)
+{
+	int chips = argv.argc() > 1 ? atoi(argv[1]) : 6;
+	int threads = argv.argc() > 2 ? atoi(argv[2]) : 0;
+	int block = argv.argc() > 3 ? atoi(argv[3]) : 512;
+	int seconds = argv.argc() > 4 ? atoi(argv[4]) : 5;
+	if (chips <= 0 || threads < 0 || block <= 0 || seconds <= 0)
+	{
+		Printf("Usage: adl_benchmark [chips] [threads] [block size] [seconds]\n");
+		return;
+	}
+
+	for (int emu = 0; emu < ADLMIDI_EMU_end; emu++)
+	{
+		ADL_EmulatorBenchmark result;
+		if (adl_benchmarkEmulator(emu, chips, threads, seconds * 44100, block, &result) < 0)
+		{
+			continue;
+		}
+		Printf("%s: serial %.1fx, concurrent %.1fx realtime%s\n", result.name,
+			seconds / MAX(result.serialSeconds, 1e-6),
+			seconds / MAX(result.concurrentSeconds, 1e-6),
+			result.identical ? "" : TEXTCOLOR_RED " (output differs!)");
+	}
+}
+
+//==========================================================================
+//
+// CCMD gus_benchmark
+//
+// Times the GUS synth's resampling and mixing loops with every instruction
+// set the CPU supports, and checks them against the plain C++ version.
+//
+//==========================================================================
+
+CCMD(gus_benchmark)
+{
+	int voices = argv.argc() > 1 ? atoi(argv[1]) : 64;
+	int seconds = argv.argc() > 2 ? atoi(argv[2]) : 5;
+	if (voices <= 0 || seconds <= 0)
+	{
+		Printf("Usage: gus_benchmark [voices] [seconds]\n");
+		return;
+	}
+
+	Timidity::MixBenchmark results[Timidity::MIXKERNELS_Count];
+	Timidity::BenchmarkMixKernels(44100, voices, seconds * 44100, results);
+	for (auto &result : results)
+	{
+		if (!result.supported)
+		{
+			Printf("%s: not supported\n", result.name);
+			continue;
+		}
+		// Mixing 'voices' voices for 'seconds' seconds of audio took result.seconds,
+		// so this many voices could be mixed in real time.
+		Printf("%s: %.0f real-time voices%s\n", result.name,
+			voices * seconds / MAX(result.seconds, 1e-6),
+			result.maxError <= MIXKERNELS_TOLERANCE ? "" : TEXTCOLOR_RED " (output differs!)");
+	}
+}
+
 //==========================================================================
 //
 // STAT music
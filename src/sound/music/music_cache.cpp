@@ -0,0 +1,471 @@
+/*
+** music_cache.cpp
+** Keeps pre-rendered copies of synthesized music on disk
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 LZDoom07 contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Songs whose synthesizer is expensive but deterministic get rendered once
+** in the background and are played back from a WAV file afterwards. Only
+** synths that keep all of their state in the song instance are used for
+** this, because the render runs next to the song that is playing.
+**
+*/
+
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "files.h"
+#include "md5.h"
+#include "m_misc.h"
+#include "s_music.h"
+#include "templates.h"
+
+CVAR(Bool, mus_cache, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Int, mus_cachemaxlength, 900, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// seconds; longer songs are not cached
+EXTERN_CVAR(Int, snd_mididevice)
+
+static std::thread RenderThread;
+static std::atomic<bool> RenderBusy;
+static std::atomic<bool> RenderQuit;
+
+// A thread that is still joinable when it gets destroyed terminates the program,
+// so exits that never reach S_Shutdown must stop the render, too.
+static struct FRenderThreadGuard
+{
+	~FRenderThreadGuard()
+	{
+		S_ShutdownMusicCache();
+	}
+} RenderThreadGuard;
+
+// Prefixes of the settings that change what the cached synths produce.
+static const char *const SettingPrefixes[] = { "adl_", "opl_", "opn_", "mod_", "gme_", "snd_mididevice", "snd_outputrate" };
+
+//==========================================================================
+//
+// IsCacheable
+//
+// Decides by the song's signature whether its synth is worth caching and
+// safe to run next to the song that is playing.
+//
+//==========================================================================
+
+static bool IsCacheable(const TArray<uint8_t> &data, const MidiDeviceSetting *devp)
+{
+	auto Is = [&](size_t ofs, const char *id) { return data.Size() >= ofs + strlen(id) && !memcmp(&data[ofs], id, strlen(id)); };
+
+	bool midi = Is(0, "MThd") || Is(0, "MUS\x1a") || Is(0, "HMI-MIDISONG") || Is(0, "HMIMIDIP") ||
+		(Is(0, "FORM") && Is(8, "XDIR")) || (Is(0, "CAT ") && Is(8, "XMID")) || (Is(0, "RIFF") && Is(8, "RMID"));
+	if (midi)
+	{
+		int device = devp != nullptr ? devp->device : MDEV_DEFAULT;
+		if (device == MDEV_DEFAULT)
+		{
+			device = snd_mididevice == -3 ? MDEV_OPL : snd_mididevice == -7 ? MDEV_ADL : snd_mididevice == -8 ? MDEV_OPN : MDEV_DEFAULT;
+		}
+		// The sample based synths share instrument data between instances.
+		return device == MDEV_OPL || device == MDEV_ADL || device == MDEV_OPN;
+	}
+
+	// Trackers and chip music dumps
+	return Is(0, "IMPM") || Is(0, "Extended Module: ") || Is(44, "SCRM") || Is(0, "Vgm ") || Is(0, "\x1f\x8b") ||
+		Is(0, "SNES-SPC700") || Is(0, "NESM\x1a") || Is(0, "GBS");
+}
+
+//==========================================================================
+//
+// HasLoopPoint
+//
+// The cached copy is the song played once, and a looping play repeats it
+// from the first sample. That is only right for songs that loop back to
+// their start, so anything that may have a loop point of its own is played
+// from the synth when it has to loop. The checks err on the side of 'yes'.
+//
+//==========================================================================
+
+static uint32_t ReadVarLen(const TArray<uint8_t> &data, size_t &pos, size_t end)
+{
+	uint32_t value = 0;
+	while (pos < end)
+	{
+		uint8_t b = data[pos++];
+		value = (value << 7) | (b & 0x7f);
+		if (!(b & 0x80)) break;
+	}
+	return value;
+}
+
+static bool HasSMFLoopPoint(const TArray<uint8_t> &data, size_t pos)
+{
+	auto ReadBE = [&](size_t ofs) { return uint32_t((data[ofs] << 24) | (data[ofs + 1] << 16) | (data[ofs + 2] << 8) | data[ofs + 3]); };
+
+	if (pos + 8 > data.Size()) return true;
+	pos += 8 + ReadBE(pos + 4);
+	while (pos + 8 <= data.Size())
+	{
+		size_t start = pos + 8;
+		size_t end = std::min<size_t>(start + ReadBE(pos + 4), data.Size());
+		if (!memcmp(&data[pos], "MTrk", 4))
+		{
+			uint8_t running = 0;
+			for (size_t p = start; p < end;)
+			{
+				ReadVarLen(data, p, end);
+				if (p >= end) break;
+
+				uint8_t status = data[p];
+				if (status & 0x80)
+				{
+					p++;
+					if (status < 0xf0) running = status;
+				}
+				else if (running != 0)
+				{
+					status = running;
+				}
+				else return true;
+
+				if (status == 0xff)
+				{
+					p++;
+					p += ReadVarLen(data, p, end);
+				}
+				else if (status == 0xf0 || status == 0xf7)
+				{
+					p += ReadVarLen(data, p, end);
+				}
+				else if (status >= 0xf0)
+				{
+					return true;
+				}
+				else if ((status & 0xf0) == 0xc0 || (status & 0xf0) == 0xd0)
+				{
+					p += 1;
+				}
+				else
+				{
+					// EMIDI loop begin and global loop begin
+					if ((status & 0xf0) == 0xb0 && p < end && (data[p] == 116 || data[p] == 118)) return true;
+					p += 2;
+				}
+			}
+		}
+		pos = end;
+	}
+	return false;
+}
+
+static bool HasLoopPoint(const TArray<uint8_t> &data)
+{
+	auto Is = [&](size_t ofs, const char *id) { return data.Size() >= ofs + strlen(id) && !memcmp(&data[ofs], id, strlen(id)); };
+
+	if (Is(0, "MThd")) return HasSMFLoopPoint(data, 0);
+	if (Is(0, "RIFF") && Is(8, "RMID"))
+	{
+		for (size_t i = 12; i + 4 <= data.Size(); i++)
+		{
+			if (!memcmp(&data[i], "MThd", 4)) return HasSMFLoopPoint(data, i);
+		}
+		return true;
+	}
+	if (Is(0, "FORM") || Is(0, "CAT "))
+	{
+		// XMI has no running status, so a controller 116 always follows its status byte.
+		for (size_t i = 0; i + 1 < data.Size(); i++)
+		{
+			if ((data[i] & 0xf0) == 0xb0 && data[i + 1] == 116) return true;
+		}
+		return false;
+	}
+	if (Is(0, "MUS\x1a") || Is(0, "HMI-MIDISONG") || Is(0, "HMIMIDIP"))
+	{
+		return false;
+	}
+	if (Is(0, "Vgm ") && data.Size() >= 0x20)
+	{
+		return (data[0x1c] | data[0x1d] | data[0x1e] | data[0x1f]) != 0;
+	}
+	// Compressed VGM, trackers and the other chip dumps
+	return true;
+}
+
+//==========================================================================
+//
+// GetCachePath
+//
+// The file name is a hash of the song, the subsong and every setting that
+// changes the synthesized output.
+//
+//==========================================================================
+
+static FString GetCachePath(const TArray<uint8_t> &data, int order, const MidiDeviceSetting *devp, bool create)
+{
+	TArray<FString> settings;
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		for (auto prefix : SettingPrefixes)
+		{
+			if (!strnicmp(var->GetName(), prefix, strlen(prefix)))
+			{
+				settings.Push(FStringf("%s=%s", var->GetName(), var->GetHumanString()));
+				break;
+			}
+		}
+	}
+	std::sort(settings.begin(), settings.end(), [](const FString &a, const FString &b) { return a.CompareNoCase(b) < 0; });
+
+	FString key;
+	key.Format("%d;%d;%s", order, devp ? devp->device : MDEV_DEFAULT, devp ? devp->args.GetChars() : "");
+	for (auto &s : settings) key << ';' << s;
+
+	MD5Context md5;
+	uint8_t digest[16];
+	md5.Update(data.Data(), data.Size());
+	md5.Update((const uint8_t *)key.GetChars(), (unsigned)key.Len());
+	md5.Final(digest);
+
+	FString path = M_GetCachePath(create);
+	path << "/music";
+	if (create) CreatePath(path);
+	path << '/';
+	for (auto b : digest) path.AppendFormat("%02x", b);
+	path << ".wav";
+	return path;
+}
+
+//==========================================================================
+//
+// GetTooLongPath
+//
+// Songs that run past mus_cachemaxlength leave an empty file behind so they
+// are not rendered again each time they play. The limit is part of the name
+// because raising it should give them another try.
+//
+//==========================================================================
+
+static FString GetTooLongPath(const FString &path, int maxlength)
+{
+	FString toolong = path;
+	toolong.AppendFormat(".%d.long", maxlength);
+	return toolong;
+}
+
+//==========================================================================
+//
+// WriteWaveHeader
+//
+//==========================================================================
+
+static void WriteLE(FileWriter *fw, uint32_t v, int bytes)
+{
+	uint8_t b[4] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24) };
+	fw->Write(b, bytes);
+}
+
+static void WriteWaveHeader(FileWriter *fw, int channels, int samplerate, uint32_t datasize)
+{
+	fw->Write("RIFF", 4);
+	WriteLE(fw, 36 + datasize, 4);
+	fw->Write("WAVEfmt ", 8);
+	WriteLE(fw, 16, 4);
+	WriteLE(fw, 1, 2);						// PCM
+	WriteLE(fw, channels, 2);
+	WriteLE(fw, samplerate, 4);
+	WriteLE(fw, samplerate * channels * 2, 4);
+	WriteLE(fw, channels * 2, 2);
+	WriteLE(fw, 16, 2);
+	fw->Write("data", 4);
+	WriteLE(fw, datasize, 4);
+}
+
+//==========================================================================
+//
+// RenderSong
+//
+// Runs on the render thread. The song has already been opened and started
+// on the main thread; this only pulls samples out of it.
+//
+//==========================================================================
+
+static void RenderSong(ZMusic_MusicStream song, SoundStreamInfo fmt, FString path)
+{
+	bool isfloat = fmt.mNumChannels >= 0;
+	int channels = abs(fmt.mNumChannels);
+	FString temppath = path + ".tmp";
+	FileWriter *fw = FileWriter::Open(temppath);
+	bool done = false;
+
+	if (fw != nullptr)
+	{
+		TArray<uint8_t> buffer(fmt.mBufferSize, true);
+		TArray<int16_t> pcm;
+		int maxlength = MAX<int>(mus_cachemaxlength, 1);
+		uint64_t maxbytes = uint64_t(maxlength) * fmt.mSampleRate * channels * 2;
+		uint64_t written = 0;
+
+		WriteWaveHeader(fw, channels, fmt.mSampleRate, 0);
+		while (!RenderQuit.load() && written <= maxbytes)
+		{
+			if (!ZMusic_FillStream(song, buffer.Data(), buffer.Size()))
+			{
+				done = true;
+				break;
+			}
+			if (isfloat)
+			{
+				// Store 16 bit samples; that halves the size of the file.
+				const float *in = (const float *)buffer.Data();
+				pcm.Resize(buffer.Size() / sizeof(float));
+				for (unsigned i = 0; i < pcm.Size(); i++)
+				{
+					pcm[i] = (int16_t)clamp<float>(in[i] * 32767.f, -32768.f, 32767.f);
+				}
+				fw->Write(pcm.Data(), pcm.Size() * 2);
+				written += pcm.Size() * 2;
+			}
+			else
+			{
+				fw->Write(buffer.Data(), buffer.Size());
+				written += buffer.Size();
+			}
+		}
+		if (done)
+		{
+			fw->Seek(0, SEEK_SET);
+			WriteWaveHeader(fw, channels, fmt.mSampleRate, (uint32_t)written);
+		}
+		delete fw;
+
+		if (!done || rename(temppath, path) != 0)
+		{
+			remove(temppath);
+		}
+		if (!done && written > maxbytes)
+		{
+			delete FileWriter::Open(GetTooLongPath(path, maxlength));
+		}
+	}
+	ZMusic_Close(song);
+	RenderBusy.store(false);
+}
+
+//==========================================================================
+//
+// StartRender
+//
+//==========================================================================
+
+static void StartRender(const TArray<uint8_t> &data, int order, const MidiDeviceSetting *devp, const FString &path)
+{
+	// One render at a time is plenty.
+	if (RenderBusy.load())
+	{
+		return;
+	}
+	if (RenderThread.joinable())
+	{
+		RenderThread.join();
+	}
+
+	auto song = ZMusic_OpenSongMem(data.Data(), data.Size(), devp ? (EMidiDevice)devp->device : MDEV_DEFAULT, devp ? devp->args.GetChars() : "");
+	if (song == nullptr)
+	{
+		return;
+	}
+	SoundStreamInfo fmt;
+	ZMusic_GetStreamInfo(song, &fmt);
+	if (fmt.mBufferSize <= 0 || !ZMusic_Start(song, order, false))
+	{
+		ZMusic_Close(song);
+		return;
+	}
+
+	DPrintf(DMSG_NOTIFY, "Rendering music to %s\n", path.GetChars());
+	RenderBusy.store(true);
+	RenderQuit.store(false);
+	RenderThread = std::thread(RenderSong, song, fmt, path);
+}
+
+//==========================================================================
+//
+// S_GetCachedMusic
+//
+// Returns the file name of the cached copy of the song, or an empty string
+// if the song has to be synthesized. In that case a render is started for
+// next time. The reader is left at the start of the song either way.
+//
+//==========================================================================
+
+FString S_GetCachedMusic(FileReader &reader, int order, bool looping, const MidiDeviceSetting *devp)
+{
+	if (!mus_cache)
+	{
+		return "";
+	}
+
+	auto start = reader.Tell();
+	TArray<uint8_t> data = reader.Read();
+	reader.Seek(start, FileReader::SeekSet);
+	if (data.Size() == 0 || !IsCacheable(data, devp) || (looping && HasLoopPoint(data)))
+	{
+		return "";
+	}
+
+	FString path = GetCachePath(data, order, devp, true);
+	if (FileExists(path))
+	{
+		return path;
+	}
+	if (FileExists(GetTooLongPath(path, MAX<int>(mus_cachemaxlength, 1))))
+	{
+		return "";
+	}
+	StartRender(data, order, devp, path);
+	return "";
+}
+
+//==========================================================================
+//
+// S_ShutdownMusicCache
+//
+// Abandons a render that is still running.
+//
+//==========================================================================
+
+void S_ShutdownMusicCache()
+{
+	if (RenderThread.joinable())
+	{
+		RenderQuit.store(true);
+		RenderThread.join();
+	}
+}
@@ -104,6 +104,12 @@ CUSTOM_CVAR(Int, adl_volume_model, 0 /*ADLMIDI_VolumeModel_AUTO*/, CVAR_ARCHIVE
 	FORWARD_CVAR(adl_volume_model);
 }
 
+// Threads that render the emulated chips. 1 renders them one after the other, 0 uses half of the CPU threads.
+CUSTOM_CVAR(Int, adl_chip_threads, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_VIRTUAL)
+{
+	FORWARD_CVAR(adl_chip_threads);
+}
+
 //==========================================================================
 //
 // Fluidsynth MIDI device
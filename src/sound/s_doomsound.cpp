@@ -145,6 +145,7 @@ void S_Init()
 void S_Shutdown()
 {
 	S_StopMusic(true);
+	S_ShutdownMusicCache();
 
 	SN_StopAllSequences();
 
@@ -89,6 +89,7 @@
 #include "s_music.h"
 #include "filereadermusicinterface.h"
 #include "zmusic/zmusic.h"
+#include "stats.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -167,6 +168,15 @@ void S_StopStream()
 	}
 }
 
+ADD_STAT(musicstream)
+{
+	if (musicStream)
+	{
+		return musicStream->GetStats();
+	}
+	return "No stream playing";
+}
+
 
 //==========================================================================
 //
@@ -414,7 +424,8 @@ bool S_ChangeMusic (const char *musicname, int order, bool looping, bool force)
 	if (!mus_playing.name.IsEmpty() &&
 		mus_playing.handle != nullptr &&
 		stricmp (mus_playing.name, musicname) == 0 &&
-		ZMusic_IsLooping(mus_playing.handle) == looping)
+		ZMusic_IsLooping(mus_playing.handle) == looping &&
+		(order == mus_playing.baseorder || !mus_playing.cached))	// a pre-rendered song must be loaded again for another subsong.
 	{
 		if (order != mus_playing.baseorder)
 		{
@@ -446,6 +457,7 @@ bool S_ChangeMusic (const char *musicname, int order, bool looping, bool force)
 			id = strtoul (more+1, nullptr, 16);
 		}
 		S_StopMusic (true);
+		mus_playing.cached = false;
 		mus_playing.handle = ZMusic_OpenCDSong (track, id);
 		if (mus_playing.handle == nullptr)
 		{
@@ -507,6 +519,17 @@ bool S_ChangeMusic (const char *musicname, int order, bool looping, bool force)
 		}
 
 		// load & register it
+		FString cached = S_GetCachedMusic(reader, order, looping, devp);
+		if (cached.IsNotEmpty())
+		{
+			handle = ZMusic_OpenSongFile(cached, MDEV_DEFAULT, "");
+			if (handle == nullptr)
+			{
+				// Most likely libsndfile is missing.
+				DPrintf(DMSG_WARNING, "Unable to play cached music %s: %s\n", cached.GetChars(), ZMusic_GetLastError());
+			}
+		}
+		mus_playing.cached = handle != nullptr;
 		if (handle != nullptr)
 		{
 			mus_playing.handle = handle;
@@ -85,11 +85,17 @@ struct MusPlayingInfo
 	ZMusic_MusicStream handle;
 	int   baseorder;
 	bool  loop;
+	bool  cached;				// playing a pre-rendered copy, which only holds one subsong
 	FString	 LastSong;			// last music that was played
 };
 
 extern MusPlayingInfo mus_playing;
 
+// Pre-rendered music
+class FileReader;
+FString S_GetCachedMusic(FileReader &reader, int order, bool looping, const MidiDeviceSetting *devp);
+void S_ShutdownMusicCache();
+
 extern float relative_volume, saved_relative_volume;
 
 
@@ -39,6 +39,12 @@
 #include <io.h>
 #endif
 #include <fcntl.h>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 
 #include "templates.h"
 #include "s_soundinternal.h"
@@ -46,6 +52,9 @@
 #include "superfasthash.h"
 #include "s_music.h"
 #include "m_random.h"
+#include "c_cvars.h"
+#include "i_time.h"
+#include "stats.h"
 
 
 enum
@@ -55,6 +64,157 @@ enum
 static FRandom pr_soundpitch ("SoundPitch");
 SoundEngine* soundEngine;
 
+CVAR(Bool, snd_asyncdecode, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, snd_virtualize, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+//==========================================================================
+//
+// Background decoding of compressed sounds
+//
+// Decoding an Ogg or FLAC sound takes long enough to cause a hitch when a
+// sound is played for the first time. The decode gets done by a small
+// worker pool instead and only the upload to the sound renderer happens on
+// the main thread.
+//
+//==========================================================================
+
+struct FSoundDecodeJob
+{
+	int sfx;						// the sound that requested the decode
+	TArray<uint8_t> sfxdata;
+	FDecodedSound decoded;
+	bool success = false;
+	uint64_t queuetime = 0;
+	uint64_t decodetime = 0;		// set by the worker
+	std::future<void> done;
+
+	bool IsReady() const
+	{
+		return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+};
+
+class FSoundDecodePool
+{
+public:
+	~FSoundDecodePool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Quit = true;
+		}
+		Wake.notify_all();
+		for (auto &thread : Workers) thread.join();
+	}
+
+	std::future<void> Queue(std::function<void()> work)
+	{
+		std::packaged_task<void()> task(std::move(work));
+		auto future = task.get_future();
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			if (Workers.empty())
+			{
+				// Leave a core to the game itself. More than a few threads
+				// only compete for the disk.
+				int count = clamp<int>((int)std::thread::hardware_concurrency() - 1, 1, 4);
+				for (int i = 0; i < count; i++)
+				{
+					Workers.push_back(std::thread([this]() { WorkerProc(); }));
+				}
+			}
+			Jobs.push_back(std::move(task));
+		}
+		Wake.notify_one();
+		return future;
+	}
+
+private:
+	void WorkerProc()
+	{
+		std::unique_lock<std::mutex> lock(Lock);
+		for (;;)
+		{
+			while (!Quit && Jobs.empty()) Wake.wait(lock);
+			if (Jobs.empty()) return;
+			auto task = std::move(Jobs.front());
+			Jobs.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	std::vector<std::thread> Workers;
+	std::deque<std::packaged_task<void()>> Jobs;
+	std::mutex Lock;
+	std::condition_variable Wake;
+	bool Quit = false;
+};
+
+static FSoundDecodePool DecodePool;
+
+static struct
+{
+	int Queued, Decoded, Failed, Discarded, Stalls, LateStarts;
+	uint64_t DecodeTime, MaxDecodeTime, Latency, StallTime;
+} DecodeStats;
+
+ADD_STAT(sounddecode)
+{
+	FString out;
+	auto &s = DecodeStats;
+	double decoded = std::max(s.Decoded, 1);
+	out.Format("Decoded %d sounds, %d failed, %d pending, avg %.2f ms, max %.2f ms, avg latency %.2f ms\n"
+		"Waited for %d decodes, %.2f ms total, %d sounds started late",
+		s.Decoded, s.Failed, s.Queued - s.Decoded - s.Failed - s.Discarded,
+		s.DecodeTime / decoded * 1e-6, s.MaxDecodeTime * 1e-6, s.Latency / decoded * 1e-6,
+		s.Stalls, s.StallTime * 1e-6, s.LateStarts);
+	return out;
+}
+
+//==========================================================================
+//
+// Channel bookkeeping
+//
+// Every playing channel sits in a cell keyed by its sound and its position
+// on a coarse grid, so that CheckSoundLimit only has to look at copies of
+// the same sound nearby. Channels whose sound is out of earshot do not get
+// a voice from the sound renderer; they are kept as virtual channels and
+// started once the listener gets close enough.
+//
+//==========================================================================
+
+enum
+{
+	LIMIT_CELL_SIZE = 512,		// map units
+	LIMIT_CELL_SLACK = 128,		// how far a sound may move between two updates of its cell
+	LIMIT_MAX_CELLS = 4,		// larger ranges check all channels instead
+	LIMIT_UNPOSITIONED = -32768,
+};
+
+static struct
+{
+	int Virtualized, Restored, Expired;
+	int CellChecks, FullChecks;
+} ChannelStats;
+
+ADD_STAT(soundchannels)
+{
+	return soundEngine != nullptr ? soundEngine->GetChannelStats() : FString();
+}
+
+static uint64_t MakeCellKey(int sound_id, int x, int y)
+{
+	// 0 is reserved for channels that are in no cell.
+	return (uint64_t(uint32_t(sound_id + 1)) << 32) | (uint32_t(uint16_t(x)) << 16) | uint16_t(y);
+}
+
+static int CellCoord(float v)
+{
+	return (int)clamp<float>(floorf(v / LIMIT_CELL_SIZE), -32767.f, 32767.f);
+}
+
 //==========================================================================
 //
 // S_Init
@@ -81,6 +241,7 @@ void SoundEngine::Init(TArray<uint8_t> &curve)
 void SoundEngine::Clear()
 {
 	StopAllChannels();
+	DiscardDecodes();
 	UnloadAllSounds();
 	GetSounds().Clear();
 	ClearRandoms();
@@ -97,6 +258,7 @@ void SoundEngine::Shutdown ()
 	FSoundChan *chan, *next;
 
 	StopAllChannels();
+	DiscardDecodes();
 
 	for (chan = FreeChannels; chan != NULL; chan = next)
 	{
@@ -134,6 +296,20 @@ void SoundEngine::CacheMarkedSounds()
 		MarkUsed(chan->SoundID);
 	}
 
+	if (snd_asyncdecode)
+	{
+		// Start all decodes first so that they run in parallel. The loop
+		// below then only needs to pick up the results.
+		QueueDecodes = true;
+		for (unsigned i = 1; i < S_sfx.Size(); ++i)
+		{
+			if (S_sfx[i].bUsed)
+			{
+				CacheSound(&S_sfx[i]);
+			}
+		}
+		QueueDecodes = false;
+	}
 	for (unsigned i = 1; i < S_sfx.Size(); ++i)
 	{
 		if (S_sfx[i].bUsed)
@@ -230,6 +406,7 @@ FSoundChan *SoundEngine::GetChannel(void *syschan)
 
 void SoundEngine::ReturnChannel(FSoundChan *chan)
 {
+	UnindexChannel(chan);
 	UnlinkChannel(chan);
 	memset(chan, 0, sizeof(*chan));
 	LinkChannel(chan, &FreeChannels);
@@ -267,6 +444,122 @@ void SoundEngine::LinkChannel(FSoundChan *chan, FSoundChan **head)
 	chan->PrevChan = head;
 }
 
+//==========================================================================
+//
+// IndexChannel
+//
+// Moves a channel into the sound limit cell for its current position.
+// Only channels whose limit range cannot grow beyond the new sound's go
+// into a positioned cell; everything else is checked for every new copy
+// of its sound. See CheckSoundLimit.
+//
+//==========================================================================
+
+void SoundEngine::IndexChannel(FSoundChan *chan, const FVector3 *pos)
+{
+	uint64_t key;
+
+	if (pos != nullptr && (chan->ChanFlags & CHANF_IS3D) && chan->DistanceScale >= 1)
+	{
+		key = MakeCellKey(chan->SoundID, CellCoord(pos->X), CellCoord(pos->Z));
+	}
+	else
+	{
+		key = MakeCellKey(chan->SoundID, LIMIT_UNPOSITIONED, LIMIT_UNPOSITIONED);
+	}
+	if (key == chan->CellKey)
+	{
+		return;
+	}
+	UnindexChannel(chan);
+
+	FSoundChan *&head = ChannelCells[key];
+	chan->CellKey = key;
+	chan->PrevCellChan = nullptr;
+	chan->NextCellChan = head;
+	if (head != nullptr)
+	{
+		head->PrevCellChan = chan;
+	}
+	head = chan;
+}
+
+//==========================================================================
+//
+// UnindexChannel
+//
+//==========================================================================
+
+void SoundEngine::UnindexChannel(FSoundChan *chan)
+{
+	if (chan->CellKey == 0)
+	{
+		return;
+	}
+	if (chan->NextCellChan != nullptr)
+	{
+		chan->NextCellChan->PrevCellChan = chan->PrevCellChan;
+	}
+	if (chan->PrevCellChan != nullptr)
+	{
+		chan->PrevCellChan->NextCellChan = chan->NextCellChan;
+	}
+	else if (chan->NextCellChan != nullptr)
+	{
+		ChannelCells[chan->CellKey] = chan->NextCellChan;
+	}
+	else
+	{
+		// Drop empty cells so that the map only holds what is playing.
+		ChannelCells.Remove(chan->CellKey);
+	}
+	chan->CellKey = 0;
+	chan->NextCellChan = chan->PrevCellChan = nullptr;
+}
+
+//==========================================================================
+//
+// IsInaudible
+//
+// True if a sound at this position cannot be heard at all. Only sounds
+// beyond their rolloff's maximum distance qualify, so virtualizing them
+// changes nothing that can be heard.
+//
+//==========================================================================
+
+bool SoundEngine::IsInaudible(const FVector3 &pos, float volume, const FRolloffInfo *rolloff, float distscale)
+{
+	if (!snd_virtualize || !listener.valid || distscale <= 0)
+	{
+		return false;
+	}
+	float distance = (pos - listener.position).Length() * distscale;
+	return volume * GetRolloff(rolloff, distance) <= 0;
+}
+
+//==========================================================================
+//
+// GetChannelStats
+//
+//==========================================================================
+
+FString SoundEngine::GetChannelStats()
+{
+	int active = 0, virt = 0, evicted = 0;
+	for (FSoundChan *chan = Channels; chan != nullptr; chan = chan->NextChan)
+	{
+		if (chan->ChanFlags & CHANF_VIRTUAL) virt++;
+		else if (chan->ChanFlags & CHANF_EVICTED) evicted++;
+		else active++;
+	}
+	auto &s = ChannelStats;
+	FString out;
+	out.Format("%d active, %d virtual, %d evicted channels in %u limit cells\n"
+		"Virtualized %d, restored %d, expired %d, limit checks %d by cell, %d full",
+		active, virt, evicted, ChannelCells.CountUsed(), s.Virtualized, s.Restored, s.Expired, s.CellChecks, s.FullChecks);
+	return out;
+}
+
 //==========================================================================
 //
 //
@@ -484,7 +777,7 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	}
 
 	// Make sure the sound is loaded.
-	sfx = LoadSound(sfx);
+	sfx = LoadSound(sfx, false);
 
 	// The empty sound never plays.
 	if (sfx->lumpnum == sfx_empty)
@@ -492,6 +785,12 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		return NULL;
 	}
 
+	// If the sound is still being decoded, it gets started once it is ready.
+	if (!sfx->data.isValid() && !GSnd->IsNull())
+	{
+		chanflags |= CHANF_EVICTED | CHANF_DECODING;
+	}
+
 	// Select priority.
 	if (type == SOURCE_None || source == listener.ListenerObject)
 	{
@@ -546,6 +845,13 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		pitch = DEFAULT_PITCH;
 	}
 
+	// A sound that cannot be heard from here does not need a voice yet.
+	if (!(chanflags & CHANF_EVICTED) && attenuation > 0 && type != SOURCE_None && !GSnd->IsNull() &&
+		IsInaudible(pos, volume, rolloff, attenuation))
+	{
+		chanflags |= CHANF_EVICTED | CHANF_VIRTUAL;
+	}
+
 	if (chanflags & CHANF_EVICTED)
 	{
 		chan = NULL;
@@ -572,12 +878,34 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 			chan = (FSoundChan*)GSnd->StartSound (sfx->data, float(volume), pitch, startflags, NULL, startTime);
 		}
 	}
-	if (chan == NULL && (chanflags & CHANF_LOOP))
+	if (chan == NULL && (chanflags & CHANF_VIRTUAL))
+	{
+		// Looping sounds start from the beginning once they can be heard. One-shot
+		// sounds start where they would be by then and are forgotten when they end.
+		chan = (FSoundChan*)GetChannel(NULL);
+		if (!(chanflags & CHANF_LOOP))
+		{
+			unsigned length = GSnd->GetMSLength(sfx->data);
+			startTime = clamp(startTime, 0.f, length / 1000.f);
+			GSnd->MarkStartTime(chan, startTime);
+			chan->VirtualEnd = I_msTime() + length - uint64_t(startTime * 1000);
+		}
+		ChannelStats.Virtualized++;
+	}
+	else if (chan == NULL && (chanflags & CHANF_LOOP))
 	{
 		chan = (FSoundChan*)GetChannel(NULL);
 		GSnd->MarkStartTime(chan);
 		chanflags |= CHANF_EVICTED;
 	}
+	else if (chan == NULL && (chanflags & CHANF_DECODING))
+	{
+		// A start time of 0 makes the sound play from the beginning when it is ready
+		// instead of skipping the time it took to decode.
+		chan = (FSoundChan*)GetChannel(NULL);
+		if (startTime > 0) GSnd->MarkStartTime(chan, startTime);
+		DecodeStats.LateStarts++;
+	}
 	if (attenuation > 0 && type != SOURCE_None)
 	{
 		chanflags |= CHANF_IS3D | CHANF_JUSTSTARTED;
@@ -608,6 +936,12 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		{
 			chan->Source = source;
 		}
+		if (chan->SysChannel == NULL)
+		{
+			// The sound renderer only fills this in for the channels it starts.
+			chan->Rolloff = *rolloff;
+		}
+		IndexChannel(chan, &pos);
 		
 		if (spitch > 0.0)				// A_StartSound has top priority over all others.
 			SetPitch(chan, spitch);
@@ -679,6 +1013,19 @@ void SoundEngine::RestartChannel(FSoundChan *chan)
 		{
 			return;
 		}
+		IndexChannel(chan, &pos);
+
+		if (IsInaudible(pos, chan->Volume, &chan->Rolloff, chan->DistanceScale))
+		{
+			if (chan->ChanFlags & CHANF_LOOP)
+			{
+				// Start over once it can be heard again.
+				chan->StartTime = 0;
+				chan->ChanFlags &= ~CHANF_ABSTIME;
+			}
+			chan->ChanFlags |= CHANF_VIRTUAL;
+			return;
+		}
 
 		// If this sound doesn't like playing near itself, don't play it if
 		// that's what would happen.
@@ -693,6 +1040,7 @@ void SoundEngine::RestartChannel(FSoundChan *chan)
 	}
 	else
 	{
+		IndexChannel(chan, nullptr);
 		chan->ChanFlags &= ~(CHANF_EVICTED|CHANF_ABSTIME);
 		ochan = (FSoundChan*)GSnd->StartSound(sfx->data, chan->Volume, chan->Pitch, startflags, chan);
 	}
@@ -708,13 +1056,17 @@ void SoundEngine::RestartChannel(FSoundChan *chan)
 // S_LoadSound
 //
 // Returns a pointer to the sfxinfo with the actual sound data.
+// If wait is false, a compressed sound may get decoded in the background
+// instead, in which case the returned sound has no data yet.
 //
 //==========================================================================
 
-sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
+sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx, bool wait)
 {
 	if (GSnd->IsNull()) return sfx;
 
+	bool async = snd_asyncdecode && (!wait || QueueDecodes);
+
 	while (!sfx->data.isValid())
 	{
 		unsigned int i;
@@ -740,6 +1092,23 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 			}
 		}
 
+		// The lump may already be getting decoded.
+		FSoundDecodeJob **pjob = sfx->bLoadRAW ? nullptr : DecodeJobs.CheckKey(sfx->lumpnum);
+		if (pjob != nullptr)
+		{
+			if (async && !(*pjob)->IsReady())
+			{
+				return sfx;
+			}
+			FinishDecode(sfx, *pjob);
+			if (!sfx->data.isValid())
+			{
+				sfx->lumpnum = sfx_empty;
+				continue;
+			}
+			break;
+		}
+
 		DPrintf(DMSG_NOTIFY, "Loading sound \"%s\" (%td)\n", sfx->name.GetChars(), sfx - &S_sfx[0]);
 
 		auto sfxdata = ReadSound(sfx->lumpnum);
@@ -765,6 +1134,12 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 				if (frequency == 0) frequency = 11025;
 				sfx->data = GSnd->LoadSoundRaw(sfxdata.Data()+8, dmxlen, frequency, 1, 8, sfx->LoopStart);
 			}
+			// Compressed sounds can be decoded in the background.
+			else if (async)
+			{
+				QueueDecode(sfx, sfxdata);
+				return sfx;
+			}
 			// If that fails, let the sound system try and figure it out.
 			else
 			{
@@ -785,6 +1160,143 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 	return sfx;
 }
 
+//==========================================================================
+//
+// QueueDecode
+//
+// Hands a compressed sound to the decode workers. The data gets moved into
+// the job.
+//
+//==========================================================================
+
+void SoundEngine::QueueDecode(sfxinfo_t *sfx, TArray<uint8_t> &sfxdata)
+{
+	auto job = new FSoundDecodeJob;
+	job->sfx = int(sfx - &S_sfx[0]);
+	job->sfxdata = std::move(sfxdata);
+	job->queuetime = I_nsTime();
+	job->done = DecodePool.Queue([job]()
+	{
+		uint64_t start = I_nsTime();
+		job->success = I_DecodeSound(job->sfxdata.Data(), job->sfxdata.Size(), job->decoded);
+		job->decodetime = I_nsTime() - start;
+	});
+	DecodeJobs[sfx->lumpnum] = job;
+	DecodeStats.Queued++;
+}
+
+//==========================================================================
+//
+// FinishDecode
+//
+// Waits for a decode job if necessary and passes the result to the sound
+// renderer.
+//
+//==========================================================================
+
+void SoundEngine::FinishDecode(sfxinfo_t *sfx, FSoundDecodeJob *job)
+{
+	if (!job->IsReady())
+	{
+		uint64_t start = I_nsTime();
+		job->done.wait();
+		DecodeStats.Stalls++;
+		DecodeStats.StallTime += I_nsTime() - start;
+	}
+	DecodeJobs.Remove(sfx->lumpnum);
+
+	if (job->success)
+	{
+		if (!sfx->data.isValid())
+		{
+			DPrintf(DMSG_NOTIFY, "Loaded sound \"%s\" (%td)\n", sfx->name.GetChars(), sfx - &S_sfx[0]);
+			sfx->data = GSnd->LoadDecodedSound(job->decoded);
+		}
+		DecodeStats.Decoded++;
+		DecodeStats.DecodeTime += job->decodetime;
+		DecodeStats.MaxDecodeTime = std::max(DecodeStats.MaxDecodeTime, job->decodetime);
+		DecodeStats.Latency += I_nsTime() - job->queuetime;
+	}
+	else
+	{
+		if (job->decoded.error.IsNotEmpty())
+		{
+			Printf("%s", job->decoded.error.GetChars());
+		}
+		DecodeStats.Failed++;
+	}
+	delete job;
+}
+
+//==========================================================================
+//
+// UpdateDecodes
+//
+// Loads the sounds that have finished decoding and starts the channels
+// that were waiting for them.
+//
+//==========================================================================
+
+void SoundEngine::UpdateDecodes()
+{
+	TArray<FSoundDecodeJob*> ready;
+	TMap<int, FSoundDecodeJob*>::Iterator it(DecodeJobs);
+	TMap<int, FSoundDecodeJob*>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		if (pair->Value->IsReady()) ready.Push(pair->Value);
+	}
+	for (auto job : ready)
+	{
+		FinishDecode(&S_sfx[job->sfx], job);
+	}
+
+	FSoundChan *chan, *next;
+	for (chan = Channels; chan != nullptr; chan = next)
+	{
+		next = chan->NextChan;
+		if (!(chan->ChanFlags & CHANF_DECODING))
+		{
+			continue;
+		}
+		sfxinfo_t *sfx = LoadSound(&S_sfx[chan->SoundID], false);
+		if (!sfx->data.isValid() && sfx->lumpnum != sfx_empty)
+		{
+			continue;
+		}
+		chan->ChanFlags &= ~CHANF_DECODING;
+		if (chan->ChanFlags & CHANF_EVICTED)
+		{
+			RestartChannel(chan);
+			if ((chan->ChanFlags & (CHANF_EVICTED | CHANF_LOOP)) == CHANF_EVICTED)
+			{ // Could not be started and is not looping. Forget about it.
+				ReturnChannel(chan);
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// DiscardDecodes
+//
+// Throws away all decodes in progress, waiting for the workers to finish.
+//
+//==========================================================================
+
+void SoundEngine::DiscardDecodes()
+{
+	TMap<int, FSoundDecodeJob*>::Iterator it(DecodeJobs);
+	TMap<int, FSoundDecodeJob*>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		pair->Value->done.wait();
+		delete pair->Value;
+		DecodeStats.Discarded++;
+	}
+	DecodeJobs.Clear();
+}
+
 //==========================================================================
 //
 // S_CheckSingular
@@ -805,6 +1317,39 @@ bool SoundEngine::CheckSingular(int sound_id)
 	return false;
 }
 
+//==========================================================================
+//
+// CheckLimitChannel
+//
+// Counts a channel for CheckSoundLimit if it is in range. Returns true if
+// it is the channel being restarted.
+//
+//==========================================================================
+
+bool SoundEngine::CheckLimitChannel(FSoundChan *chan, sfxinfo_t *sfx, const FVector3 &pos, float limit_range,
+	int sourcetype, const void *actor, int channel, float attenuation, int &count)
+{
+	if (!(chan->ChanFlags & CHANF_EVICTED) && &S_sfx[chan->SoundID] == sfx)
+	{
+		FVector3 chanorigin;
+
+		if (actor != NULL && chan->EntChannel == channel &&
+			chan->SourceType == sourcetype && chan->Source == actor)
+		{ // We are restarting a playing sound. Always let it play.
+			return true;
+		}
+
+		CalcPosVel(chan, &chanorigin, NULL);
+		// scale the limit distance with the attenuation. An attenuation of 0 means the limit distance is infinite and all sounds within the level are inside the limit.
+		float attn = std::min(chan->DistanceScale, attenuation);
+		if (attn <= 0 || (chanorigin - pos).LengthSquared() <= limit_range / attn)
+		{
+			count++;
+		}
+	}
+	return false;
+}
+
 //==========================================================================
 //
 // S_CheckSoundLimit
@@ -818,6 +1363,9 @@ bool SoundEngine::CheckSingular(int sound_id)
 // the same channel, this sound will not be limited. In this case, we're
 // restarting an already playing sound, so there's no need to limit it.
 //
+// Only the limit cells within reach of the new sound get searched,
+// unless the range is so large that it hardly makes a difference.
+//
 // Returns true if the sound should not play.
 //
 //==========================================================================
@@ -826,26 +1374,51 @@ bool SoundEngine::CheckSoundLimit(sfxinfo_t *sfx, const FVector3 &pos, int near_
 	int sourcetype, const void *actor, int channel, float attenuation)
 {
 	FSoundChan *chan;
-	int count;
-	
-	for (chan = Channels, count = 0; chan != NULL && count < near_limit; chan = chan->NextChan)
+	int count = 0;
+
+	// Channels in positioned cells have a distance scale of at least 1, so none of them
+	// can count from further away than this.
+	float range = attenuation > 0 ? sqrtf(limit_range / std::min(attenuation, 1.f)) + LIMIT_CELL_SLACK : 0;
+	int cells = int(range / LIMIT_CELL_SIZE) + 1;
+
+	if (attenuation <= 0 || cells > LIMIT_MAX_CELLS)
 	{
-		if (!(chan->ChanFlags & CHANF_EVICTED) && &S_sfx[chan->SoundID] == sfx)
+		// The range covers most of the level anyway.
+		ChannelStats.FullChecks++;
+		for (chan = Channels; chan != NULL && count < near_limit; chan = chan->NextChan)
 		{
-			FVector3 chanorigin;
-
-			if (actor != NULL && chan->EntChannel == channel &&
-				chan->SourceType == sourcetype && chan->Source == actor)
-			{ // We are restarting a playing sound. Always let it play.
+			if (CheckLimitChannel(chan, sfx, pos, limit_range, sourcetype, actor, channel, attenuation, count))
+			{
 				return false;
 			}
+		}
+		return count >= near_limit;
+	}
+
+	ChannelStats.CellChecks++;
+	int sound_id = int(sfx - &S_sfx[0]);
+	auto unpositioned = ChannelCells.CheckKey(MakeCellKey(sound_id, LIMIT_UNPOSITIONED, LIMIT_UNPOSITIONED));
+	for (chan = unpositioned ? *unpositioned : NULL; chan != NULL && count < near_limit; chan = chan->NextCellChan)
+	{
+		if (CheckLimitChannel(chan, sfx, pos, limit_range, sourcetype, actor, channel, attenuation, count))
+		{
+			return false;
+		}
+	}
 
-			CalcPosVel(chan, &chanorigin, NULL);
-			// scale the limit distance with the attenuation. An attenuation of 0 means the limit distance is infinite and all sounds within the level are inside the limit.
-			float attn = std::min(chan->DistanceScale, attenuation);
-			if (attn <= 0 || (chanorigin - pos).LengthSquared() <= limit_range / attn)
+	int x1 = CellCoord(pos.X - range), x2 = CellCoord(pos.X + range);
+	int y1 = CellCoord(pos.Z - range), y2 = CellCoord(pos.Z + range);
+	for (int x = x1; x <= x2 && count < near_limit; x++)
+	{
+		for (int y = y1; y <= y2 && count < near_limit; y++)
+		{
+			auto cell = ChannelCells.CheckKey(MakeCellKey(sound_id, x, y));
+			for (chan = cell ? *cell : NULL; chan != NULL && count < near_limit; chan = chan->NextCellChan)
 			{
-				count++;
+				if (CheckLimitChannel(chan, sfx, pos, limit_range, sourcetype, actor, channel, attenuation, count))
+				{
+					return false;
+				}
 			}
 		}
 	}
@@ -1213,7 +1786,15 @@ void SoundEngine::RestoreEvictedChannel(FSoundChan *chan)
 		return;
 	}
 	RestoreEvictedChannel(chan->NextChan);
-	if (chan->ChanFlags & CHANF_EVICTED)
+	if (chan->ChanFlags & CHANF_DECODING)
+	{
+		// UpdateDecodes starts this channel once its sound is ready.
+	}
+	else if (chan->ChanFlags & CHANF_VIRTUAL)
+	{
+		UpdateVirtualChannel(chan);
+	}
+	else if (chan->ChanFlags & CHANF_EVICTED)
 	{
 		RestartChannel(chan);
 		if (!(chan->ChanFlags & CHANF_LOOP))
@@ -1234,6 +1815,35 @@ void SoundEngine::RestoreEvictedChannel(FSoundChan *chan)
 	}
 }
 
+//==========================================================================
+//
+// UpdateVirtualChannel
+//
+// Starts a virtual channel if it can be heard now.
+//
+//==========================================================================
+
+void SoundEngine::UpdateVirtualChannel(FSoundChan *chan)
+{
+	if (!(chan->ChanFlags & CHANF_LOOP) && I_msTime() >= chan->VirtualEnd)
+	{
+		ChannelStats.Expired++;
+		ReturnChannel(chan);
+		return;
+	}
+	chan->ChanFlags &= ~CHANF_VIRTUAL;
+	RestartChannel(chan);
+	if (!(chan->ChanFlags & CHANF_EVICTED))
+	{
+		ChannelStats.Restored++;
+	}
+	else
+	{
+		// Still out of earshot, or there was no free voice.
+		chan->ChanFlags |= CHANF_VIRTUAL;
+	}
+}
+
 //==========================================================================
 //
 // S_RestoreEvictedChannels
@@ -1265,8 +1875,18 @@ void SoundEngine::UpdateSounds(int time)
 		if ((chan->ChanFlags & (CHANF_EVICTED | CHANF_IS3D)) == CHANF_IS3D)
 		{
 			CalcPosVel(chan, &pos, &vel);
+			IndexChannel(chan, &pos);
 
-			if (ValidatePosVel(chan, pos, vel))
+			if ((chan->ChanFlags & CHANF_LOOP) && IsInaudible(pos, chan->Volume, &chan->Rolloff, chan->DistanceScale))
+			{
+				// Give the voice back until the sound can be heard again.
+				chan->ChanFlags |= CHANF_EVICTED | CHANF_VIRTUAL;
+				chan->ChanFlags &= ~CHANF_ABSTIME;
+				chan->StartTime = 0;
+				StopChannel(chan);
+				ChannelStats.Virtualized++;
+			}
+			else if (ValidatePosVel(chan, pos, vel))
 			{
 				GSnd->UpdateSoundParams3D(&listener, chan, !!(chan->ChanFlags & CHANF_AREA), pos, vel);
 			}
@@ -1278,6 +1898,8 @@ void SoundEngine::UpdateSounds(int time)
 	GSnd->UpdateListener(&listener);
 	GSnd->UpdateSounds();
 
+	UpdateDecodes();
+
 	if (time >= RestartEvictionsAt)
 	{
 		RestartEvictionsAt = 0;
@@ -1438,6 +2060,7 @@ void SoundEngine::StopChannel(FSoundChan *chan)
 
 void SoundEngine::UnloadAllSounds()
 {
+	DiscardDecodes();
 	for (unsigned i = 0; i < S_sfx.Size(); i++)
 	{
 		UnloadSound(&S_sfx[i]);
@@ -146,6 +146,17 @@ struct FSoundChan : public FISoundChannel
 	float		LimitRange;
 	const void *Source;
 	float Point[3];	// Sound is not attached to any source.
+	FSoundChan	*NextCellChan;	// Next channel in the same sound limit cell.
+	FSoundChan	*PrevCellChan;
+	uint64_t	CellKey;	// Sound limit cell, 0 if the channel is in none.
+	uint64_t	VirtualEnd;	// I_msTime() at which a virtual one-shot sound would have ended.
+};
+
+// Sound limit cells are keyed by sound and position. Both halves of the key go into the hash.
+struct FSoundCellTraits
+{
+	hash_t Hash(const uint64_t key) { return hash_t(key) ^ (hash_t(key >> 32) * 0x9e3779b1u); }
+	int Compare(const uint64_t left, const uint64_t right) { return left != right; }
 };
 
 
@@ -196,6 +207,8 @@ void S_SetEnvironment (const ReverbContainer *settings);
 ReverbContainer *S_FindEnvironment (const char *name);
 ReverbContainer *S_FindEnvironment (int id);
 void S_AddEnvironment (ReverbContainer *settings);
+
+struct FSoundDecodeJob;
 	
 class SoundEngine
 {
@@ -206,6 +219,7 @@ protected:
 
 	FSoundChan* Channels = nullptr;
 	FSoundChan* FreeChannels = nullptr;
+	TMap<uint64_t, FSoundChan*, FSoundCellTraits> ChannelCells;	// for CheckSoundLimit
 
 	// the complete set of sound effects
 	TArray<sfxinfo_t> S_sfx;
@@ -215,12 +229,25 @@ protected:
 	TArray<FRandomSoundList> S_rnd;
 	bool blockNewSounds = false;
 
+	// Sounds being decoded in the background, by lump number.
+	TMap<int, FSoundDecodeJob*> DecodeJobs;
+	bool QueueDecodes = false;		// LoadSound only starts decoding, for precaching
+
 private:
 	void LinkChannel(FSoundChan* chan, FSoundChan** head);
 	void UnlinkChannel(FSoundChan* chan);
 	void ReturnChannel(FSoundChan* chan);
 	void RestartChannel(FSoundChan* chan);
 	void RestoreEvictedChannel(FSoundChan* chan);
+	void IndexChannel(FSoundChan* chan, const FVector3* pos);
+	void UnindexChannel(FSoundChan* chan);
+	bool IsInaudible(const FVector3& pos, float volume, const FRolloffInfo* rolloff, float distscale);
+	void UpdateVirtualChannel(FSoundChan* chan);
+
+	void QueueDecode(sfxinfo_t* sfx, TArray<uint8_t>& sfxdata);
+	void FinishDecode(sfxinfo_t* sfx, FSoundDecodeJob* job);
+	void UpdateDecodes();
+	void DiscardDecodes();
 
 	bool IsChannelUsed(int sourcetype, const void* actor, int channel, int* seen);
 	// This is the actual sound positioning logic which needs to be provided by the client.
@@ -232,6 +259,7 @@ private:
 
 	// Checks if a copy of this sound is already playing.
 	bool CheckSingular(int sound_id);
+	bool CheckLimitChannel(FSoundChan* chan, sfxinfo_t* sfx, const FVector3& pos, float limit_range, int sourcetype, const void* actor, int channel, float attenuation, int& count);
 	virtual TArray<uint8_t> ReadSound(int lumpnum) = 0;
 protected:
 	virtual bool CheckSoundLimit(sfxinfo_t* sfx, const FVector3& pos, int near_limit, float limit_range, int sourcetype, const void* actor, int channel, float attenuation);
@@ -253,7 +281,7 @@ public:
 	virtual void SetSource(FSoundChan* chan, int index) {}
 
 	virtual void StopChannel(FSoundChan* chan);
-	sfxinfo_t* LoadSound(sfxinfo_t* sfx);
+	sfxinfo_t* LoadSound(sfxinfo_t* sfx, bool wait = true);
 
 	// Initializes sound stuff, including volume
 	// Sets channels, SFX and music volume,
@@ -383,6 +411,7 @@ public:
 
 	void ChannelVirtualChanged(FISoundChannel* ichan, bool is_virtual);
 	FString ListSoundChannels();
+	FString GetChannelStats();
 
 	// Allow this to be overridden for special needs.
 	virtual float GetRolloff(const FRolloffInfo* rolloff, float distance);
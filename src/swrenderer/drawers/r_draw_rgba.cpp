@@ -60,9 +60,15 @@
 #include "r_draw_span32_sse2.h"
 #include "r_draw_sky32_sse2.h"
 #endif
+#include "r_draw_span32_avx2.h"
+#include "r_draw_wall32_avx2.h"
+#include "swrenderer/r_renderthread.h"
+#include "swrenderer/r_swcolormaps.h"
 
 #include "gi.h"
 #include "stats.h"
+#include "c_dispatch.h"
+#include "v_text.h"
 #include "x86.h"
 #include <vector>
 
@@ -82,6 +88,13 @@ namespace swrenderer
 {
 	void SWTruecolorDrawers::DrawWallColumn(const WallDrawerArgs &args)
 	{
+#ifdef HAVE_AVX2_DRAWERS
+		if (r_avx2drawers && CPU.bAVX2)
+		{
+			Queue->Push<DrawWall32AVX2Command>(args);
+			return;
+		}
+#endif
 		Queue->Push<DrawWall32Command>(args);
 	}
 	
@@ -211,6 +224,13 @@ namespace swrenderer
 
 	void SWTruecolorDrawers::DrawSpan(const SpanDrawerArgs &args)
 	{
+#ifdef HAVE_AVX2_DRAWERS
+		if (r_avx2drawers && CPU.bAVX2)
+		{
+			Queue->Push<DrawSpan32AVX2Command>(args);
+			return;
+		}
+#endif
 		Queue->Push<DrawSpan32Command>(args);
 	}
 	
@@ -930,3 +950,154 @@ namespace swrenderer
 		}
 	}
 }
+
+//==========================================================================
+//
+// CCMD bench_drawers
+//
+// Draws the given texture as spans and wall columns into an offscreen
+// canvas with the regular drawers and with the AVX2 ones, times both and
+// checks that they produce the same pixels.
+//
+//==========================================================================
+
+CCMD(bench_drawers)
+{
+	using namespace swrenderer;
+
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: bench_drawers <texture> [iterations]\n");
+		return;
+	}
+	FTextureID picnum = TexMan.CheckForTexture(argv[1], ETextureType::Any);
+	if (!picnum.Exists())
+	{
+		Printf("Unknown texture %s\n", argv[1]);
+		return;
+	}
+	FTexture *tex = TexMan[picnum];
+	int iterations = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 20;
+
+	const int size = 512;
+	DSimpleCanvas canvas(viewwindowx + size, viewwindowy + size, true);
+	canvas.Lock();
+
+	RenderThread renderthread(nullptr);
+	RenderViewport *viewport = renderthread.Viewport.get();
+	viewport->RenderTarget = &canvas;
+	DrawerThread drawerthread;
+
+	SpanDrawerArgs spanargs;
+	spanargs.SetStyle(false, false, OPAQUE);
+	spanargs.SetLight(&NormalLight, 0.0f, 12 << FRACBITS);
+	spanargs.SetTexture(&renderthread, tex);
+	spanargs.SetTextureUPos(0.1);
+	spanargs.SetTextureVPos(0.2);
+	spanargs.SetTextureUStep(1.3 / size);
+	spanargs.SetTextureVStep(0.4 / size);
+	spanargs.SetDestX1(0);
+	spanargs.SetDestX2(size - 1);
+
+	WallDrawerArgs wallargs;
+	wallargs.SetStyle(false, false, OPAQUE);
+	wallargs.SetLight(&NormalLight, 0.0f, 12 << FRACBITS);
+	wallargs.SetCount(size);
+	wallargs.SetTextureVPos(FRACUNIT / 3);
+	wallargs.SetTextureVStep(FRACUNIT * 3 / size);
+
+	const uint32_t *pixels = tex->GetPixelsBgra();
+	int texwidth = tex->GetWidth();
+	int texheight = tex->GetHeight();
+
+	// Draws one full screen of either spans or wall columns.
+	auto draw = [&](bool wall, bool avx2)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			if (!wall)
+			{
+				spanargs.SetDestY(viewport, i);
+#ifdef HAVE_AVX2_DRAWERS
+				if (avx2)
+				{
+					DrawSpan32AVX2Command(spanargs).Execute(&drawerthread);
+					continue;
+				}
+#endif
+				DrawSpan32Command(spanargs).Execute(&drawerthread);
+			}
+			else
+			{
+				wallargs.SetDest(viewport, i, 0);
+#ifdef HAVE_AVX2_DRAWERS
+				if (avx2)
+				{
+					DrawWall32AVX2Command(wallargs).Execute(&drawerthread);
+					continue;
+				}
+#endif
+				DrawWall32Command(wallargs).Execute(&drawerthread);
+			}
+		}
+	};
+
+	TArray<uint32_t> reference(size * size, true);
+	auto copyresult = [&](uint32_t *out)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			memcpy(out + y * size, viewport->GetDest(0, y), size * sizeof(uint32_t));
+		}
+	};
+
+	static const char *const names[] = { "Span, magnified", "Span, minified", "Wall, nearest", "Wall, linear" };
+	for (int test = 0; test < 4; test++)
+	{
+		bool wall = test >= 2;
+		if (!wall)
+		{
+			spanargs.SetTextureLOD(test == 0 ? -1.0 : 1.0);
+		}
+		else
+		{
+			// A column of the texture, and the next one for linear filtering.
+			int column = texwidth / 3;
+			wallargs.SetTexture((const uint8_t*)(pixels + column * texheight), test == 3 ? (const uint8_t*)(pixels + ((column + 1) % texwidth) * texheight) : nullptr, texheight);
+			wallargs.SetTextureUPos(test == 3 ? 5 : 0);
+		}
+
+		cycle_t reftime, avxtime;
+		reftime.Reset();
+		avxtime.Reset();
+
+		reftime.Clock();
+		for (int i = 0; i < iterations; i++) draw(wall, false);
+		reftime.Unclock();
+		copyresult(reference.Data());
+
+		double pixelcount = double(size) * size * iterations;
+		Printf("%s: %s %.1f Mpixels/s", names[test], wall ? "DrawWall32Command" : "DrawSpan32Command", pixelcount / reftime.TimeMS() / 1000.);
+
+#ifdef HAVE_AVX2_DRAWERS
+		if (CPU.bAVX2)
+		{
+			memset(canvas.GetBuffer(), 0, canvas.GetPitch() * canvas.GetHeight() * 4);
+			avxtime.Clock();
+			for (int i = 0; i < iterations; i++) draw(wall, true);
+			avxtime.Unclock();
+
+			bool match = true;
+			for (int y = 0; y < size && match; y++)
+			{
+				match = memcmp(reference.Data() + y * size, viewport->GetDest(0, y), size * sizeof(uint32_t)) == 0;
+			}
+			Printf(", AVX2 %.1f Mpixels/s (%.2fx)%s", pixelcount / avxtime.TimeMS() / 1000.,
+				reftime.TimeMS() / avxtime.TimeMS(), match ? "" : TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL);
+		}
+#endif
+		Printf("\n");
+	}
+
+	canvas.Unlock();
+}
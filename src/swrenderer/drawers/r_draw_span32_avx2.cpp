@@ -0,0 +1,316 @@
+/*
+**  AVX2 drawer commands for spans
+**  Copyright (c) 2016 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#include <stddef.h>
+
+#include "templates.h"
+#include "doomdef.h"
+#include "v_palette.h"
+#include "x86.h"
+#include "swrenderer/drawers/r_draw_span32_avx2.h"
+#include "swrenderer/viewport/r_viewport.h"
+
+#ifdef HAVE_AVX2_DRAWERS
+#include <immintrin.h>
+
+// The rest of the program is not built with AVX2 enabled, so only the
+// functions that need it get the instructions.
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+#endif
+
+CVAR(Bool, r_avx2drawers, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+
+namespace swrenderer
+{
+	static inline uint32_t SampleSpanTexel(const SpanKernelArgs &kargs, uint32_t xfrac, uint32_t yfrac, uint32_t xone, uint32_t yone, bool is_64x64)
+	{
+		const uint32_t *source = kargs.source;
+		uint32_t width = kargs.width;
+		uint32_t height = kargs.height;
+
+		if (!kargs.linear && is_64x64)
+		{
+			int sample_index = ((xfrac >> (32 - 6 - 6)) & (63 * 64)) + (yfrac >> (32 - 6));
+			return source[sample_index];
+		}
+		else if (!kargs.linear)
+		{
+			uint32_t x = ((xfrac >> 16) * width) >> 16;
+			uint32_t y = ((yfrac >> 16) * height) >> 16;
+			int sample_index = x * height + y;
+			return source[sample_index];
+		}
+		else
+		{
+			uint32_t p00, p01, p10, p11;
+			uint32_t frac_x, frac_y;
+			if (is_64x64)
+			{
+				frac_x = xfrac >> 16 << 6;
+				frac_y = yfrac >> 16 << 6;
+				uint32_t x0 = frac_x >> 16;
+				uint32_t y0 = frac_y >> 16;
+				uint32_t x1 = (x0 + 1) & 0x3f;
+				uint32_t y1 = (y0 + 1) & 0x3f;
+				p00 = source[(y0 + (x0 << 6))];
+				p01 = source[(y1 + (x0 << 6))];
+				p10 = source[(y0 + (x1 << 6))];
+				p11 = source[(y1 + (x1 << 6))];
+			}
+			else
+			{
+				frac_x = (xfrac >> 16) * width;
+				frac_y = (yfrac >> 16) * height;
+				uint32_t x0 = frac_x >> 16;
+				uint32_t y0 = frac_y >> 16;
+				uint32_t x1 = (((xfrac + xone) >> 16) * width) >> 16;
+				uint32_t y1 = (((yfrac + yone) >> 16) * height) >> 16;
+				p00 = source[y0 + x0 * height];
+				p01 = source[y1 + x0 * height];
+				p10 = source[y0 + x1 * height];
+				p11 = source[y1 + x1 * height];
+			}
+
+			uint32_t inv_b = (frac_x >> 12) & 15;
+			uint32_t inv_a = (frac_y >> 12) & 15;
+			uint32_t a = 16 - inv_a;
+			uint32_t b = 16 - inv_b;
+
+			uint32_t sred = (RPART(p00) * (a * b) + RPART(p01) * (inv_a * b) + RPART(p10) * (a * inv_b) + RPART(p11) * (inv_a * inv_b) + 127) >> 8;
+			uint32_t sgreen = (GPART(p00) * (a * b) + GPART(p01) * (inv_a * b) + GPART(p10) * (a * inv_b) + GPART(p11) * (inv_a * inv_b) + 127) >> 8;
+			uint32_t sblue = (BPART(p00) * (a * b) + BPART(p01) * (inv_a * b) + BPART(p10) * (a * inv_b) + BPART(p11) * (inv_a * inv_b) + 127) >> 8;
+
+			return (sred << 16) | (sgreen << 8) | sblue;
+		}
+	}
+
+	void DrawOpaqueSpanKernel(const SpanKernelArgs &kargs)
+	{
+		bool is_64x64 = kargs.width == 64 && kargs.height == 64;
+		uint32_t xone = (0x80000000u / kargs.width) << 1;
+		uint32_t yone = (0x80000000u / kargs.height) << 1;
+		uint32_t xfrac = kargs.xfrac;
+		uint32_t yfrac = kargs.yfrac;
+
+		// Same 16 bit arithmetic as the SSE2 drawer so the results match.
+		uint32_t light = (uint32_t)kargs.light;
+
+		for (int i = 0; i < kargs.count; i++)
+		{
+			uint32_t texel = SampleSpanTexel(kargs, xfrac, yfrac, xone, yone, is_64x64);
+			uint32_t red = ((RPART(texel) * light) & 0xffff) >> 8;
+			uint32_t green = ((GPART(texel) * light) & 0xffff) >> 8;
+			uint32_t blue = ((BPART(texel) * light) & 0xffff) >> 8;
+			kargs.dest[i] = 0xff000000 | (red << 16) | (green << 8) | blue;
+
+			xfrac += kargs.xstep;
+			yfrac += kargs.ystep;
+		}
+	}
+
+#ifdef HAVE_AVX2_DRAWERS
+
+	// Spreads a weight per pixel over the four 16 bit channels of the pixels
+	// that unpacklo/unpackhi put into each half.
+	static inline AVX2_TARGET void SplitWeightsAVX2(__m256i weight, __m256i &lo, __m256i &hi)
+	{
+		weight = _mm256_or_si256(weight, _mm256_slli_epi32(weight, 16));
+		lo = _mm256_unpacklo_epi32(weight, weight);
+		hi = _mm256_unpackhi_epi32(weight, weight);
+	}
+
+	AVX2_TARGET void DrawOpaqueSpanKernelAVX2(const SpanKernelArgs &kargs)
+	{
+		const int *source = (const int *)kargs.source;
+		bool is_64x64 = kargs.width == 64 && kargs.height == 64;
+		uint32_t xone = (0x80000000u / kargs.width) << 1;
+		uint32_t yone = (0x80000000u / kargs.height) << 1;
+
+		__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i xfrac = _mm256_add_epi32(_mm256_set1_epi32(kargs.xfrac), _mm256_mullo_epi32(lane, _mm256_set1_epi32(kargs.xstep)));
+		__m256i yfrac = _mm256_add_epi32(_mm256_set1_epi32(kargs.yfrac), _mm256_mullo_epi32(lane, _mm256_set1_epi32(kargs.ystep)));
+		__m256i xstep = _mm256_set1_epi32(kargs.xstep * 8);
+		__m256i ystep = _mm256_set1_epi32(kargs.ystep * 8);
+		__m256i width = _mm256_set1_epi32(kargs.width);
+		__m256i height = _mm256_set1_epi32(kargs.height);
+		__m256i vxone = _mm256_set1_epi32(xone);
+		__m256i vyone = _mm256_set1_epi32(yone);
+		__m256i mask63 = _mm256_set1_epi32(63);
+		__m256i mask15 = _mm256_set1_epi32(15);
+		__m256i m16 = _mm256_set1_epi32(16);
+		__m256i zero = _mm256_setzero_si256();
+
+		short l = (short)kargs.light;
+		__m256i mlight = _mm256_set_epi16(256, l, l, l, 256, l, l, l, 256, l, l, l, 256, l, l, l);
+		__m256i m127 = _mm256_set1_epi16(127);
+		__m256i m255 = _mm256_set1_epi16(255);
+		__m256i alpha = _mm256_set1_epi32(0xff000000);
+
+		uint32_t *dest = kargs.dest;
+		int avxcount = kargs.count / 8;
+		for (int index = 0; index < avxcount; index++)
+		{
+			__m256i lo, hi;
+			if (!kargs.linear)
+			{
+				__m256i sample_index;
+				if (is_64x64)
+				{
+					sample_index = _mm256_add_epi32(
+						_mm256_and_si256(_mm256_srli_epi32(xfrac, 32 - 6 - 6), _mm256_set1_epi32(63 * 64)),
+						_mm256_srli_epi32(yfrac, 32 - 6));
+				}
+				else
+				{
+					__m256i x = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(xfrac, 16), width), 16);
+					__m256i y = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(yfrac, 16), height), 16);
+					sample_index = _mm256_add_epi32(_mm256_mullo_epi32(x, height), y);
+				}
+				__m256i texels = _mm256_i32gather_epi32(source, sample_index, 4);
+				lo = _mm256_unpacklo_epi8(texels, zero);
+				hi = _mm256_unpackhi_epi8(texels, zero);
+			}
+			else
+			{
+				__m256i frac_x, frac_y, i00, i01, i10, i11;
+				if (is_64x64)
+				{
+					frac_x = _mm256_slli_epi32(_mm256_srli_epi32(xfrac, 16), 6);
+					frac_y = _mm256_slli_epi32(_mm256_srli_epi32(yfrac, 16), 6);
+					__m256i x0 = _mm256_srli_epi32(frac_x, 16);
+					__m256i y0 = _mm256_srli_epi32(frac_y, 16);
+					__m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), mask63);
+					__m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), mask63);
+					x0 = _mm256_slli_epi32(x0, 6);
+					x1 = _mm256_slli_epi32(x1, 6);
+					i00 = _mm256_add_epi32(y0, x0);
+					i01 = _mm256_add_epi32(y1, x0);
+					i10 = _mm256_add_epi32(y0, x1);
+					i11 = _mm256_add_epi32(y1, x1);
+				}
+				else
+				{
+					frac_x = _mm256_mullo_epi32(_mm256_srli_epi32(xfrac, 16), width);
+					frac_y = _mm256_mullo_epi32(_mm256_srli_epi32(yfrac, 16), height);
+					__m256i x0 = _mm256_srli_epi32(frac_x, 16);
+					__m256i y0 = _mm256_srli_epi32(frac_y, 16);
+					__m256i x1 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(xfrac, vxone), 16), width), 16);
+					__m256i y1 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(yfrac, vyone), 16), height), 16);
+					x0 = _mm256_mullo_epi32(x0, height);
+					x1 = _mm256_mullo_epi32(x1, height);
+					i00 = _mm256_add_epi32(y0, x0);
+					i01 = _mm256_add_epi32(y1, x0);
+					i10 = _mm256_add_epi32(y0, x1);
+					i11 = _mm256_add_epi32(y1, x1);
+				}
+
+				__m256i p00 = _mm256_i32gather_epi32(source, i00, 4);
+				__m256i p01 = _mm256_i32gather_epi32(source, i01, 4);
+				__m256i p10 = _mm256_i32gather_epi32(source, i10, 4);
+				__m256i p11 = _mm256_i32gather_epi32(source, i11, 4);
+
+				__m256i inv_b = _mm256_and_si256(_mm256_srli_epi32(frac_x, 12), mask15);
+				__m256i inv_a = _mm256_and_si256(_mm256_srli_epi32(frac_y, 12), mask15);
+				__m256i a = _mm256_sub_epi32(m16, inv_a);
+				__m256i b = _mm256_sub_epi32(m16, inv_b);
+
+				__m256i w00lo, w00hi, w01lo, w01hi, w10lo, w10hi, w11lo, w11hi;
+				SplitWeightsAVX2(_mm256_mullo_epi32(a, b), w00lo, w00hi);
+				SplitWeightsAVX2(_mm256_mullo_epi32(inv_a, b), w01lo, w01hi);
+				SplitWeightsAVX2(_mm256_mullo_epi32(a, inv_b), w10lo, w10hi);
+				SplitWeightsAVX2(_mm256_mullo_epi32(inv_a, inv_b), w11lo, w11hi);
+
+				lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(p00, zero), w00lo);
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p01, zero), w01lo));
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p10, zero), w10lo));
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p11, zero), w11lo));
+				lo = _mm256_srli_epi16(_mm256_add_epi16(lo, m127), 8);
+
+				hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(p00, zero), w00hi);
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p01, zero), w01hi));
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p10, zero), w10hi));
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p11, zero), w11hi));
+				hi = _mm256_srli_epi16(_mm256_add_epi16(hi, m127), 8);
+			}
+
+			lo = _mm256_min_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(lo, mlight), 8), m255);
+			hi = _mm256_min_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(hi, mlight), 8), m255);
+			__m256i outcolor = _mm256_or_si256(_mm256_packus_epi16(lo, hi), alpha);
+			_mm256_storeu_si256((__m256i*)(dest + index * 8), outcolor);
+
+			xfrac = _mm256_add_epi32(xfrac, xstep);
+			yfrac = _mm256_add_epi32(yfrac, ystep);
+		}
+
+		int done = avxcount * 8;
+		if (done != kargs.count)
+		{
+			SpanKernelArgs rest = kargs;
+			rest.dest += done;
+			rest.count -= done;
+			rest.xfrac += done * kargs.xstep;
+			rest.yfrac += done * kargs.ystep;
+			DrawOpaqueSpanKernel(rest);
+		}
+	}
+
+	void DrawSpan32AVX2Command::Execute(DrawerThread *thread)
+	{
+		if (thread->line_skipped_by_thread(args.DestY())) return;
+
+		auto shade_constants = args.ColormapConstants();
+		if (!shade_constants.simple_shade || args.dc_num_lights != 0 || (r_mipmap && args.MipmappedTexture()))
+		{
+			DrawSpan32Command::Execute(thread);
+			return;
+		}
+
+		SpanKernelArgs kargs;
+		kargs.source = (const uint32_t*)args.TexturePixels();
+		kargs.width = args.TextureWidth();
+		kargs.height = args.TextureHeight();
+		kargs.xstep = args.TextureUStep();
+		kargs.ystep = args.TextureVStep();
+		kargs.xfrac = args.TextureUPos();
+		kargs.yfrac = args.TextureVPos();
+
+		bool magnifying = args.TextureLOD() < 0.0;
+		kargs.linear = !((magnifying && !r_magfilter) || (!magnifying && !r_minfilter));
+		if (kargs.linear)
+		{
+			kargs.xfrac -= ((0x80000000u / kargs.width) << 1) / 2;
+			kargs.yfrac -= ((0x80000000u / kargs.height) << 1) / 2;
+		}
+
+		kargs.light = 256 - (args.Light() >> (FRACBITS - 8));
+		kargs.count = args.DestX2() - args.DestX1() + 1;
+		kargs.dest = (uint32_t*)args.Viewport()->GetDest(args.DestX1(), args.DestY());
+
+		DrawOpaqueSpanKernelAVX2(kargs);
+	}
+
+#endif
+}
@@ -0,0 +1,75 @@
+/*
+**  AVX2 drawer commands for spans
+**  Copyright (c) 2016 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw_rgba.h"
+#include "swrenderer/viewport/r_spandrawer.h"
+#ifdef NO_SSE
+#include "swrenderer/drawers/r_draw_span32.h"
+#else
+#include "swrenderer/drawers/r_draw_span32_sse2.h"
+#endif
+
+#if defined(__i386__) || defined(__amd64__) || defined(_M_IX86) || defined(_M_X64)
+#define HAVE_AVX2_DRAWERS
+#endif
+
+// Use the AVX2 drawers when the CPU supports them
+EXTERN_CVAR(Bool, r_avx2drawers)
+
+namespace swrenderer
+{
+	// Plain description of an opaque, unlit, simple shaded span. This is the
+	// part of the span drawer that has an AVX2 version.
+	struct SpanKernelArgs
+	{
+		uint32_t *dest;
+		int count;
+		const uint32_t *source;
+		uint32_t width;
+		uint32_t height;
+		uint32_t xfrac;
+		uint32_t yfrac;
+		uint32_t xstep;
+		uint32_t ystep;
+		int light;
+		bool linear;
+	};
+
+	// Reference version, also used for the pixels left over by the AVX2 loop.
+	void DrawOpaqueSpanKernel(const SpanKernelArgs &kargs);
+
+#ifdef HAVE_AVX2_DRAWERS
+	void DrawOpaqueSpanKernelAVX2(const SpanKernelArgs &kargs);
+
+	// Opaque span drawer that takes the AVX2 kernel whenever the span can be
+	// drawn by it and otherwise leaves the work to the regular drawer.
+	class DrawSpan32AVX2Command : public DrawSpan32Command
+	{
+	public:
+		DrawSpan32AVX2Command(const SpanDrawerArgs &drawerargs) : DrawSpan32Command(drawerargs) { }
+
+		void Execute(DrawerThread *thread) override;
+	};
+#endif
+}
@@ -0,0 +1,254 @@
+/*
+**  AVX2 drawer commands for walls
+**  Copyright (c) 2016 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#include <stddef.h>
+
+#include "templates.h"
+#include "doomdef.h"
+#include "v_palette.h"
+#include "x86.h"
+#include "swrenderer/drawers/r_draw_wall32_avx2.h"
+#include "swrenderer/viewport/r_viewport.h"
+
+#ifdef HAVE_AVX2_DRAWERS
+#include <immintrin.h>
+
+// The rest of the program is not built with AVX2 enabled, so only the
+// functions that need it get the instructions.
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+#endif
+
+namespace swrenderer
+{
+	// Texture step of one texel, as the linear filter needs it.
+	static inline uint32_t WallTexelStep(uint32_t textureheight)
+	{
+		return ((0x80000000 + textureheight - 1) / textureheight) * 2 + 1;
+	}
+
+	static inline uint32_t SampleWallTexel(const WallKernelArgs &kargs, uint32_t frac, uint32_t one)
+	{
+		const uint32_t *source = kargs.source;
+		const uint32_t *source2 = kargs.source2;
+		uint32_t textureheight = kargs.textureheight;
+
+		if (source2 == nullptr)
+		{
+			int sample_index = ((frac >> FRACBITS) * textureheight) >> FRACBITS;
+			return source[sample_index];
+		}
+		else
+		{
+			uint32_t frac_y0 = (frac >> FRACBITS) * textureheight;
+			uint32_t frac_y1 = ((frac + one) >> FRACBITS) * textureheight;
+			uint32_t y0 = frac_y0 >> FRACBITS;
+			uint32_t y1 = frac_y1 >> FRACBITS;
+
+			uint32_t p00 = source[y0];
+			uint32_t p01 = source[y1];
+			uint32_t p10 = source2[y0];
+			uint32_t p11 = source2[y1];
+
+			uint32_t inv_b = kargs.texturefracx;
+			uint32_t inv_a = (frac_y1 >> (FRACBITS - 4)) & 15;
+			uint32_t a = 16 - inv_a;
+			uint32_t b = 16 - inv_b;
+
+			uint32_t sred = (RPART(p00) * (a * b) + RPART(p01) * (inv_a * b) + RPART(p10) * (a * inv_b) + RPART(p11) * (inv_a * inv_b) + 127) >> 8;
+			uint32_t sgreen = (GPART(p00) * (a * b) + GPART(p01) * (inv_a * b) + GPART(p10) * (a * inv_b) + GPART(p11) * (inv_a * inv_b) + 127) >> 8;
+			uint32_t sblue = (BPART(p00) * (a * b) + BPART(p01) * (inv_a * b) + BPART(p10) * (a * inv_b) + BPART(p11) * (inv_a * inv_b) + 127) >> 8;
+
+			return (sred << 16) | (sgreen << 8) | sblue;
+		}
+	}
+
+	void DrawOpaqueWallKernel(const WallKernelArgs &kargs)
+	{
+		uint32_t one = WallTexelStep(kargs.textureheight);
+		uint32_t frac = kargs.frac;
+		uint32_t *dest = kargs.dest;
+
+		// Same 16 bit arithmetic as the SSE2 drawer so the results match.
+		uint32_t light = (uint32_t)kargs.light;
+
+		for (int i = 0; i < kargs.count; i++)
+		{
+			uint32_t texel = SampleWallTexel(kargs, frac, one);
+			uint32_t red = ((RPART(texel) * light) & 0xffff) >> 8;
+			uint32_t green = ((GPART(texel) * light) & 0xffff) >> 8;
+			uint32_t blue = ((BPART(texel) * light) & 0xffff) >> 8;
+			*dest = 0xff000000 | (red << 16) | (green << 8) | blue;
+
+			frac += kargs.fracstep;
+			dest += kargs.pitch;
+		}
+	}
+
+#ifdef HAVE_AVX2_DRAWERS
+
+	// Spreads a weight per pixel over the four 16 bit channels of the pixels
+	// that unpacklo/unpackhi put into each half.
+	static inline AVX2_TARGET void SplitWallWeightsAVX2(__m256i weight, __m256i &lo, __m256i &hi)
+	{
+		weight = _mm256_or_si256(weight, _mm256_slli_epi32(weight, 16));
+		lo = _mm256_unpacklo_epi32(weight, weight);
+		hi = _mm256_unpackhi_epi32(weight, weight);
+	}
+
+	AVX2_TARGET void DrawOpaqueWallKernelAVX2(const WallKernelArgs &kargs)
+	{
+		const int *source = (const int *)kargs.source;
+		const int *source2 = (const int *)kargs.source2;
+		uint32_t one = WallTexelStep(kargs.textureheight);
+
+		__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i frac = _mm256_add_epi32(_mm256_set1_epi32(kargs.frac), _mm256_mullo_epi32(lane, _mm256_set1_epi32(kargs.fracstep)));
+		__m256i fracstep = _mm256_set1_epi32(kargs.fracstep * 8);
+		__m256i height = _mm256_set1_epi32(kargs.textureheight);
+		__m256i vone = _mm256_set1_epi32(one);
+		__m256i mask15 = _mm256_set1_epi32(15);
+		__m256i m16 = _mm256_set1_epi32(16);
+		__m256i inv_b = _mm256_set1_epi32(kargs.texturefracx);
+		__m256i b = _mm256_sub_epi32(m16, inv_b);
+		__m256i zero = _mm256_setzero_si256();
+
+		short l = (short)kargs.light;
+		__m256i mlight = _mm256_set_epi16(256, l, l, l, 256, l, l, l, 256, l, l, l, 256, l, l, l);
+		__m256i m127 = _mm256_set1_epi16(127);
+		__m256i m255 = _mm256_set1_epi16(255);
+		__m256i alpha = _mm256_set1_epi32(0xff000000);
+
+		uint32_t *dest = kargs.dest;
+		int pitch = kargs.pitch;
+		int avxcount = kargs.count / 8;
+		for (int index = 0; index < avxcount; index++)
+		{
+			__m256i lo, hi;
+			if (source2 == nullptr)
+			{
+				__m256i sample_index = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(frac, FRACBITS), height), FRACBITS);
+				__m256i texels = _mm256_i32gather_epi32(source, sample_index, 4);
+				lo = _mm256_unpacklo_epi8(texels, zero);
+				hi = _mm256_unpackhi_epi8(texels, zero);
+			}
+			else
+			{
+				__m256i frac_y1 = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(frac, vone), FRACBITS), height);
+				__m256i y0 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(frac, FRACBITS), height), FRACBITS);
+				__m256i y1 = _mm256_srli_epi32(frac_y1, FRACBITS);
+
+				__m256i p00 = _mm256_i32gather_epi32(source, y0, 4);
+				__m256i p01 = _mm256_i32gather_epi32(source, y1, 4);
+				__m256i p10 = _mm256_i32gather_epi32(source2, y0, 4);
+				__m256i p11 = _mm256_i32gather_epi32(source2, y1, 4);
+
+				__m256i inv_a = _mm256_and_si256(_mm256_srli_epi32(frac_y1, FRACBITS - 4), mask15);
+				__m256i a = _mm256_sub_epi32(m16, inv_a);
+
+				__m256i w00lo, w00hi, w01lo, w01hi, w10lo, w10hi, w11lo, w11hi;
+				SplitWallWeightsAVX2(_mm256_mullo_epi32(a, b), w00lo, w00hi);
+				SplitWallWeightsAVX2(_mm256_mullo_epi32(inv_a, b), w01lo, w01hi);
+				SplitWallWeightsAVX2(_mm256_mullo_epi32(a, inv_b), w10lo, w10hi);
+				SplitWallWeightsAVX2(_mm256_mullo_epi32(inv_a, inv_b), w11lo, w11hi);
+
+				lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(p00, zero), w00lo);
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p01, zero), w01lo));
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p10, zero), w10lo));
+				lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_unpacklo_epi8(p11, zero), w11lo));
+				lo = _mm256_srli_epi16(_mm256_add_epi16(lo, m127), 8);
+
+				hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(p00, zero), w00hi);
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p01, zero), w01hi));
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p10, zero), w10hi));
+				hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_unpackhi_epi8(p11, zero), w11hi));
+				hi = _mm256_srli_epi16(_mm256_add_epi16(hi, m127), 8);
+			}
+
+			lo = _mm256_min_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(lo, mlight), 8), m255);
+			hi = _mm256_min_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(hi, mlight), 8), m255);
+			__m256i outcolor = _mm256_or_si256(_mm256_packus_epi16(lo, hi), alpha);
+
+			// The column is not contiguous in memory, so the pixels are written one by one.
+			uint32_t pixels[8];
+			_mm256_storeu_si256((__m256i*)pixels, outcolor);
+			for (int i = 0; i < 8; i++)
+			{
+				*dest = pixels[i];
+				dest += pitch;
+			}
+
+			frac = _mm256_add_epi32(frac, fracstep);
+		}
+
+		int done = avxcount * 8;
+		if (done != kargs.count)
+		{
+			WallKernelArgs rest = kargs;
+			rest.dest += done * pitch;
+			rest.count -= done;
+			rest.frac += done * kargs.fracstep;
+			DrawOpaqueWallKernel(rest);
+		}
+	}
+
+	void DrawWall32AVX2Command::Execute(DrawerThread *thread)
+	{
+		auto shade_constants = args.ColormapConstants();
+		if (!shade_constants.simple_shade || args.dc_num_lights != 0)
+		{
+			DrawWall32Command::Execute(thread);
+			return;
+		}
+
+		int dest_y = args.DestY();
+		int count = thread->count_for_thread(dest_y, args.Count());
+		if (count <= 0) return;
+
+		int pitch = args.Viewport()->RenderTarget->GetPitch();
+
+		WallKernelArgs kargs;
+		kargs.source = (const uint32_t*)args.TexturePixels();
+		kargs.source2 = (const uint32_t*)args.TexturePixels2();
+		kargs.textureheight = args.TextureHeight();
+		kargs.texturefracx = args.TextureUPos();
+		kargs.fracstep = args.TextureVStep();
+		kargs.frac = args.TextureVPos() + thread->skipped_by_thread(dest_y) * kargs.fracstep;
+		kargs.fracstep *= thread->num_cores;
+		kargs.dest = thread->dest_for_thread(dest_y, pitch, (uint32_t*)args.Dest());
+		kargs.pitch = pitch * thread->num_cores;
+		kargs.count = count;
+		kargs.light = 256 - (args.Light() >> (FRACBITS - 8));
+
+		if (kargs.source2 != nullptr)
+		{
+			kargs.frac -= WallTexelStep(kargs.textureheight) / 2;
+		}
+
+		DrawOpaqueWallKernelAVX2(kargs);
+	}
+
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+**  AVX2 drawer commands for walls
+**  Copyright (c) 2016 Magnus Norddahl
+**
+**  This software is provided 'as-is', without any express or implied
+**  warranty.  In no event will the authors be held liable for any damages
+**  arising from the use of this software.
+**
+**  Permission is granted to anyone to use this software for any purpose,
+**  including commercial applications, and to alter it and redistribute it
+**  freely, subject to the following restrictions:
+**
+**  1. The origin of this software must not be misrepresented; you must not
+**     claim that you wrote the original software. If you use this software
+**     in a product, an acknowledgment in the product documentation would be
+**     appreciated but is not required.
+**  2. Altered source versions must be plainly marked as such, and must not be
+**     misrepresented as being the original software.
+**  3. This notice may not be removed or altered from any source distribution.
+**
+*/
+
+#pragma once
+
+#include "swrenderer/drawers/r_draw_rgba.h"
+#include "swrenderer/drawers/r_draw_span32_avx2.h"
+#include "swrenderer/viewport/r_walldrawer.h"
+#ifdef NO_SSE
+#include "swrenderer/drawers/r_draw_wall32.h"
+#else
+#include "swrenderer/drawers/r_draw_wall32_sse2.h"
+#endif
+
+namespace swrenderer
+{
+	// Plain description of the part of an opaque, unlit, simple shaded wall
+	// column that this thread draws.
+	struct WallKernelArgs
+	{
+		uint32_t *dest;
+		int pitch;
+		int count;
+		const uint32_t *source;
+		const uint32_t *source2;	// next column for linear filtering, nullptr for nearest
+		uint32_t textureheight;
+		uint32_t frac;
+		uint32_t fracstep;
+		uint32_t texturefracx;
+		int light;
+	};
+
+	// Reference version, also used for the pixels left over by the AVX2 loop.
+	void DrawOpaqueWallKernel(const WallKernelArgs &kargs);
+
+#ifdef HAVE_AVX2_DRAWERS
+	void DrawOpaqueWallKernelAVX2(const WallKernelArgs &kargs);
+
+	// Opaque wall drawer that takes the AVX2 kernel whenever the column can be
+	// drawn by it and otherwise leaves the work to the regular drawer.
+	class DrawWall32AVX2Command : public DrawWall32Command
+	{
+	public:
+		DrawWall32AVX2Command(const WallDrawerArgs &drawerargs) : DrawWall32Command(drawerargs) { }
+
+		void Execute(DrawerThread *thread) override;
+	};
+#endif
+}
@@ -6,6 +6,8 @@
 #include "drawers/r_draw.cpp"
 #include "drawers/r_draw_pal.cpp"
 #include "drawers/r_draw_rgba.cpp"
+#include "drawers/r_draw_span32_avx2.cpp"
+#include "drawers/r_draw_wall32_avx2.cpp"
 #include "drawers/r_thread.cpp"
 #include "line/r_fogboundary.cpp"
 #include "line/r_line.cpp"
@@ -50,6 +50,9 @@
 #include "polyrenderer/poly_renderer.h"
 #include "p_setup.h"
 #include "g_levellocals.h"
+#include "w_wad.h"
+#include "stats.h"
+#include "parallel_for.h"
 
 // [BB] Use ZDoom's freelook limit for the software renderer.
 // Note: ZDoom's limit is chosen such that the sky is rendered properly.
@@ -62,6 +65,7 @@ CUSTOM_CVAR (Bool, cl_oldfreelooklimit, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG
 EXTERN_CVAR(Bool, r_shadercolormaps)
 EXTERN_CVAR(Float, maxviewpitch)	// [SP] CVAR from OpenGL Renderer
 EXTERN_CVAR(Bool, r_drawvoxels)
+EXTERN_CVAR(Bool, r_precache_multithread)
 
 CUSTOM_CVAR(Bool, r_polyrenderer, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
@@ -163,11 +167,42 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	}
 	delete[] spritelist;
 
+	cycle_t decoding, precache;
+	decoding.Reset();
+	precache.Reset();
+
 	int cnt = TexMan.NumTextures();
+	if (r_precache_multithread)
+	{
+		// Decode all textures that only depend on their own lump in parallel.
+		// The serial pass below will then find their pixels already present.
+		TArray<int> jobs;
+		for (int i = cnt - 1; i >= 0; i--)
+		{
+			FTexture *tex = TexMan.ByIndex(i);
+			if (tex != nullptr && texhitlist[i] != 0 && tex->IsStandalone())
+			{
+				jobs.Push(i);
+			}
+		}
+
+		decoding.Clock();
+		parallel_for(int(jobs.Size()), [&](int job)
+		{
+			FThreadedLumpAccess threaded;
+			PrecacheTexture(TexMan.ByIndex(jobs[job]), texhitlist[jobs[job]]);
+		});
+		decoding.Unclock();
+		DPrintf(DMSG_NOTIFY, "%u textures decoded in %.3f ms\n", jobs.Size(), decoding.TimeMS());
+	}
+
+	precache.Clock();
 	for (int i = cnt - 1; i >= 0; i--)
 	{
 		PrecacheTexture(TexMan.ByIndex(i), texhitlist[i]);
 	}
+	precache.Unclock();
+	DPrintf(DMSG_NOTIFY, "Textures precached in %.3f ms\n", decoding.TimeMS() + precache.TimeMS());
 }
 
 void FSoftwareRenderer::RenderView(player_t *player)
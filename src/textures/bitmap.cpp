@@ -37,6 +37,14 @@
 #include "r_data/r_translate.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "v_text.h"
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 
 //===========================================================================
@@ -214,6 +222,172 @@ static const CopyFunc copyfuncs[][11]={
 };
 #undef COPY_FUNCS
 
+//===========================================================================
+//
+// SSE2 versions of the copy operations that composite textures and
+// translations use the most: plain copies, overwrites and alpha blended
+// copies without a color blend. They do the same integer math as the
+// templates and produce the same pixels, 4 at a time.
+//
+//===========================================================================
+
+CVAR(Bool, r_fasttexturecopy, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+#ifndef NO_SSE
+static inline __m128i LoadPixel4(const uint8_t *pin, int step)
+{
+	if (step == 4)
+	{
+		return _mm_loadu_si128((const __m128i *)pin);
+	}
+	uint32_t p[4];
+	for (int i = 0; i < 4; i++)
+	{
+		memcpy(&p[i], pin + i * step, 4);
+	}
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+// Exact for the products of two bytes, i.e. values up to 255*255.
+static inline __m128i Div255(__m128i v)
+{
+	v = _mm_add_epi16(v, _mm_add_epi16(_mm_srli_epi16(v, 8), _mm_set1_epi16(1)));
+	return _mm_srli_epi16(v, 8);
+}
+
+// Combines 4 BGRA source pixels with the destination like bOverwrite,
+// bCopy and bCopyAlpha do.
+template<int op>
+static inline __m128i CombinePixels(__m128i s, __m128i d)
+{
+	if (op == OP_OVERWRITE)
+	{
+		return s;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(int(0xff000000));
+	__m128i alpha0 = _mm_cmpeq_epi32(_mm_and_si128(s, amask), zero);
+
+	if (op == OP_COPYALPHA)
+	{
+		const __m128i c255 = _mm_set1_epi16(255);
+		__m128i slo = _mm_unpacklo_epi8(s, zero);
+		__m128i shi = _mm_unpackhi_epi8(s, zero);
+		__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(slo, alo), _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, alo)));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(shi, ahi), _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, ahi)));
+		__m128i blended = _mm_packus_epi16(Div255(lo), Div255(hi));
+		// The alpha channel is copied, not blended.
+		s = _mm_or_si128(_mm_andnot_si128(amask, blended), _mm_and_si128(amask, s));
+	}
+	return _mm_or_si128(_mm_and_si128(alpha0, d), _mm_andnot_si128(alpha0, s));
+}
+
+template<int op, bool rgba>
+void iCopyColorsSSE2(uint8_t *pout, const uint8_t *pin, int count, int step, FCopyInfo *inf,
+	uint8_t tr, uint8_t tg, uint8_t tb)
+{
+	const __m128i rbmask = _mm_set1_epi32(0xff);
+	const __m128i gamask = _mm_set1_epi32(int(0xff00ff00));
+	int i = 0;
+
+	while (i < count)
+	{
+		int n = MIN(count - i, 4);
+		__m128i s, d;
+		uint32_t tail[4];
+
+		if (n == 4)
+		{
+			s = LoadPixel4(pin, step);
+			d = _mm_loadu_si128((const __m128i *)pout);
+		}
+		else
+		{
+			memset(tail, 0, sizeof(tail));
+			for (int j = 0; j < n; j++) memcpy(&tail[j], pin + j * step, 4);
+			s = _mm_loadu_si128((const __m128i *)tail);
+			memcpy(tail, pout, n * 4);
+			d = _mm_loadu_si128((const __m128i *)tail);
+		}
+		if (rgba)
+		{
+			// swap red and blue
+			s = _mm_or_si128(_mm_and_si128(s, gamask),
+				_mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 16), rbmask), _mm_slli_epi32(_mm_and_si128(s, rbmask), 16)));
+		}
+		__m128i result = CombinePixels<op>(s, d);
+		if (n == 4)
+		{
+			_mm_storeu_si128((__m128i *)pout, result);
+		}
+		else
+		{
+			_mm_storeu_si128((__m128i *)tail, result);
+			memcpy(pout, tail, n * 4);
+		}
+		pout += 16;
+		pin += 4 * step;
+		i += 4;
+	}
+}
+
+template<int op>
+void iCopyPalettedSSE2(uint8_t *buffer, const uint8_t * patch, int srcwidth, int srcheight, int Pitch,
+					int step_x, int step_y, int rotate, PalEntry * palette, FCopyInfo *inf)
+{
+	for (int y = 0; y < srcheight; y++)
+	{
+		uint8_t *pout = buffer + y * Pitch;
+		const uint8_t *pin = patch + y * step_y;
+		int x = 0;
+
+		for (; x + 4 <= srcwidth; x += 4, pin += 4 * step_x, pout += 16)
+		{
+			__m128i s = _mm_set_epi32(palette[pin[3 * step_x]].d, palette[pin[2 * step_x]].d, palette[pin[step_x]].d, palette[pin[0]].d);
+			__m128i d = op == OP_OVERWRITE ? s : _mm_loadu_si128((const __m128i *)pout);
+			_mm_storeu_si128((__m128i *)pout, CombinePixels<op>(s, d));
+		}
+		if (x < srcwidth)
+		{
+			int n = srcwidth - x;
+			uint32_t src[4] = { 0, 0, 0, 0 }, dst[4];
+			for (int j = 0; j < n; j++) src[j] = palette[pin[j * step_x]].d;
+			memcpy(dst, pout, n * 4);
+			__m128i result = CombinePixels<op>(_mm_loadu_si128((const __m128i *)src), _mm_loadu_si128((const __m128i *)dst));
+			_mm_storeu_si128((__m128i *)dst, result);
+			memcpy(pout, dst, n * 4);
+		}
+	}
+}
+
+#endif
+
+//===========================================================================
+//
+// Picks the copy function for a row of true color pixels
+//
+//===========================================================================
+
+static CopyFunc GetCopyFunc(int op, int ct, FCopyInfo *inf)
+{
+#ifndef NO_SSE
+	if (r_fasttexturecopy && (inf == NULL || inf->blend == BLEND_NONE) && (ct == CF_BGRA || ct == CF_RGBA))
+	{
+		bool rgba = ct == CF_RGBA;
+		switch (op)
+		{
+		case OP_COPY:		return rgba ? iCopyColorsSSE2<OP_COPY, true> : iCopyColorsSSE2<OP_COPY, false>;
+		case OP_COPYALPHA:	return rgba ? iCopyColorsSSE2<OP_COPYALPHA, true> : iCopyColorsSSE2<OP_COPYALPHA, false>;
+		case OP_OVERWRITE:	return rgba ? iCopyColorsSSE2<OP_OVERWRITE, true> : iCopyColorsSSE2<OP_OVERWRITE, false>;
+		default:			break;
+		}
+	}
+#endif
+	return copyfuncs[op][ct];
+}
+
 //===========================================================================
 //
 // Clips the copy area for CopyPixelData functions
@@ -380,9 +554,10 @@ void FBitmap::CopyPixelDataRGB(int originx, int originy, const uint8_t *patch, i
 	{
 		uint8_t *buffer = data + 4 * originx + Pitch * originy;
 		int op = inf==NULL? OP_COPY : inf->op;
+		CopyFunc copyfunc = GetCopyFunc(op, ct, inf);
 		for (int y=0;y<srcheight;y++)
 		{
-			copyfuncs[op][ct](&buffer[y*Pitch], &patch[y*step_y], srcwidth, step_x, inf, r, g, b);
+			copyfunc(&buffer[y*Pitch], &patch[y*step_y], srcwidth, step_x, inf, r, g, b);
 		}
 	}
 }
@@ -431,6 +606,30 @@ static const CopyPalettedFunc copypalettedfuncs[]=
 	iCopyPaletted<cBGRA, bOverwrite>
 };
 
+//===========================================================================
+//
+// Picks the copy function for paletted pixels. The palette already
+// contains the blend at this point, so only the operation matters.
+//
+//===========================================================================
+
+static CopyPalettedFunc GetCopyPalettedFunc(int op)
+{
+#ifndef NO_SSE
+	if (r_fasttexturecopy)
+	{
+		switch (op)
+		{
+		case OP_COPY:		return iCopyPalettedSSE2<OP_COPY>;
+		case OP_COPYALPHA:	return iCopyPalettedSSE2<OP_COPYALPHA>;
+		case OP_OVERWRITE:	return iCopyPalettedSSE2<OP_OVERWRITE>;
+		default:			break;
+		}
+	}
+#endif
+	return copypalettedfuncs[op];
+}
+
 //===========================================================================
 //
 // Paletted to True Color texture copy function
@@ -458,7 +657,7 @@ void FBitmap::CopyPixelData(int originx, int originy, const uint8_t * patch, int
 			}
 		}
 
-		copypalettedfuncs[inf==NULL? OP_COPY : inf->op](buffer, patch, srcwidth, srcheight, Pitch, 
+		GetCopyPalettedFunc(inf==NULL? OP_COPY : inf->op)(buffer, patch, srcwidth, srcheight, Pitch, 
 														step_x, step_y, rotate, palette, inf);
 	}
 }
@@ -477,3 +676,193 @@ void FBitmap::Zero()
 		buffer += Pitch;
 	}
 }
+
+//===========================================================================
+//
+// Times the generic and the SSE2 copy functions on a synthetic patch and
+// checks that they produce the same pixels.
+//
+//===========================================================================
+
+CCMD(bench_texcopy)
+{
+	const int width = 256, height = 128;
+	int iterations = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 200;
+
+	PalEntry palette[256];
+	TArray<uint8_t> patch(width * height, true);
+	TArray<uint8_t> truecolor(width * height * 4, true);
+	TArray<uint8_t> background(width * height * 4, true);
+	TArray<uint8_t> reference(width * height * 4, true);
+	TArray<uint8_t> result(width * height * 4, true);
+
+	uint32_t seed = 0x12345678;
+	auto rand32 = [&]() { seed = seed * 1664525 + 1013904223; return seed; };
+	for (int i = 0; i < 256; i++)
+	{
+		// Mix opaque, transparent and translucent colors.
+		uint32_t c = rand32();
+		int alpha = (i & 3) == 0 ? 0 : (i & 3) == 1 ? (c >> 24) : 255;
+		palette[i] = (c & 0xffffff) | (alpha << 24);
+	}
+	for (auto &p : patch) p = uint8_t(rand32() >> 24);
+	for (unsigned i = 0; i < truecolor.Size(); i += 4)
+	{
+		memcpy(&truecolor[i], &palette[patch[i / 4]], 4);
+	}
+	for (auto &p : background) p = uint8_t(rand32() >> 24);
+
+	static const struct { ECopyOp op; const char *name; } ops[] = { { OP_COPY, "copy" }, { OP_COPYALPHA, "copyalpha" }, { OP_OVERWRITE, "overwrite" } };
+	static const char *const sources[] = { "paletted columns", "paletted rows", "BGRA", "RGBA" };
+
+	bool saved = r_fasttexturecopy;
+	for (auto &op : ops)
+	{
+		for (int source = 0; source < 4; source++)
+		{
+			FCopyInfo inf;
+			memset(&inf, 0, sizeof(inf));
+			inf.op = op.op;
+			inf.alpha = BLENDUNIT;
+
+			cycle_t reftime, fasttime;
+			reftime.Reset();
+			fasttime.Reset();
+
+			for (int pass = 0; pass < 2; pass++)
+			{
+				bool fast = pass == 1;
+				TArray<uint8_t> &out = fast ? result : reference;
+				cycle_t &time = fast ? fasttime : reftime;
+
+				r_fasttexturecopy = fast;
+				for (int i = 0; i < iterations; i++)
+				{
+					memcpy(out.Data(), background.Data(), out.Size());
+					FBitmap bmp(out.Data(), width * 4, width, height);
+					time.Clock();
+					switch (source)
+					{
+					case 0:	bmp.CopyPixelData(0, 0, patch.Data(), width, height, height, 1, 0, palette, &inf); break;
+					case 1: bmp.CopyPixelData(0, 0, patch.Data(), width, height, 1, width, 0, palette, &inf); break;
+					case 2: bmp.CopyPixelDataRGB(0, 0, truecolor.Data(), width, height, 4, width * 4, 0, CF_BGRA, &inf); break;
+					case 3: bmp.CopyPixelDataRGB(0, 0, truecolor.Data(), width, height, 4, width * 4, 0, CF_RGBA, &inf); break;
+					}
+					time.Unclock();
+				}
+			}
+			r_fasttexturecopy = saved;
+
+			double pixels = double(width) * height * iterations;
+			Printf("%s, %s: generic %.1f Mpixels/s", op.name, sources[source], pixels / reftime.TimeMS() / 1000.);
+#ifndef NO_SSE
+			bool match = memcmp(reference.Data(), result.Data(), result.Size()) == 0;
+			Printf(", SSE2 %.1f Mpixels/s (%.2fx)%s", pixels / fasttime.TimeMS() / 1000.,
+				reftime.TimeMS() / fasttime.TimeMS(), match ? "" : TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL);
+#endif
+			Printf("\n");
+		}
+	}
+}
+
+//===========================================================================
+//
+// Copies random patches with every rotation, random clipping and odd
+// sizes with the generic and the SSE2 copy functions, and checks that
+// both produce the same pixels and stay inside the clip rectangle.
+//
+//===========================================================================
+
+CCMD(test_texcopy)
+{
+	const int maxsize = 67, guard = 64;
+	int rounds = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 10000;
+
+	uint32_t seed = argv.argc() > 2 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 0x9e3779b9;
+	auto rand32 = [&]() { seed = seed * 1664525 + 1013904223; return seed >> 8; };
+	auto randrange = [&](int lo, int hi) { return lo + int(rand32() % unsigned(hi - lo + 1)); };
+
+	static const ECopyOp ops[] = { OP_COPY, OP_COPYALPHA, OP_OVERWRITE, OP_BLEND };
+	static const char *const sources[] = { "paletted columns", "paletted rows", "BGRA", "RGBA" };
+
+	PalEntry palette[256];
+	TArray<uint8_t> patch(maxsize * maxsize, true);
+	TArray<uint8_t> truecolor(maxsize * maxsize * 4, true);
+	TArray<uint8_t> background(maxsize * maxsize * 4 + guard, true);
+	TArray<uint8_t> reference(background.Size(), true);
+	TArray<uint8_t> result(background.Size(), true);
+
+	bool saved = r_fasttexturecopy;
+	int failures = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			int alpha = (i & 3) == 0 ? 0 : (i & 3) == 1 ? randrange(0, 255) : 255;
+			palette[i] = (rand32() & 0xffffff) | (alpha << 24);
+		}
+		int width = randrange(1, maxsize), height = randrange(1, maxsize);
+		int srcwidth = randrange(1, maxsize), srcheight = randrange(1, maxsize);
+		int originx = randrange(-srcwidth, width), originy = randrange(-srcheight, height);
+		int rotate = randrange(0, 7);
+		int source = randrange(0, 3);
+		FClipRect clip = { randrange(-4, width), randrange(-4, height), randrange(0, width + 4), randrange(0, height + 4) };
+
+		for (int i = 0; i < srcwidth * srcheight; i++)
+		{
+			patch[i] = uint8_t(rand32());
+			// Odd translucent alpha values in true color sources, too.
+			memcpy(&truecolor[i * 4], &palette[patch[i]], 4);
+			if (patch[i] & 1) truecolor[i * 4 + 3] = uint8_t(rand32());
+		}
+		for (auto &p : background) p = uint8_t(rand32());
+
+		FCopyInfo inf;
+		memset(&inf, 0, sizeof(inf));
+		inf.op = ops[randrange(0, countof(ops) - 1)];
+		inf.alpha = BLENDUNIT;
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			TArray<uint8_t> &out = pass == 1 ? result : reference;
+			memcpy(out.Data(), background.Data(), out.Size());
+			FBitmap bmp(out.Data(), width * 4, width, height);
+			bmp.IntersectClipRect(clip);
+
+			r_fasttexturecopy = pass == 1;
+			switch (source)
+			{
+			case 0: bmp.CopyPixelData(originx, originy, patch.Data(), srcwidth, srcheight, srcheight, 1, rotate, palette, &inf); break;
+			case 1: bmp.CopyPixelData(originx, originy, patch.Data(), srcwidth, srcheight, 1, srcwidth, rotate, palette, &inf); break;
+			case 2: bmp.CopyPixelDataRGB(originx, originy, truecolor.Data(), srcwidth, srcheight, 4, srcwidth * 4, rotate, CF_BGRA, &inf); break;
+			case 3: bmp.CopyPixelDataRGB(originx, originy, truecolor.Data(), srcwidth, srcheight, 4, srcwidth * 4, rotate, CF_RGBA, &inf); break;
+			}
+		}
+		r_fasttexturecopy = saved;
+
+		// Nothing outside the bitmap's clip rectangle may change.
+		FBitmap clipped(background.Data(), width * 4, width, height);
+		clipped.IntersectClipRect(clip);
+		const FClipRect &cr = clipped.GetClipRect();
+		bool inside = memcmp(&result[width * height * 4], &background[width * height * 4], guard) == 0;
+		for (int y = 0; y < height && inside; y++)
+		{
+			for (int x = 0; x < width && inside; x++)
+			{
+				if (x >= cr.x && x < cr.x + cr.width && y >= cr.y && y < cr.y + cr.height) continue;
+				inside = memcmp(&result[(y * width + x) * 4], &background[(y * width + x) * 4], 4) == 0;
+			}
+		}
+
+		if (!inside || memcmp(reference.Data(), result.Data(), result.Size()) != 0)
+		{
+			if (failures++ < 10)
+			{
+				Printf(TEXTCOLOR_RED "Round %d: op %d, %s, %dx%d to %dx%d at %d,%d, rotate %d, clip %d,%d %dx%d: %s\n",
+					round, inf.op, sources[source], srcwidth, srcheight, width, height, originx, originy, rotate,
+					clip.x, clip.y, clip.width, clip.height, inside ? "pixels differ" : "wrote outside the clip rectangle");
+			}
+		}
+	}
+	Printf("%d of %d random copies differ\n", failures, rounds);
+}
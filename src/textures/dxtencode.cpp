@@ -0,0 +1,712 @@
+/*
+** dxtencode.cpp
+** S3TC (DXT1/DXT5) texture compression
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 LZDoom07 contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The color endpoints are fitted along the principal axis of each block and
+** then refined by least squares. This is slower than a plain bounding box
+** fit but the result gets stored in the texture cache, so it is only done
+** once per texture.
+**
+** The palettes are derived exactly like FDDSTexture decodes them.
+**
+*/
+
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+
+#include "dxtencode.h"
+#include "bitmap.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "textures/textures.h"
+
+struct FColorBlock
+{
+	int rgb[16][3];
+	bool skip[16];		// transparent pixel of a DXT1A block, always gets index 3
+	int active;			// number of pixels that are not skipped
+};
+
+struct FColorFit
+{
+	uint16_t c0, c1;
+	uint32_t indices;
+	bool threecolor;
+	int error;
+};
+
+//==========================================================================
+//
+// 565 color conversion
+//
+//==========================================================================
+
+static inline uint16_t PackColor(int r, int g, int b)
+{
+	return uint16_t((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+static inline void UnpackColor(uint16_t c, int *rgb)
+{
+	rgb[0] = ((c & 0xF800) >> 8) | (c >> 13);
+	rgb[1] = ((c & 0x07E0) >> 3) | ((c & 0x0600) >> 9);
+	rgb[2] = ((c & 0x001F) << 3) | ((c & 0x001C) >> 2);
+}
+
+static void BuildColorPalette(uint16_t c0, uint16_t c1, bool threecolor, int pal[4][3])
+{
+	UnpackColor(c0, pal[0]);
+	UnpackColor(c1, pal[1]);
+	for (int i = 0; i < 3; i++)
+	{
+		if (!threecolor)
+		{
+			pal[2][i] = (pal[0][i] + pal[0][i] + pal[1][i] + 1) / 3;
+			pal[3][i] = (pal[0][i] + pal[1][i] + pal[1][i] + 1) / 3;
+		}
+		else
+		{
+			pal[2][i] = (pal[0][i] + pal[1][i]) / 2;
+			pal[3][i] = 0;
+		}
+	}
+}
+
+static void BuildAlphaPalette(int a0, int a1, int pal[8])
+{
+	pal[0] = a0;
+	pal[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 0; i < 6; i++) pal[i + 2] = ((6 - i) * a0 + (i + 1) * a1 + 3) / 7;
+	}
+	else
+	{
+		for (int i = 0; i < 4; i++) pal[i + 2] = ((4 - i) * a0 + (i + 1) * a1 + 2) / 5;
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+}
+
+//==========================================================================
+//
+// EvaluateFit
+//
+// Assigns every pixel the closest palette entry of the given endpoints and
+// keeps the result if it beats the best fit so far. DXT1 selects the mode
+// by the order of the endpoints.
+//
+//==========================================================================
+
+static void EvaluateFit(const FColorBlock &blk, uint16_t c0, uint16_t c1, bool threecolor, bool dxt5, FColorFit &best)
+{
+	// DXT5 always decodes four colors, but keeping the DXT1 order does not hurt.
+	if (threecolor ? c0 > c1 : c0 < c1) std::swap(c0, c1);
+	if (c0 == c1 && !dxt5) threecolor = true;
+
+	int pal[4][3];
+	BuildColorPalette(c0, c1, threecolor, pal);
+	int usable = threecolor ? 3 : 4;
+
+	uint32_t indices = 0;
+	int error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int index = 3;
+		if (!blk.skip[i])
+		{
+			int besterr = INT_MAX;
+			for (int j = 0; j < usable; j++)
+			{
+				int dr = blk.rgb[i][0] - pal[j][0];
+				int dg = blk.rgb[i][1] - pal[j][1];
+				int db = blk.rgb[i][2] - pal[j][2];
+				int err = dr * dr + dg * dg + db * db;
+				if (err < besterr)
+				{
+					besterr = err;
+					index = j;
+				}
+			}
+			error += besterr;
+		}
+		indices |= uint32_t(index) << (i * 2);
+	}
+	if (error < best.error)
+	{
+		best.c0 = c0;
+		best.c1 = c1;
+		best.indices = indices;
+		best.threecolor = threecolor;
+		best.error = error;
+	}
+}
+
+//==========================================================================
+//
+// GetPrincipalEndpoints
+//
+// Picks the two pixels that lie furthest apart along the axis of greatest
+// variance. The axis is found by power iteration on the covariance matrix.
+//
+//==========================================================================
+
+static void GetPrincipalEndpoints(const FColorBlock &blk, uint16_t &c0, uint16_t &c1)
+{
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		if (blk.skip[i]) continue;
+		for (int c = 0; c < 3; c++) mean[c] += blk.rgb[i][c];
+	}
+	for (int c = 0; c < 3; c++) mean[c] /= blk.active;
+
+	float cov[3][3] = { { 0 } };
+	for (int i = 0; i < 16; i++)
+	{
+		if (blk.skip[i]) continue;
+		float d[3] = { blk.rgb[i][0] - mean[0], blk.rgb[i][1] - mean[1], blk.rgb[i][2] - mean[2] };
+		for (int a = 0; a < 3; a++)
+		{
+			for (int b = a; b < 3; b++) cov[a][b] += d[a] * d[b];
+		}
+	}
+	cov[1][0] = cov[0][1];
+	cov[2][0] = cov[0][2];
+	cov[2][1] = cov[1][2];
+
+	// Starting with the column of the largest variance cannot end up in the null space.
+	int start = cov[1][1] > cov[0][0] ? 1 : 0;
+	if (cov[2][2] > cov[start][start]) start = 2;
+	float axis[3] = { cov[0][start], cov[1][start], cov[2][start] };
+
+	for (int iter = 0; iter < 8; iter++)
+	{
+		float next[3];
+		for (int a = 0; a < 3; a++) next[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1] + cov[a][2] * axis[2];
+		float norm = MAX(MAX(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+		if (norm == 0) break;
+		for (int a = 0; a < 3; a++) axis[a] = next[a] / norm;
+	}
+
+	int minpix = -1, maxpix = -1;
+	float mindot = 0, maxdot = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (blk.skip[i]) continue;
+		float dot = blk.rgb[i][0] * axis[0] + blk.rgb[i][1] * axis[1] + blk.rgb[i][2] * axis[2];
+		if (minpix < 0 || dot < mindot) mindot = dot, minpix = i;
+		if (maxpix < 0 || dot > maxdot) maxdot = dot, maxpix = i;
+	}
+	c0 = PackColor(blk.rgb[maxpix][0], blk.rgb[maxpix][1], blk.rgb[maxpix][2]);
+	c1 = PackColor(blk.rgb[minpix][0], blk.rgb[minpix][1], blk.rgb[minpix][2]);
+}
+
+//==========================================================================
+//
+// RefineEndpoints
+//
+// Solves for the endpoints that minimize the error of the current index
+// assignment.
+//
+//==========================================================================
+
+static bool RefineEndpoints(const FColorBlock &blk, const FColorFit &fit, uint16_t &c0, uint16_t &c1)
+{
+	// Weight of c0 for every index
+	static const float weights4[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+	static const float weights3[4] = { 1.f, 0.f, 0.5f, 0.f };
+	const float *weights = fit.threecolor ? weights3 : weights4;
+
+	float aa = 0, bb = 0, ab = 0;
+	float ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (fit.indices >> (i * 2)) & 3;
+		if (blk.skip[i] || (fit.threecolor && index == 3)) continue;
+
+		float a = weights[index], b = 1.f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += a * blk.rgb[i][c];
+			bx[c] += b * blk.rgb[i][c];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-4f) return false;
+
+	int e0[3], e1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		e0[c] = clamp<int>(int((ax[c] * bb - bx[c] * ab) / det + 0.5f), 0, 255);
+		e1[c] = clamp<int>(int((bx[c] * aa - ax[c] * ab) / det + 0.5f), 0, 255);
+	}
+	c0 = PackColor(e0[0], e0[1], e0[2]);
+	c1 = PackColor(e1[0], e1[1], e1[2]);
+	return true;
+}
+
+//==========================================================================
+//
+// GetSingleColorEndpoints
+//
+// A block of a single color is better served by a pair of endpoints whose
+// interpolated value hits the color than by the rounded color itself.
+//
+//==========================================================================
+
+struct FSingleColorTables
+{
+	uint8_t match5[256][2];
+	uint8_t match6[256][2];
+
+	FSingleColorTables()
+	{
+		Build(match5, 5);
+		Build(match6, 6);
+	}
+
+	static void Build(uint8_t table[256][2], int bits)
+	{
+		int count = 1 << bits;
+		for (int v = 0; v < 256; v++)
+		{
+			int besterr = INT_MAX;
+			for (int e0 = 0; e0 < count; e0++)
+			{
+				for (int e1 = 0; e1 < count; e1++)
+				{
+					int x0 = bits == 5 ? (e0 << 3) | (e0 >> 2) : (e0 << 2) | (e0 >> 4);
+					int x1 = bits == 5 ? (e1 << 3) | (e1 >> 2) : (e1 << 2) | (e1 >> 4);
+					int err = abs((x0 + x0 + x1 + 1) / 3 - v);
+					if (err < besterr)
+					{
+						besterr = err;
+						table[v][0] = uint8_t(e0);
+						table[v][1] = uint8_t(e1);
+					}
+				}
+			}
+		}
+	}
+};
+
+static void GetSingleColorEndpoints(const int *rgb, uint16_t &c0, uint16_t &c1)
+{
+	static const FSingleColorTables tables;
+	c0 = uint16_t((tables.match5[rgb[0]][0] << 11) | (tables.match6[rgb[1]][0] << 5) | tables.match5[rgb[2]][0]);
+	c1 = uint16_t((tables.match5[rgb[0]][1] << 11) | (tables.match6[rgb[1]][1] << 5) | tables.match5[rgb[2]][1]);
+}
+
+//==========================================================================
+//
+// CompressColorBlock
+//
+//==========================================================================
+
+static void CompressColorBlock(const FColorBlock &blk, bool dxt5, uint8_t *dest)
+{
+	FColorFit best;
+	best.error = INT_MAX;
+
+	if (blk.active == 0)
+	{
+		// Three color block with nothing but transparent pixels
+		best.c0 = best.c1 = 0;
+		best.indices = 0xffffffff;
+	}
+	else
+	{
+		// Only blocks with transparent pixels need the three color mode.
+		bool threecolor = blk.active < 16;
+		uint16_t c0, c1;
+
+		GetPrincipalEndpoints(blk, c0, c1);
+		EvaluateFit(blk, c0, c1, threecolor, dxt5, best);
+		for (int pass = 0; pass < 2 && best.error > 0; pass++)
+		{
+			int lasterror = best.error;
+			if (!RefineEndpoints(blk, best, c0, c1)) break;
+			EvaluateFit(blk, c0, c1, threecolor, dxt5, best);
+			if (best.error == lasterror) break;
+		}
+
+		if (best.error > 0 && !threecolor)
+		{
+			bool single = true;
+			for (int i = 1; i < 16 && single; i++)
+			{
+				single = blk.rgb[i][0] == blk.rgb[0][0] && blk.rgb[i][1] == blk.rgb[0][1] && blk.rgb[i][2] == blk.rgb[0][2];
+			}
+			if (single)
+			{
+				GetSingleColorEndpoints(blk.rgb[0], c0, c1);
+				EvaluateFit(blk, c0, c1, false, dxt5, best);
+			}
+		}
+	}
+
+	dest[0] = uint8_t(best.c0);
+	dest[1] = uint8_t(best.c0 >> 8);
+	dest[2] = uint8_t(best.c1);
+	dest[3] = uint8_t(best.c1 >> 8);
+	dest[4] = uint8_t(best.indices);
+	dest[5] = uint8_t(best.indices >> 8);
+	dest[6] = uint8_t(best.indices >> 16);
+	dest[7] = uint8_t(best.indices >> 24);
+}
+
+//==========================================================================
+//
+// CompressAlphaBlock
+//
+// Tries the 8 value mode over the full range and the 6 value mode, which
+// has exact 0 and 255, over the remaining values.
+//
+//==========================================================================
+
+static int FitAlpha(const uint8_t *alpha, int a0, int a1, uint64_t &bits)
+{
+	int pal[8];
+	BuildAlphaPalette(a0, a1, pal);
+
+	int error = 0;
+	bits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int index = 0, besterr = INT_MAX;
+		for (int j = 0; j < 8; j++)
+		{
+			int err = abs(alpha[i] - pal[j]);
+			if (err < besterr)
+			{
+				besterr = err;
+				index = j;
+			}
+		}
+		error += besterr * besterr;
+		bits |= uint64_t(index) << (i * 3);
+	}
+	return error;
+}
+
+static void CompressAlphaBlock(const uint8_t *alpha, uint8_t *dest)
+{
+	int amin = 255, amax = 0;
+	int inner_min = 255, inner_max = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		amin = MIN<int>(amin, alpha[i]);
+		amax = MAX<int>(amax, alpha[i]);
+		if (alpha[i] != 0 && alpha[i] != 255)
+		{
+			inner_min = MIN<int>(inner_min, alpha[i]);
+			inner_max = MAX<int>(inner_max, alpha[i]);
+		}
+	}
+	if (inner_min > inner_max) inner_min = inner_max = 0;
+
+	uint64_t bits8, bits6;
+	int a0 = amax, a1 = amin;
+	int error = FitAlpha(alpha, amax, amin, bits8);
+	if (error > 0 && FitAlpha(alpha, inner_min, inner_max, bits6) < error)
+	{
+		a0 = inner_min;
+		a1 = inner_max;
+		bits8 = bits6;
+	}
+
+	dest[0] = uint8_t(a0);
+	dest[1] = uint8_t(a1);
+	for (int i = 0; i < 6; i++) dest[2 + i] = uint8_t(bits8 >> (i * 8));
+}
+
+//==========================================================================
+//
+// DXT_ChooseFormat
+//
+// DXT1 for opaque images, DXT1 with 1 bit alpha for images with holes and
+// DXT5 for anything with translucency.
+//
+//==========================================================================
+
+EDXTFormat DXT_ChooseFormat(const uint8_t *bgra, int width, int height)
+{
+	EDXTFormat format = DXT_1;
+	for (int i = 0; i < width * height; i++)
+	{
+		uint8_t alpha = bgra[i * 4 + 3];
+		if (alpha == 0) format = DXT_1A;
+		else if (alpha != 255) return DXT_5;
+	}
+	return format;
+}
+
+//==========================================================================
+//
+// Sizes
+//
+//==========================================================================
+
+int DXT_LevelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = MAX(width / 2, 1);
+		height = MAX(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+unsigned DXT_LevelSize(EDXTFormat format, int width, int height)
+{
+	return unsigned((width + 3) / 4) * ((height + 3) / 4) * (format == DXT_5 ? 16 : 8);
+}
+
+unsigned DXT_ImageSize(EDXTFormat format, int width, int height, int levels)
+{
+	unsigned size = 0;
+	for (int i = 0; i < levels; i++)
+	{
+		size += DXT_LevelSize(format, width, height);
+		width = MAX(width / 2, 1);
+		height = MAX(height / 2, 1);
+	}
+	return size;
+}
+
+//==========================================================================
+//
+// DXT_CompressLevel
+//
+//==========================================================================
+
+void DXT_CompressLevel(const uint8_t *bgra, int width, int height, EDXTFormat format, uint8_t *dest)
+{
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			FColorBlock blk;
+			uint8_t alpha[16];
+
+			blk.active = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				// Blocks at the right and bottom edge repeat the last pixel.
+				int x = MIN(bx + (i & 3), width - 1);
+				int y = MIN(by + (i >> 2), height - 1);
+				const uint8_t *p = bgra + (y * width + x) * 4;
+
+				blk.rgb[i][0] = p[2];
+				blk.rgb[i][1] = p[1];
+				blk.rgb[i][2] = p[0];
+				blk.skip[i] = format == DXT_1A && p[3] < 128;
+				if (!blk.skip[i]) blk.active++;
+				alpha[i] = p[3];
+			}
+			if (format == DXT_5)
+			{
+				CompressAlphaBlock(alpha, dest);
+				dest += 8;
+			}
+			CompressColorBlock(blk, format == DXT_5, dest);
+			dest += 8;
+		}
+	}
+}
+
+//==========================================================================
+//
+// DXT_DecompressLevel
+//
+//==========================================================================
+
+void DXT_DecompressLevel(const uint8_t *src, int width, int height, EDXTFormat format, uint8_t *bgra)
+{
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			int alphapal[8];
+			uint64_t alphabits = 0;
+			if (format == DXT_5)
+			{
+				BuildAlphaPalette(src[0], src[1], alphapal);
+				for (int i = 0; i < 6; i++) alphabits |= uint64_t(src[2 + i]) << (i * 8);
+				src += 8;
+			}
+
+			uint16_t c0 = src[0] | (src[1] << 8);
+			uint16_t c1 = src[2] | (src[3] << 8);
+			uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | (uint32_t(src[7]) << 24);
+			bool threecolor = format != DXT_5 && c0 <= c1;
+			int pal[4][3];
+			BuildColorPalette(c0, c1, threecolor, pal);
+			src += 8;
+
+			for (int i = 0; i < 16; i++)
+			{
+				int x = bx + (i & 3), y = by + (i >> 2);
+				if (x >= width || y >= height) continue;
+
+				int index = (indices >> (i * 2)) & 3;
+				uint8_t *p = bgra + (y * width + x) * 4;
+				p[0] = pal[index][2];
+				p[1] = pal[index][1];
+				p[2] = pal[index][0];
+				if (format == DXT_5) p[3] = alphapal[(alphabits >> (i * 3)) & 7];
+				else p[3] = threecolor && index == 3 ? 0 : 255;
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// DXT_Compress
+//
+//==========================================================================
+
+static void HalveImage(const uint8_t *src, int width, int height, uint8_t *dest)
+{
+	int w = MAX(width / 2, 1);
+	int h = MAX(height / 2, 1);
+	for (int y = 0; y < h; y++)
+	{
+		const uint8_t *row0 = src + MIN(y * 2, height - 1) * width * 4;
+		const uint8_t *row1 = src + MIN(y * 2 + 1, height - 1) * width * 4;
+		for (int x = 0; x < w; x++)
+		{
+			int x0 = MIN(x * 2, width - 1) * 4;
+			int x1 = MIN(x * 2 + 1, width - 1) * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				*dest++ = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+FDXTImage *DXT_Compress(const uint8_t *bgra, int width, int height, bool mipmaps)
+{
+	FDXTImage *image = new FDXTImage;
+	image->Width = width;
+	image->Height = height;
+	image->Levels = mipmaps ? DXT_LevelCount(width, height) : 1;
+	image->Format = DXT_ChooseFormat(bgra, width, height);
+	image->Data.Resize(DXT_ImageSize(image->Format, width, height, image->Levels));
+
+	TArray<uint8_t> mips[2];
+	const uint8_t *src = bgra;
+	uint8_t *dest = image->Data.Data();
+	for (int level = 0; level < image->Levels; level++)
+	{
+		DXT_CompressLevel(src, width, height, image->Format, dest);
+		dest += DXT_LevelSize(image->Format, width, height);
+
+		if (level + 1 < image->Levels)
+		{
+			TArray<uint8_t> &next = mips[level & 1];
+			next.Resize(MAX(width / 2, 1) * MAX(height / 2, 1) * 4);
+			HalveImage(src, width, height, next.Data());
+			src = next.Data();
+			width = MAX(width / 2, 1);
+			height = MAX(height / 2, 1);
+		}
+	}
+	return image;
+}
+
+//==========================================================================
+//
+// bench_dxt <texture> [iterations]
+//
+// Compresses a texture repeatedly and reports the speed and the error
+// against the original pixels.
+//
+//==========================================================================
+
+CCMD(bench_dxt)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: bench_dxt <texture> [iterations]\n");
+		return;
+	}
+	FTextureID picnum = TexMan.CheckForTexture(argv[1], ETextureType::Any);
+	if (!picnum.Exists())
+	{
+		Printf("Unknown texture %s\n", argv[1]);
+		return;
+	}
+	FTexture *tex = TexMan[picnum];
+	int iterations = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 10;
+	int width = tex->GetWidth(), height = tex->GetHeight();
+
+	TArray<uint8_t> pixels(width * height * 4, true);
+	memset(pixels.Data(), 0, pixels.Size());
+	FBitmap bmp(pixels.Data(), width * 4, width, height);
+	tex->CopyTrueColorPixels(&bmp, 0, 0);
+
+	static const char *const formatnames[] = { "DXT1", "DXT1A", "DXT5" };
+	EDXTFormat format = DXT_ChooseFormat(pixels.Data(), width, height);
+	TArray<uint8_t> compressed(DXT_LevelSize(format, width, height), true);
+
+	cycle_t time;
+	time.Reset();
+	for (int i = 0; i < iterations; i++)
+	{
+		time.Clock();
+		DXT_CompressLevel(pixels.Data(), width, height, format, compressed.Data());
+		time.Unclock();
+	}
+
+	TArray<uint8_t> decoded(pixels.Size(), true);
+	DXT_DecompressLevel(compressed.Data(), width, height, format, decoded.Data());
+	double error[4] = { 0, 0, 0, 0 };
+	for (unsigned i = 0; i < pixels.Size(); i++)
+	{
+		double d = double(pixels[i]) - decoded[i];
+		error[i & 3] += d * d;
+	}
+
+	double count = double(width) * height;
+	Printf("%s: %dx%d %s, %.1f Mpixels/s, RMS error R %.2f G %.2f B %.2f A %.2f\n", tex->Name.GetChars(), width, height, formatnames[format],
+		count * iterations / time.TimeMS() / 1000., sqrt(error[2] / count), sqrt(error[1] / count), sqrt(error[0] / count), sqrt(error[3] / count));
+}
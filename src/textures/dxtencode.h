@@ -0,0 +1,68 @@
+/*
+** dxtencode.h
+** S3TC (DXT1/DXT5) texture compression
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 LZDoom07 contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __DXTENCODE_H__
+#define __DXTENCODE_H__
+
+#include "doomtype.h"
+#include "tarray.h"
+
+enum EDXTFormat
+{
+	DXT_1,			// opaque
+	DXT_1A,			// DXT1 with 1 bit alpha
+	DXT_5,			// interpolated alpha
+};
+
+// A compressed image with all of its mip levels.
+struct FDXTImage
+{
+	int Width, Height;
+	int Levels;
+	EDXTFormat Format;		// DXT_5 exactly if the image has translucency
+	TArray<uint8_t> Data;	// all levels, largest first
+};
+
+// All functions work on BGRA pixels, as the texture buffers are laid out.
+EDXTFormat DXT_ChooseFormat(const uint8_t *bgra, int width, int height);
+int DXT_LevelCount(int width, int height);
+unsigned DXT_LevelSize(EDXTFormat format, int width, int height);
+unsigned DXT_ImageSize(EDXTFormat format, int width, int height, int levels);
+void DXT_CompressLevel(const uint8_t *bgra, int width, int height, EDXTFormat format, uint8_t *dest);
+void DXT_DecompressLevel(const uint8_t *src, int width, int height, EDXTFormat format, uint8_t *bgra);
+
+// Compresses the image and, if requested, a full mip chain down to 1x1.
+FDXTImage *DXT_Compress(const uint8_t *bgra, int width, int height, bool mipmaps);
+
+#endif
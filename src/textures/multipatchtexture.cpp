@@ -161,6 +161,7 @@ public:
 	virtual void SetFrontSkyLayer () override;
 
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL) override;
+	bool PrepareThreadedCopy() override;
 	int GetSourceLump() override { return DefinitionLump; }
 	FTexture *GetRedirect(bool wantwarped) override;
 	FTexture *GetRawTexture() override;
@@ -566,6 +567,40 @@ int FMultiPatchTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rota
 	return retv;
 }
 
+//===========================================================================
+//
+// FMultipatchTexture::PrepareThreadedCopy
+//
+// A composite can be built on a worker thread if all of its patches can.
+// Patches are shared between many composites, so the pixel buffers they
+// create on demand are made here, on the main thread. After that the
+// compositing only reads them.
+//
+//===========================================================================
+
+bool FMultiPatchTexture::PrepareThreadedCopy()
+{
+	if (bHasCanvas || bWarped || UseType == ETextureType::Null)
+	{
+		return false;
+	}
+	for (int i = 0; i < NumParts; i++)
+	{
+		if (!Parts[i].Texture->PrepareThreadedCopy())
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < NumParts; i++)
+	{
+		if (!Parts[i].Texture->bMultiPatch)
+		{
+			Parts[i].Texture->GetPixels(DefaultRenderStyle());
+		}
+	}
+	return true;
+}
+
 //==========================================================================
 //
 // FMultiPatchTexture :: GetFormat
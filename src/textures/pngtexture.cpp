@@ -41,6 +41,13 @@
 #include "bitmap.h"
 #include "v_palette.h"
 #include "textures/textures.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "i_system.h"
+#include "stats.h"
+#include "v_text.h"
+
+EXTERN_CVAR(Bool, png_fastdecode)
 
 //==========================================================================
 //
@@ -615,47 +622,65 @@ int FPNGTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCo
 		transpal = true;
 	}
 
-	uint8_t * Pixels = new uint8_t[pixwidth * Height];
+	// Copies rows [row, row + rows) of the image into the bitmap.
+	auto copyrows = [&](const uint8_t *pixels, int row, int rows)
+	{
+		switch (ColorType)
+		{
+		case 0:
+		case 3:
+			bmp->CopyPixelData(x, y + row, pixels, Width, rows, 1, Width, rotate, pe, inf);
+			break;
 
-	lump->Seek (StartOfIDAT, FileReader::SeekSet);
-	lump->Read(&len, 4);
-	lump->Read(&id, 4);
-	M_ReadIDAT (*lump, Pixels, Width, Height, pixwidth, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
+		case 2:
+			if (!HaveTrans)
+			{
+				bmp->CopyPixelDataRGB(x, y + row, pixels, Width, rows, 3, pixwidth, rotate, CF_RGB, inf);
+			}
+			else
+			{
+				bmp->CopyPixelDataRGB(x, y + row, pixels, Width, rows, 3, pixwidth, rotate, CF_RGBT, inf,
+					NonPaletteTrans[0], NonPaletteTrans[1], NonPaletteTrans[2]);
+				transpal = true;
+			}
+			break;
 
-	switch (ColorType)
-	{
-	case 0:
-	case 3:
-		bmp->CopyPixelData(x, y, Pixels, Width, Height, 1, Width, rotate, pe, inf);
-		break;
+		case 4:
+			bmp->CopyPixelDataRGB(x, y + row, pixels, Width, rows, 2, pixwidth, rotate, CF_IA, inf);
+			transpal = -1;
+			break;
 
-	case 2:
-		if (!HaveTrans)
-		{
-			bmp->CopyPixelDataRGB(x, y, Pixels, Width, Height, 3, pixwidth, rotate, CF_RGB, inf);
-		}
-		else
-		{
-			bmp->CopyPixelDataRGB(x, y, Pixels, Width, Height, 3, pixwidth, rotate, CF_RGBT, inf,
-				NonPaletteTrans[0], NonPaletteTrans[1], NonPaletteTrans[2]);
-			transpal = true;
-		}
-		break;
+		case 6:
+			bmp->CopyPixelDataRGB(x, y + row, pixels, Width, rows, 4, pixwidth, rotate, CF_RGBA, inf);
+			transpal = -1;
+			break;
 
-	case 4:
-		bmp->CopyPixelDataRGB(x, y, Pixels, Width, Height, 2, pixwidth, rotate, CF_IA, inf);
-		transpal = -1;
-		break;
+		default:
+			break;
 
-	case 6:
-		bmp->CopyPixelDataRGB(x, y, Pixels, Width, Height, 4, pixwidth, rotate, CF_RGBA, inf);
-		transpal = -1;
-		break;
+		}
+	};
 
-	default:
-		break;
+	lump->Seek (StartOfIDAT, FileReader::SeekSet);
+	lump->Read(&len, 4);
+	lump->Read(&id, 4);
+
+	// CopyPixelData builds the blended palette on each call, so blended paletted
+	// images are converted in one piece instead of once per row.
+	bool blendpalette = (ColorType == 0 || ColorType == 3) && inf != nullptr && inf->blend != BLEND_NONE;
 
+	if (png_fastdecode && rotate == 0 && !Interlace && BitDepth == 8 && !blendpalette)
+	{
+		// Convert every row into the bitmap right after it has been decoded,
+		// while it is still in the cache, instead of decoding the whole image first.
+		M_ReadIDATRows (*lump, Width, Height, BitDepth, ColorType, Interlace, BigLong((unsigned int)len),
+			[&](int row, const uint8_t *pixels) { copyrows(pixels, row, 1); });
+		return transpal;
 	}
+
+	uint8_t * Pixels = new uint8_t[pixwidth * Height];
+	M_ReadIDAT (*lump, Pixels, Width, Height, pixwidth, BitDepth, ColorType, Interlace, BigLong((unsigned int)len));
+	copyrows(Pixels, 0, Height);
 	delete[] Pixels;
 	return transpal;
 }
@@ -673,3 +698,88 @@ bool FPNGTexture::UseBasePalette()
 { 
 	return false; 
 }
+
+//===========================================================================
+//
+// Decodes all PNGs in a directory with the reference and the fast decoder,
+// reports the time taken by each and checks that the results are identical.
+//
+//===========================================================================
+
+CCMD(bench_png)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: bench_png <directory> [iterations]\n");
+		return;
+	}
+	FString dir = argv[1];
+	if (dir.Back() != '/') dir += '/';
+	int iterations = argv.argc() > 2 ? MAX(atoi(argv[2]), 1) : 1;
+
+	TArray<FString> files;
+	findstate_t find;
+	void *handle = I_FindFirst((dir + "*.png").GetChars(), &find);
+	if (handle != (void *)-1)
+	{
+		do
+		{
+			if (!(I_FindAttr(&find) & FA_DIREC)) files.Push(dir + I_FindName(&find));
+		} while (I_FindNext(handle, &find) == 0);
+		I_FindClose(handle);
+	}
+	if (files.Size() == 0)
+	{
+		Printf("No PNGs found in %s\n", dir.GetChars());
+		return;
+	}
+
+	bool saved = png_fastdecode;
+	cycle_t reftime, fasttime;
+	reftime.Reset();
+	fasttime.Reset();
+	double pixels = 0;
+	int decoded = 0, mismatches = 0;
+
+	for (auto &name : files)
+	{
+		FileReader fr;
+		if (!fr.OpenFile(name)) continue;
+		PNGHandle *png = M_VerifyPNG(fr);
+		if (png == nullptr) continue;
+		FTexture *tex = PNGTexture_CreateFromFile(png, name);
+		delete png;
+		if (tex == nullptr) continue;
+
+		FBitmap reference, result;
+		reference.Create(tex->GetWidth(), tex->GetHeight());
+		result.Create(tex->GetWidth(), tex->GetHeight());
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			png_fastdecode = pass == 1;
+			cycle_t &time = pass == 1 ? fasttime : reftime;
+			FBitmap &bmp = pass == 1 ? result : reference;
+			for (int i = 0; i < iterations; i++)
+			{
+				time.Clock();
+				tex->CopyTrueColorPixels(&bmp, 0, 0);
+				time.Unclock();
+			}
+		}
+		png_fastdecode = saved;
+
+		if (memcmp(reference.GetPixels(), result.GetPixels(), reference.GetPitch() * reference.GetHeight()) != 0)
+		{
+			Printf(TEXTCOLOR_RED "%s: MISMATCH\n" TEXTCOLOR_NORMAL, name.GetChars());
+			mismatches++;
+		}
+		pixels += double(tex->GetWidth()) * tex->GetHeight() * iterations;
+		decoded++;
+		delete tex;
+	}
+
+	Printf("%d PNGs, %.1f Mpixels: reference %.1f ms (%.1f Mpixels/s), fast %.1f ms (%.1f Mpixels/s, %.2fx)%s\n",
+		decoded, pixels / 1e6, reftime.TimeMS(), pixels / reftime.TimeMS() / 1000., fasttime.TimeMS(), pixels / fasttime.TimeMS() / 1000.,
+		reftime.TimeMS() / fasttime.TimeMS(), mismatches > 0 ? TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL : "");
+}
@@ -42,12 +42,16 @@
 #include "bitmap.h"
 #include "colormatcher.h"
 #include "c_dispatch.h"
+#include "c_cvars.h"
 #include "v_video.h"
 #include "m_fixed.h"
 #include "textures/textures.h"
 #include "v_palette.h"
 #include "g_levellocals.h"
 
+// Decode textures on all available cores when precaching a level.
+CVAR(Bool, r_precache_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 typedef FTexture * (*CreateFunc)(FileReader & file, int lumpnum);
 
 struct TexCreateInfo
@@ -830,6 +834,35 @@ FTexture *FTexture::GetRawTexture()
 	return this;
 }
 
+//===========================================================================
+//
+// FTexture :: IsStandalone
+//
+// Textures whose image is created from nothing but their own lump can be
+// decoded on a worker thread because the decoding only touches data that
+// belongs to this texture. Composites, warps and canvases cannot.
+//
+//===========================================================================
+
+bool FTexture::IsStandalone()
+{
+	return SourceLump >= 0 && !bMultiPatch && !bHasCanvas && !bWarped && UseType != ETextureType::Null;
+}
+
+//===========================================================================
+//
+// FTexture :: PrepareThreadedCopy
+//
+// Must be called on the main thread before CopyTrueColorPixels is used
+// on a worker. Standalone textures need no preparation.
+//
+//===========================================================================
+
+bool FTexture::PrepareThreadedCopy()
+{
+	return IsStandalone();
+}
+
 void FTexture::SetScaledSize(int fitwidth, int fitheight)
 {
 	Scale.X = double(Width) / fitwidth;
@@ -275,6 +275,8 @@ public:
 	virtual int GetSourceLump() { return SourceLump; }
 	virtual FTexture *GetRedirect(bool wantwarped);
 	virtual FTexture *GetRawTexture();		// for FMultiPatchTexture to override
+	bool IsStandalone();					// true if the image only depends on its own source lump
+	virtual bool PrepareThreadedCopy();		// true if CopyTrueColorPixels may run on a worker thread
 
 	virtual void Unload ();
 
@@ -109,6 +109,8 @@ public:
 	FName GetName() const { return FontName; }
 
 	static FFont *FindFont(FName fontname);
+	static FFont *GetFirstFont() { return FirstFont; }
+	FFont *GetNextFont() const { return Next; }
 	static void StaticPreloadFonts();
 
 	// Return width of string in pixels (unscaled)
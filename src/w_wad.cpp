@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <mutex>
 
 #include "doomtype.h"
 #include "m_argv.h"
@@ -1473,6 +1474,9 @@ DEFINE_ACTION_FUNCTION(_Wads, ReadLump)
 //==========================================================================
 
 
+static thread_local bool ThreadedLumpAccess;
+static std::mutex ThreadedLumpMutex;
+
 FileReader FWadCollection::OpenLumpReader(int lump)
 {
 	if ((unsigned)lump >= (unsigned)LumpInfo.Size())
@@ -1481,6 +1485,27 @@ FileReader FWadCollection::OpenLumpReader(int lump)
 	}
 
 	auto rl = LumpInfo[lump].lump;
+
+	if (ThreadedLumpAccess)
+	{
+		// The containing file's reader and the lump cache are shared with
+		// all other threads so the only safe thing is to read the entire lump
+		// into a buffer that is owned by the returned reader.
+		FileReader rdr;
+		rdr.OpenMemoryArray([=](TArray<uint8_t> &data)
+		{
+			std::lock_guard<std::mutex> lock(ThreadedLumpMutex);
+			data.Resize(rl->LumpSize);
+			if (rl->LumpSize > 0)
+			{
+				memcpy(data.Data(), rl->CacheLump(), rl->LumpSize);
+				rl->ReleaseCache();
+			}
+			return true;
+		});
+		return rdr;
+	}
+
 	auto rd = rl->GetReader();
 
 	if (rl->RefCount == 0 && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & (LUMPF_BLOODCRYPT | LUMPF_COMPRESSED)))
@@ -1492,6 +1517,20 @@ FileReader FWadCollection::OpenLumpReader(int lump)
 	return rl->NewReader();	// This always gets a reader to the cache
 }
 
+//==========================================================================
+//
+// SetThreadedAccess
+//
+// Worker threads that need to read lumps, e.g. for decoding textures
+// during precaching, must enable this for the duration of their work.
+//
+//==========================================================================
+
+void FWadCollection::SetThreadedAccess(bool on)
+{
+	ThreadedLumpAccess = on;
+}
+
 FileReader FWadCollection::ReopenLumpReader(int lump, bool alwayscache)
 {
 	if ((unsigned)lump >= (unsigned)LumpInfo.Size())
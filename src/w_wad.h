@@ -160,6 +160,7 @@ public:
 
 	FileReader OpenLumpReader(int lump);		// opens a reader that redirects to the containing file's one.
 	FileReader ReopenLumpReader(int lump, bool alwayscache = false);		// opens an independent reader.
+	static void SetThreadedAccess(bool on);		// while on, the calling thread only gets private copies of lumps, read under a lock.
 
 	int FindLump (const char *name, int *lastlump, bool anyns=false);		// [RH] Find lumps with duplication
 	int FindLumpMulti (const char **names, int *lastlump, bool anyns = false, int *nameindex = NULL); // same with multiple possible names
@@ -222,4 +223,12 @@ private:
 
 extern FWadCollection Wads;
 
+// Turns threaded lump access on for the calling thread while in scope, so a
+// worker that throws does not leave it switched on.
+struct FThreadedLumpAccess
+{
+	FThreadedLumpAccess() { FWadCollection::SetThreadedAccess(true); }
+	~FThreadedLumpAccess() { FWadCollection::SetThreadedAccess(false); }
+};
+
 #endif